@@ -5,6 +5,21 @@ uniform vec2 Scale;
 uniform vec2 ScaleIn; 
 uniform vec4 HmdWarpParam; 
 
+// multi-resolution, tex is then the packed eye. Where the full resolution centre starts and ends (x0, x1, y0, y1)
+// in the eye's texture coordinates and in the packed texture, the border in between is scaled down.
+uniform int MultiRes;
+uniform vec4 MultiResEyeSplit;
+uniform vec4 MultiResPackedSplit;
+
+// overlay layers, mapped from this eye's normalized device coordinates to their texture coordinates
+uniform int NumOverlays;
+uniform sampler2D Overlay0Tex;
+uniform mat3 Overlay0Map;
+uniform float Overlay0Alpha;
+uniform sampler2D Overlay1Tex;
+uniform mat3 Overlay1Map;
+uniform float Overlay1Alpha;
+
 vec2 HmdWarp(vec2 texIn)  
 {  
       vec2 theta = (texIn - LensCenter) * ScaleIn; 
@@ -14,6 +29,43 @@ vec2 HmdWarp(vec2 texIn)
       return LensCenter + Scale * theta1; 
 } 
 
+float MultiResRemapAxis(float t, vec2 split, vec2 packed)
+{
+      if (t < split.x)
+      {
+            return t / max(split.x, 0.0001) * packed.x;
+      }
+      else if (t > split.y)
+      {
+            return packed.y + (t - split.y) / max(1.0 - split.y, 0.0001) * (1.0 - packed.y);
+      }
+      return packed.x + (t - split.x) / (split.y - split.x) * (packed.y - packed.x);
+}
+
+vec2 MultiResRemap(vec2 tc)
+{
+      vec2 eyeTc = (tc - ScreenCenter) / vec2(0.5, 1.0) + vec2(0.5);
+      return vec2(MultiResRemapAxis(eyeTc.x, MultiResEyeSplit.xy, MultiResPackedSplit.xy),
+                  MultiResRemapAxis(eyeTc.y, MultiResEyeSplit.zw, MultiResPackedSplit.zw));
+}
+
+vec4 OverlayColor(sampler2D overlayTex, mat3 overlayMap, vec2 ndc)
+{
+      vec3 h = overlayMap * vec3(ndc, 1.0);
+      if (h.z <= 0.0)
+      {
+            return vec4(0.0); // behind the eye
+      }
+
+      vec2 uv = h.xy / h.z;
+      if (any(lessThan(uv, vec2(0.0))) || any(greaterThan(uv, vec2(1.0))))
+      {
+            return vec4(0.0);
+      }
+
+      return texture2D(overlayTex, uv);
+}
+
 void main() 
 { 
       vec2 tc = HmdWarp(gl_TexCoord[0].st); 
@@ -23,7 +75,28 @@ void main()
       }
       else
       { 
-            gl_FragColor = texture2D(tex, tc);
+            if (MultiRes != 0)
+            {
+                  gl_FragColor = texture2D(tex, MultiResRemap(tc));
+            }
+            else
+            {
+                  gl_FragColor = texture2D(tex, tc);
+            }
+
+            if (NumOverlays > 0)
+            {
+                  vec2 ndc = (tc - ScreenCenter) / vec2(0.25, 0.5);
+
+                  vec4 overlay = OverlayColor(Overlay0Tex, Overlay0Map, ndc);
+                  gl_FragColor.rgb = mix(gl_FragColor.rgb, overlay.rgb, overlay.a * Overlay0Alpha);
+
+                  if (NumOverlays > 1)
+                  {
+                        overlay = OverlayColor(Overlay1Tex, Overlay1Map, ndc);
+                        gl_FragColor.rgb = mix(gl_FragColor.rgb, overlay.rgb, overlay.a * Overlay1Alpha);
+                  }
+            }
       }
 
 
@@ -5,22 +5,39 @@ void testApp::setup()
 {
 	ofSetLogLevel( OF_LOG_VERBOSE );	
 	
+	// no frame rate limit, vsync paces us and the frame scheduler starts rendering as late as it can
 	ofSetFrameRate(999);
-	ofSetVerticalSync( false );
+	ofSetVerticalSync( true );
 	
-	//ofSetFrameRate( 60 );
-	//ofSetVerticalSync( true );
+	//ofSetFrameRate(999);
+	//ofSetVerticalSync( false );
 		
 	fontWorld.loadFont( "Fonts/DIN.otf", 18, true, false, true );
 	//fontWorld.loadFont( "Fonts/DIN.otf", 18 );
 
-	oculusRift.init( 1280, 800, 4 );
+	// starts rendering straight away, the sensor is hooked up when the devices have been found
+	ofAddListener( oculusRift.deviceInitEvent, this, &testApp::oculusRiftDeviceInit );
+	oculusRift.initAsync( 1280, 800, 4 );
 	oculusRift.setPosition( 0,-30,0 );
+	oculusRift.getFrameScheduler().setEnabled( true );
+	
+	// a head locked panel a little below the centre of view
+	hudOverlay.allocate( 512, 256 );
+	hudOverlay.setSize( 40.0f, 20.0f );
+	hudOverlay.setPosition( 0.0f, -8.0f, -50.0f );
+	hudOverlay.setHeadLocked( true );
+	oculusRift.addOverlay( &hudOverlay );
 	
 	lastUpdateTime = ofGetElapsedTimef();
 }
 
 
+//--------------------------------------------------------------
+void testApp::oculusRiftDeviceInit( bool& _sensorFound )
+{
+	ofLogNotice() << "Oculus Rift " << (_sensorFound ? "sensor found" : "sensor not found") << " after " << ofGetElapsedTimef() << " seconds";
+}
+
 //--------------------------------------------------------------
 void testApp::update()
 {
@@ -38,19 +55,36 @@ void testApp::update()
 	if( ofGetKeyPressed(OF_KEY_LEFT) )  { oculusRift.truck(  30.0f * frameDeltaTime ); }
 	if( ofGetKeyPressed(OF_KEY_RIGHT) ) { oculusRift.truck( -30.0f * frameDeltaTime ); }
 	
+	drawHud();
 }
 
 
 //--------------------------------------------------------------
 void testApp::draw()
 {
-	oculusRift.beginRenderSceneLeftEye();
-		drawSceneGeometry();
-	oculusRift.endRenderSceneLeftEye();
+	// everything past the far field distance is drawn once for both eyes, the clip planes do the splitting here,
+	// a real scene would only draw what is on each side of it
+	if( oculusRift.getFarFieldDistance() > 0.0f )
+	{
+		oculusRift.beginRenderSceneFarField();
+			drawSceneGeometry();
+		oculusRift.endRenderSceneFarField();
+	}
+	
+	// just the one region unless multi-resolution is on
+	for( int i = 0; i < oculusRift.getNumEyeRegions(); i++ )
+	{
+		oculusRift.beginRenderSceneLeftEye( i );
+			drawSceneGeometry();
+		oculusRift.endRenderSceneLeftEye();
+	}
 	
-	oculusRift.beginRenderSceneRightEye();
-		drawSceneGeometry();
-	oculusRift.endRenderSceneRightEye();
+	for( int i = 0; i < oculusRift.getNumEyeRegions(); i++ )
+	{
+		oculusRift.beginRenderSceneRightEye( i );
+			drawSceneGeometry();
+		oculusRift.endRenderSceneRightEye();
+	}
 	
 	ofSetColor( 255 );
 	oculusRift.draw( ofVec2f(0,0), ofVec2f( ofGetWidth(), ofGetHeight() ) );
@@ -76,20 +110,27 @@ void testApp::drawSceneGeometry()
 		}
 	ofPopMatrix();
 	
+	ofSetColor(255);
+}
+
+//--------------------------------------------------------------
+void testApp::drawHud()
+{
 	string tmpStr = "Do Warping: " + ofToString( oculusRift.getDoWarping() ) + "\n";
 	tmpStr += "Inter Ocular Distance: "  + ofToString( oculusRift.getInterOcularDistance() ) + "\n";
 	tmpStr += "Shader Scale Factor: "  + ofToString( oculusRift.getShaderScaleFactor() ) + "\n";
+	tmpStr += "Multi Resolution: "  + ofToString( oculusRift.getMultiResolution() ) + "\n";
+	tmpStr += "Far Field Distance: "  + ofToString( oculusRift.getFarFieldDistance() ) + "\n";
+	tmpStr += "Frame Scheduler: "  + ofToString( oculusRift.getFrameScheduler().getEnabled() ) + " waited (ms): " + ofToString( oculusRift.getFrameScheduler().getLastWait() * 1000.0f, 1 ) + " missed: " + ofToString( oculusRift.getFrameScheduler().getNumMissedVsyncs() ) + "\n";
+	tmpStr += "Prediction (ms): "  + ofToString( oculusRift.getPredictionStats().predictionDelta * 1000.0f, 1 ) + "\n";
+	tmpStr += "Prediction Error (deg): "  + ofToString( oculusRift.getPredictionStats().errorMean, 2 ) + "\n";
 	
-	ofSetColor( 255 );
-	
-	ofPushMatrix();
-		ofTranslate( ofPoint(-60,280,-200) );
-		ofRotateZ( 180 );
-		ofRotateY( 180 );
-		fontWorld.drawString( tmpStr, 0.0f, 0.0f );
-	ofPopMatrix();
-	
-	ofSetColor(255);
+	// drawn once into the overlay, the warp pass puts it in front of both eyes
+	hudOverlay.begin();
+		ofClear( 0, 0, 0, 0 );
+		ofSetColor( 255 );
+		fontWorld.drawString( tmpStr, 10.0f, 30.0f );
+	hudOverlay.end();
 }
 
 //--------------------------------------------------------------
@@ -103,6 +144,23 @@ void testApp::keyPressed(int key)
 	{
 		oculusRift.setDoWarping( !oculusRift.getDoWarping() );
 	}
+	if( key == 'm' )
+	{
+		oculusRift.setMultiResolution( !oculusRift.getMultiResolution() );
+	}
+	if( key == 'j' )
+	{
+		oculusRift.getFrameScheduler().setEnabled( !oculusRift.getFrameScheduler().getEnabled() );
+	}
+	if( key == 'p' )
+	{
+		oculusRift.setFarFieldDistance( oculusRift.getFarFieldDistance() > 0.0f ? 0.0f : 500.0f );
+	}
+	if( key == 't' )
+	{
+		oculusRift.getFrameTiming().saveCsv( "frameTiming.csv" );
+		oculusRift.getFrameTiming().saveChromeTrace( "frameTiming.json" );
+	}
 }
 
 //--------------------------------------------------------------
@@ -12,6 +12,9 @@ class testApp : public ofBaseApp
 		void draw();
 		
 		void drawSceneGeometry();
+		void drawHud();
+	
+		void oculusRiftDeviceInit( bool& _sensorFound );
 		
 		void keyPressed(int key);
 		void keyReleased(int key);
@@ -24,6 +27,7 @@ class testApp : public ofBaseApp
 		void gotMessage(ofMessage msg);
 	
 		ofxOculusRift		oculusRift;
+		ofxOculusRiftOverlay hudOverlay;
 	
 		float				lastUpdateTime;
 	
@@ -19,8 +19,8 @@ void testApp::update()
 //--------------------------------------------------------------
 void testApp::draw()
 {
-	// as we are not drawing anything using the headset camera class, we need to tell it we wnt new sensor data this frame.
-	oculusRift.setNeedSensorReadingThisFrame( true );
+	// as we are not drawing anything using the headset camera class, take the pose for this frame here.
+	oculusRift.capturePose();
 	
 	glEnable( GL_DEPTH_TEST );
 	
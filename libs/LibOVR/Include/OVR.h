@@ -19,14 +19,20 @@ otherwise accompanies this software in either electronic or hard copy form.
 #include "../Src/Kernel/OVR_Log.h"
 #include "../Src/Kernel/OVR_Math.h"
 #include "../Src/Kernel/OVR_System.h"
+#include "../Src/Kernel/OVR_Threads.h"
+#include "../Src/Kernel/OVR_Timer.h"
 #include "../Src/Kernel/OVR_Types.h"
 #include "../Src/OVR_Device.h"
 #include "../Src/OVR_DeviceConstants.h"
 #include "../Src/OVR_DeviceHandle.h"
 #include "../Src/OVR_DeviceMessages.h"
 #include "../Src/OVR_SensorFusion.h"
+#include "../Src/OVR_SensorPredictor.h"
+#include "../Src/Util/Util_FusionSweep.h"
 #include "../Src/Util/Util_LatencyTest.h"
+#include "../Src/Util/Util_PoseServer.h"
 #include "../Src/Util/Util_Render_Stereo.h"
+#include "../Src/Util/Util_SensorCapture.h"
 
 #endif
 
@@ -0,0 +1,93 @@
+//
+//  OVR_SPSCQueue.h
+//  OculusRiftRendering
+//
+//
+//
+
+#ifndef OVR_SPSCQueue_h
+#define OVR_SPSCQueue_h
+
+#include "OVR_Types.h"
+#include "OVR_Atomic.h"
+
+namespace OVR {
+
+//-----------------------------------------------------------------------------------
+// ***** SPSCQueue
+//
+// Ring buffer of Capacity items, which must be a power of two, for handing items from
+// exactly one producer thread to exactly one consumer thread. Neither side ever takes
+// a lock or waits for the other: PushBack fails when the queue is full and PopFront
+// when it is empty. Head and Tail count up forever and only their difference matters,
+// so wrapping around is fine. They are kept on separate cache lines, the producer and
+// consumer each write only their own.
+//
+// Items are copied in and out, T should be plain data.
+
+template<class T, unsigned Capacity>
+class SPSCQueue
+{
+public:
+    SPSCQueue() : Head(0), Tail(0), HighWater(0)
+    {
+        OVR_COMPILER_ASSERT((Capacity & (Capacity - 1)) == 0);
+    }
+
+    // Producer only.
+    bool PushBack(const T& item)
+    {
+        UInt32 tail = Tail;
+        UInt32 size = tail - Head.Load_Acquire();
+        if (size >= Capacity)
+            return false;
+
+        Items[tail & (Capacity - 1)] = item;
+        // The item must be in place before the consumer can see the new tail.
+        Tail.Store_Release(tail + 1);
+
+        // Only a new maximum costs a compare-and-set. Another thread may reset the
+        // high water in between, then the loop sees the 0 and tries again.
+        UInt32 highWater = HighWater;
+        while (size + 1 > highWater && !HighWater.CompareAndSet_NoSync(highWater, size + 1))
+            highWater = HighWater;
+        return true;
+    }
+
+    // Consumer only.
+    bool PopFront(T* item)
+    {
+        UInt32 head = Head;
+        if (head == Tail.Load_Acquire())
+            return false;
+
+        *item = Items[head & (Capacity - 1)];
+        // Done reading the item before the producer may write over it.
+        Head.Store_Release(head + 1);
+        return true;
+    }
+
+    // Exact only when called from one of the two threads while the other is idle;
+    // otherwise a snapshot that may already be stale.
+    UInt32   GetSize() const     { return Tail.Load_Acquire() - Head.Load_Acquire(); }
+    bool     IsEmpty() const     { return GetSize() == 0; }
+    unsigned GetCapacity() const { return Capacity; }
+
+    // Most items that were ever waiting at once. Raised by the producer, any thread
+    // may read or reset it.
+    UInt32   GetHighWater() const { return HighWater.Load_Acquire(); }
+    void     ResetHighWater()     { HighWater.Store_Release(0); }
+
+private:
+    AtomicInt<UInt32>   Head;
+    UByte               HeadPad[64 - sizeof(UInt32)];
+    AtomicInt<UInt32>   Tail;
+    AtomicInt<UInt32>   HighWater;
+    UByte               TailPad[64 - 2 * sizeof(UInt32)];
+    T                   Items[Capacity];
+};
+
+
+} // OVR
+
+#endif
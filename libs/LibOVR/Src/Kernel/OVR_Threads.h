@@ -220,19 +220,34 @@ public:
         IdlePriority,
     };
 
+    // Thread scheduling policy. The real-time policies run the thread ahead of all threads
+    // under normal scheduling, at their own priority; they usually need privileges the
+    // process may not have, and the thread then stays on normal scheduling. Win32 has no
+    // such policies, the thread gets time critical priority instead.
+    enum SchedulingPolicy
+    {
+        NormalScheduling,
+        FifoScheduling,         // Runs until it blocks or a higher priority thread is ready.
+        RoundRobinScheduling    // The same, taking turns with threads of equal priority.
+    };
+
     // Thread constructor parameters
     struct CreateParams
     {
         CreateParams(ThreadFn func = 0, void* hand = 0, UPInt ssize = 128 * 1024, 
                      int proc = -1, ThreadState state = NotRunning, ThreadPriority prior = NormalPriority)
                      : threadFunction(func), userHandle(hand), stackSize(ssize), 
-                       processor(proc), initialState(state), priority(prior) {}
+                       processor(proc), initialState(state), priority(prior),
+                       affinityMask(0), policy(NormalScheduling), realTimePriority(0) {}
         ThreadFn       threadFunction;   // Thread function
         void*          userHandle;       // User handle passes to a thread
         UPInt          stackSize;        // Thread stack size
         int            processor;        // Thread hardware processor
         ThreadState    initialState;     // 
         ThreadPriority priority;         // Thread priority
+        UInt64         affinityMask;     // CPUs the thread may run on, bit n for CPU n; 0 to go by processor
+        SchedulingPolicy policy;         // Scheduling policy
+        int            realTimePriority; // For the real-time policies, 1 and up; clamped to what the system allows
     };
 
     // *** Constructors
@@ -240,12 +255,12 @@ public:
     // A default constructor always creates a thread in NotRunning state, because
     // the derived class has not yet been initialized. The derived class can call Start explicitly.
     // "processor" parameter specifies which hardware processor this thread will be run on. 
-    // -1 means OS decides this. Implemented only on Win32
+    // -1 means OS decides this. Implemented on Win32 and Linux
     Thread(UPInt stackSize = 128 * 1024, int processor = -1);
     // Constructors that initialize the thread with a pointer to function.
     // An option to start a thread is available, but it should not be used if classes are derived from Thread.
     // "processor" parameter specifies which hardware processor this thread will be run on. 
-    // -1 means OS decides this. Implemented only on Win32
+    // -1 means OS decides this. Implemented on Win32 and Linux
     Thread(ThreadFn threadFunction, void*  userHandle = 0, UPInt stackSize = 128 * 1024,
            int processor = -1, ThreadState initialState = NotRunning);
     // Constructors that initialize the thread with a create parameters structure.
@@ -303,6 +318,17 @@ public:
     // Returns current thread state
     ThreadState   GetThreadState() const;
 
+    // Restricts the thread to the CPUs in mask, bit n for CPU n; 0 lets it run on any.
+    // Applied at once to a running thread, otherwise when it starts. Returns false if the
+    // system doesn't support or allow it, in which case the thread runs where it did.
+    // Affinity masks are implemented on Win32 and Linux.
+    bool          SetAffinityMask(UInt64 mask);
+    UInt64        GetAffinityMask() const { return AffinityMask; }
+
+    // Sets the scheduling policy, the same way as SetAffinityMask.
+    bool          SetSchedulingPolicy(SchedulingPolicy policy, int realTimePriority = 0);
+    SchedulingPolicy GetSchedulingPolicy() const { return Policy; }
+
     // Returns the number of available CPUs on the system 
     static int    GetCPUCount();
 
@@ -358,6 +384,10 @@ protected:
     // Hardware processor which this thread is running on.
     int            Processor;
     ThreadPriority Priority;
+    // As requested; the thread may have been refused either.
+    UInt64           AffinityMask;
+    SchedulingPolicy Policy;
+    int              RealTimePriority;
 
 #if defined(OVR_OS_WIN32)
     void*               ThreadHandle;
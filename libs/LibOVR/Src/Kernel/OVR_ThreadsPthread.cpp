@@ -8,6 +8,7 @@
 #include "OVR_Log.h"
 
 #include <pthread.h>
+#include <sched.h>
 #include <time.h>
 
 #ifdef OVR_OS_PS3
@@ -409,6 +410,11 @@ void Thread::Init(const CreateParams& params)
     StackSize       = params.stackSize;
     Processor       = params.processor;
     Priority        = params.priority;
+    Policy          = params.policy;
+    RealTimePriority= params.realTimePriority;
+    AffinityMask    = params.affinityMask;
+    if (!AffinityMask && (Processor >= 0) && (Processor < 64))
+        AffinityMask = (UInt64)1 << Processor;
 
     // Clear Function pointers
     ThreadFunction  = params.threadFunction;
@@ -632,10 +638,94 @@ static const char* mapsched_policy(int policy)
 */
 // ***** Thread management
 
+// Affinity and scheduling are set by the thread on itself as it starts, or on a running
+// thread from another one. When the system refuses, the thread carries on as it was.
+static bool Thread_PthreadSetAffinity(pthread_t thread, UInt64 mask)
+{
+#if defined(OVR_OS_LINUX)
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+        if (!mask || ((cpu < 64) && (mask & ((UInt64)1 << cpu))))
+            CPU_SET(cpu, &cpus);
+    }
+
+    int result = pthread_setaffinity_np(thread, sizeof(cpus), &cpus);
+    if (result)
+    {
+        OVR_DEBUG_LOG(("Thread - could not set affinity mask %llx, error %d",
+                       (unsigned long long)mask, result));
+        return false;
+    }
+    return true;
+#else
+    OVR_UNUSED(thread);
+    return mask == 0;
+#endif
+}
+
+static bool Thread_PthreadSetScheduling(pthread_t thread, Thread::SchedulingPolicy policy,
+                                        int realTimePriority)
+{
+    int         osPolicy = SCHED_OTHER;
+    sched_param sparam;
+
+    if (policy == Thread::FifoScheduling)
+        osPolicy = SCHED_FIFO;
+    else if (policy == Thread::RoundRobinScheduling)
+        osPolicy = SCHED_RR;
+
+    // Normal scheduling has a single priority on Linux; elsewhere take the middle one.
+    int minPriority = sched_get_priority_min(osPolicy);
+    int maxPriority = sched_get_priority_max(osPolicy);
+    int priority    = (policy == Thread::NormalScheduling) ?
+                      (minPriority + maxPriority) / 2 : realTimePriority;
+    if (priority < minPriority)
+        priority = minPriority;
+    if (priority > maxPriority)
+        priority = maxPriority;
+    sparam.sched_priority = priority;
+
+    // EPERM unless the process may use real-time priorities, through CAP_SYS_NICE or
+    // RLIMIT_RTPRIO on Linux.
+    int result = pthread_setschedparam(thread, osPolicy, &sparam);
+    if (result)
+    {
+        OVR_DEBUG_LOG(("Thread - could not set scheduling policy %d priority %d, error %d",
+                       (int)policy, priority, result));
+        return false;
+    }
+    return true;
+}
+
+bool    Thread::SetAffinityMask(UInt64 mask)
+{
+    AffinityMask = mask;
+    if (!ThreadHandle || IsFinished())
+        return true;
+    return Thread_PthreadSetAffinity(ThreadHandle, mask);
+}
+
+bool    Thread::SetSchedulingPolicy(SchedulingPolicy policy, int realTimePriority)
+{
+    Policy           = policy;
+    RealTimePriority = realTimePriority;
+    if (!ThreadHandle || IsFinished())
+        return true;
+    return Thread_PthreadSetScheduling(ThreadHandle, policy, realTimePriority);
+}
+
 // The actual first function called on thread start
 void* Thread_PthreadStartFn(void* phandle)
 {
     Thread* pthread = (Thread*)phandle;
+
+    if (pthread->AffinityMask)
+        Thread_PthreadSetAffinity(pthread_self(), pthread->AffinityMask);
+    if (pthread->Policy != Thread::NormalScheduling)
+        Thread_PthreadSetScheduling(pthread_self(), pthread->Policy, pthread->RealTimePriority);
+
     int     result = pthread->PRun();
     // Signal the thread as done and release it atomically.
     pthread->FinishAndRelease();
@@ -780,7 +870,12 @@ bool    Thread::MSleep(unsigned msecs)
 /* static */
 int     Thread::GetCPUCount()
 {
+#if defined(_SC_NPROCESSORS_ONLN)
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return (count > 0) ? (int)count : 1;
+#else
     return 1;
+#endif
 }
 
 
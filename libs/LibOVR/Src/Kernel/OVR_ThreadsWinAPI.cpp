@@ -560,6 +560,11 @@ void Thread::Init(const CreateParams& params)
     StackSize       = params.stackSize;
     Processor       = params.processor;
     Priority        = params.priority;
+    Policy          = params.policy;
+    RealTimePriority= params.realTimePriority;
+    AffinityMask    = params.affinityMask;
+    if (!AffinityMask && (Processor >= 0) && (Processor < 64))
+        AffinityMask = (UInt64)1 << Processor;
 
     // Clear Function pointers
     ThreadFunction  = params.threadFunction;
@@ -793,20 +798,63 @@ int Thread::GetOSPriority(ThreadPriority p)
     return THREAD_PRIORITY_NORMAL;
 }
 
-// The actual first function called on thread start
-unsigned WINAPI Thread_Win32StartFn(void * phandle)
+// Affinity and priority are set by the thread on itself as it starts, or on a running
+// thread from another one. When the system refuses, the thread carries on as it was.
+static bool Thread_Win32SetAffinity(HANDLE thread, UInt64 mask)
 {
-    Thread *   pthread = (Thread*)phandle;
-    if (pthread->Processor != -1)
+    // A mask of 0 means all the CPUs the process may use.
+    DWORD_PTR processMask, systemMask;
+    DWORD_PTR osMask = (DWORD_PTR)mask;
+    if (!osMask && GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask))
+        osMask = processMask;
+
+    if (!osMask || (::SetThreadAffinityMask(thread, osMask) == 0))
     {
-        DWORD_PTR ret = SetThreadAffinityMask(GetCurrentThread(), (DWORD)pthread->Processor);
-        if (ret == 0)
-            OVR_DEBUG_LOG(("Could not set hardware processor for the thread"));
+        OVR_DEBUG_LOG(("Could not set affinity mask for the thread"));
+        return false;
     }
-    BOOL ret = ::SetThreadPriority(GetCurrentThread(), Thread::GetOSPriority(pthread->Priority));
-    if (ret == 0)
+    return true;
+}
+
+static bool Thread_Win32SetPriority(HANDLE thread, Thread::SchedulingPolicy policy,
+                                    Thread::ThreadPriority priority)
+{
+    int osPriority = (policy == Thread::NormalScheduling) ?
+                     Thread::GetOSPriority(priority) : THREAD_PRIORITY_TIME_CRITICAL;
+
+    if (::SetThreadPriority(thread, osPriority) == 0)
+    {
         OVR_DEBUG_LOG(("Could not set thread priority"));
-    OVR_UNUSED(ret);
+        return false;
+    }
+    return true;
+}
+
+bool Thread::SetAffinityMask(UInt64 mask)
+{
+    AffinityMask = mask;
+    if (!ThreadHandle || IsFinished())
+        return true;
+    return Thread_Win32SetAffinity(ThreadHandle, mask);
+}
+
+bool Thread::SetSchedulingPolicy(SchedulingPolicy policy, int realTimePriority)
+{
+    Policy           = policy;
+    RealTimePriority = realTimePriority;
+    if (!ThreadHandle || IsFinished())
+        return true;
+    return Thread_Win32SetPriority(ThreadHandle, policy, Priority);
+}
+
+// The actual first function called on thread start
+unsigned WINAPI Thread_Win32StartFn(void * phandle)
+{
+    Thread *   pthread = (Thread*)phandle;
+
+    if (pthread->AffinityMask)
+        Thread_Win32SetAffinity(GetCurrentThread(), pthread->AffinityMask);
+    Thread_Win32SetPriority(GetCurrentThread(), pthread->Policy, pthread->Priority);
 
     // Ensure that ThreadId is assigned once thread is running, in case
     // beginthread hasn't filled it in yet.
@@ -18,8 +18,17 @@ otherwise accompanies this software in either electronic or hard copy form.
 #if defined (OVR_OS_WIN32)
 #include <windows.h>
 
+#elif defined(OVR_OS_MAC)
+#include <mach/mach_time.h>
+#include <unistd.h>
 #else
-#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#if !defined(OVR_OS_WIN32) && defined(OVR_CC_GNU) && (defined(OVR_CPU_X86) || defined(OVR_CPU_X86_64))
+#include <cpuid.h>
+#define OVR_TIMER_TSC
 #endif
 
 namespace OVR {
@@ -29,7 +38,12 @@ namespace OVR {
 
 UInt64 Timer::GetProfileTicks()
 {
-    return (GetRawTicks() * MksPerSecond) / GetRawFrequency();
+    // Whole seconds first; raw ticks times MksPerSecond overflows within hours for
+    // a counter at CPU clock rate.
+    UInt64 rawTicks  = GetRawTicks();
+    UInt64 frequency = GetRawFrequency();
+    return (rawTicks / frequency) * MksPerSecond +
+           ((rawTicks % frequency) * MksPerSecond) / frequency;
 }
 double Timer::GetProfileSeconds()
 {
@@ -92,6 +106,18 @@ UInt64 Timer::GetRawFrequency()
     return perfFreq;
 }
 
+bool Timer::EnableRawTSC(bool enable, unsigned calibrationMs)
+{
+    // QueryPerformanceCounter already reads the TSC where it is invariant.
+    OVR_UNUSED(calibrationMs);
+    return !enable;
+}
+
+bool Timer::IsRawTSCEnabled()
+{
+    return false;
+}
+
 void Timer::initializeTimerSystem()
 {
     timeBeginPeriod(1);
@@ -110,18 +136,116 @@ void Timer::shutdownTimerSystem()
 //------------------------------------------------------------------------
 // *** Standard OS Timer     
 
+// Raw ticks come from the monotonic clock in nanoseconds (mach_absolute_time units on
+// OS X), or from the TSC once Timer_TSCFrequency is set.
+volatile UInt64 Timer_TSCFrequency = 0;
+
+#if defined(OVR_OS_MAC)
+
+mach_timebase_info_data_t Timer_MachTimebase = { 0, 0 };
+
+// Also done by initializeTimerSystem, but static constructors may ask for the time earlier.
+static inline const mach_timebase_info_data_t& Timer_GetMachTimebase()
+{
+    if (Timer_MachTimebase.denom == 0)
+        mach_timebase_info(&Timer_MachTimebase);
+    return Timer_MachTimebase;
+}
+
+static inline UInt64 Timer_GetClockTicks()
+{
+    return mach_absolute_time();
+}
+static inline UInt64 Timer_GetClockFrequency()
+{
+    const mach_timebase_info_data_t& timebase = Timer_GetMachTimebase();
+    return (UInt64(1000000000) * timebase.denom) / timebase.numer;
+}
+static inline UInt64 Timer_GetClockNs()
+{
+    const mach_timebase_info_data_t& timebase = Timer_GetMachTimebase();
+    return (mach_absolute_time() * timebase.numer) / timebase.denom;
+}
+// The TSC is calibrated against the same clock.
+static inline UInt64 Timer_GetCalibrationNs()
+{
+    return Timer_GetClockNs();
+}
+
+#else
+
+static inline UInt64 Timer_GetClockNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (UInt64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+static inline UInt64 Timer_GetClockTicks()
+{
+    return Timer_GetClockNs();
+}
+static inline UInt64 Timer_GetClockFrequency()
+{
+    return 1000000000;
+}
+// Not slewed by NTP, so the TSC frequency comes out as the crystal's; the slewed
+// clock would count a correction in progress into it.
+static inline UInt64 Timer_GetCalibrationNs()
+{
+#if defined(CLOCK_MONOTONIC_RAW)
+    timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC_RAW, &ts) == 0)
+        return (UInt64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+    return Timer_GetClockNs();
+}
+
+#endif
+
+#if defined(OVR_TIMER_TSC)
+
+static inline UInt64 Timer_ReadTSC()
+{
+    UInt32 lo, hi;
+    __asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+    return ((UInt64)hi << 32) | lo;
+}
+
+static bool Timer_HasInvariantTSC()
+{
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx))
+        return false;
+    return (edx & (1 << 8)) != 0;
+}
+
+// The clock read on either side of the TSC, for the time it was read at.
+static void Timer_SampleTSC(UInt64* tsc, UInt64* ns)
+{
+    UInt64 before = Timer_GetCalibrationNs();
+    *tsc          = Timer_ReadTSC();
+    UInt64 after  = Timer_GetCalibrationNs();
+    *ns           = before + (after - before) / 2;
+}
+
+#endif
+
 UInt32 Timer::GetTicksMs()
 {
-    return (UInt32)(GetProfileTicks() / 1000);
+    return (UInt32)(Timer_GetClockNs() / 1000000);
 }
-// The profile ticks implementation is just fine for a normal timer.
+
+// Always the clock, which stays right across cores and sleep states whatever the TSC does.
 UInt64 Timer::GetTicks()
 {
-    return GetProfileTicks();
+    return Timer_GetClockNs() / 1000;
 }
 
 void Timer::initializeTimerSystem()
 {
+#if defined(OVR_OS_MAC)
+    Timer_GetMachTimebase();
+#endif
 }
 void Timer::shutdownTimerSystem()
 {
@@ -129,23 +253,50 @@ void Timer::shutdownTimerSystem()
 
 UInt64  Timer::GetRawTicks()
 {
-    // TODO: prefer rdtsc when available?
+#if defined(OVR_TIMER_TSC)
+    if (Timer_TSCFrequency)
+        return Timer_ReadTSC();
+#endif
+    return Timer_GetClockTicks();
+}
 
-    // Return microseconds.
-    struct timeval tv;
-    UInt64 result;
+UInt64 Timer::GetRawFrequency()
+{
+    UInt64 tscFrequency = Timer_TSCFrequency;
+    return tscFrequency ? tscFrequency : Timer_GetClockFrequency();
+}
 
-    gettimeofday(&tv, 0);
+bool Timer::EnableRawTSC(bool enable, unsigned calibrationMs)
+{
+    if (!enable)
+    {
+        Timer_TSCFrequency = 0;
+        return true;
+    }
+
+#if defined(OVR_TIMER_TSC)
+    if (!Timer_HasInvariantTSC())
+        return false;
 
-    result = (UInt64)tv.tv_sec * 1000000;
-    result += tv.tv_usec;
+    UInt64 tsc0, ns0, tsc1, ns1;
+    Timer_SampleTSC(&tsc0, &ns0);
+    usleep((calibrationMs ? calibrationMs : 1) * 1000);
+    Timer_SampleTSC(&tsc1, &ns1);
 
-    return result;
+    if ((ns1 <= ns0) || (tsc1 <= tsc0))
+        return false;
+
+    Timer_TSCFrequency = (UInt64)((double)(tsc1 - tsc0) * 1000000000.0 / (double)(ns1 - ns0) + 0.5);
+    return true;
+#else
+    OVR_UNUSED(calibrationMs);
+    return false;
+#endif
 }
 
-UInt64 Timer::GetRawFrequency()
+bool Timer::IsRawTSCEnabled()
 {
-    return MksPerSecond;
+    return Timer_TSCFrequency != 0;
 }
 
 #endif  // !OVR_OS_WIN32
@@ -48,7 +48,9 @@ public:
 
     // GetTicks returns general-purpose high resolution application timer value,
     // measured in microseconds (mks, or 1/1000000 of a second). The actual precision
-    // is system-specific and may be much lower, such as 1 ms.
+    // is system-specific and may be much lower, such as 1 ms. It never goes backwards;
+    // outside of Win32 it follows the monotonic system clock, which NTP may slew but
+    // never steps.
     static UInt64  OVR_STDCALL GetTicks();
 
     
@@ -73,6 +75,15 @@ public:
     static UInt64  OVR_STDCALL GetRawTicks();
     static UInt64  OVR_STDCALL GetRawFrequency();
 
+    // Outside of Win32, GetRawTicks reads the monotonic system clock; on x86 it can read the
+    // processor's time stamp counter instead, which costs a fraction of that. Only processors
+    // whose counter runs at a constant rate through power states (invariant TSC) qualify, and
+    // the frequency is calibrated against the clock for calibrationMs, blocking the caller.
+    // Returns false, with the clock still in use, when not supported. Raw ticks change units,
+    // so switch before taking any that are compared.
+    static bool    OVR_STDCALL EnableRawTSC(bool enable, unsigned calibrationMs = 50);
+    static bool    OVR_STDCALL IsRawTSCEnabled();
+
     
     // ***** Tick and time unit conversion.
 
@@ -84,7 +95,7 @@ public:
     // Convert Raw or frequency-unit ticks to seconds based on specified frequency.
     static inline double RawTicksToSeconds(UInt64 rawTicks, UInt64 rawFrequency)
     {
-        return static_cast<double>(rawTicks) * rawFrequency;
+        return static_cast<double>(rawTicks) / static_cast<double>(rawFrequency);
     }
 
 private:
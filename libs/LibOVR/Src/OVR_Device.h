@@ -24,6 +24,7 @@ otherwise accompanies this software in either electronic or hard copy form.
 
 #include "Kernel/OVR_Atomic.h"
 #include "Kernel/OVR_RefCount.h"
+#include "Kernel/OVR_Threads.h"
 
 namespace OVR {
 
@@ -67,6 +68,21 @@ private:
 };
 
 
+//-------------------------------------------------------------------------------------
+// ***** MessageHandlerStats
+
+// Time a handler has spent in OnMessage on the device thread, for finding out which of
+// several handlers on a device holds up the others. Reported by GetMessageHandlerStats.
+struct MessageHandlerStats
+{
+    MessageHandlerStats() : NumCalls(0), TotalTicks(0), MaxTicks(0) { }
+
+    UInt32  NumCalls;
+    UInt64  TotalTicks;  // Timer::GetTicks() units, microseconds.
+    UInt64  MaxTicks;    // Longest single call.
+};
+
+
 //-------------------------------------------------------------------------------------
 // ***** DeviceBase
 
@@ -74,6 +90,7 @@ private:
 // functionality:
 //   - Reports device type, manager, and associated parent (if any).
 //   - Supports installable message handlers, which are notified of device events.
+//     SetMessageHandler installs the main one, AddMessageHandler any number of others.
 //   - Device objects are created through DeviceHandle::CreateDevice or more commonly
 //     through DeviceEnumerator<>::CreateDevice.
 //   - Created devices are reference counted, starting with RefCount of 1.
@@ -99,6 +116,19 @@ public:
     virtual void            SetMessageHandler(MessageHandler* handler);
     virtual MessageHandler* GetMessageHandler() const;
 
+    // Additional handlers, called after the one set with SetMessageHandler in the order they
+    // were added. Changing them doesn't hold up the device thread beyond swapping a pointer.
+    // Add fails if the handler is already installed on this device either way.
+    // MessageHandler::RemoveHandlerFromDevices removes these as well.
+    virtual bool            AddMessageHandler(MessageHandler* handler);
+    virtual bool            RemoveMessageHandler(MessageHandler* handler);
+    virtual bool            HasMessageHandler(const MessageHandler* handler) const;
+
+    // Fills in stats for a handler installed on this device either way; false if it isn't.
+    virtual bool            GetMessageHandlerStats(const MessageHandler* handler,
+                                                   MessageHandlerStats* stats) const;
+    virtual void            ResetMessageHandlerStats();
+
     virtual DeviceType      GetType() const;
     virtual bool            GetDeviceInfo(DeviceInfo* info) const;
 
@@ -252,6 +282,14 @@ public:
     virtual DeviceEnumerator<> EnumerateDevicesEx(const DeviceEnumerationArgs& args) = 0;
 
 
+    // Affinity and scheduling of the DeviceManager thread, which reads the devices. On a busy
+    // host, a CPU of its own and real-time scheduling keep it from being held up for long
+    // enough to lose samples; see Thread::SetAffinityMask and Thread::SetSchedulingPolicy.
+    // Returns false if the system refused either.
+    virtual bool SetThreadScheduling(UInt64 affinityMask,
+                                     Thread::SchedulingPolicy policy = Thread::NormalScheduling,
+                                     int realTimePriority = 0) = 0;
+
     // Creates a new DeviceManager. Only one instance of DeviceManager should be created at a time.
     static   DeviceManager* Create();
 
@@ -445,6 +483,43 @@ private:
     void operator = (const SensorInfo&) { OVR_ASSERT(0); } // Assignment not allowed.
 };
 
+// SensorStatistics counts what came in from a SensorDevice, to tell samples lost on USB
+// from stalls on the host. The device sends a report every millisecond or so with up to
+// three samples and a millisecond timestamp; samples lost between reports show up as a
+// jump in the timestamp.
+struct SensorStatistics
+{
+    enum { JitterBuckets = 8 };
+
+    SensorStatistics() { Clear(); }
+
+    void Clear()
+    {
+        PacketsReceived = SamplesDelivered = SamplesMerged = 0;
+        GapsFilled = SamplesFilled = GapsDropped = TimestampWraps = 0;
+        ReportsDropped = 0;
+        for (int i = 0; i < JitterBuckets; i++)
+            JitterHistogram[i] = 0;
+        JitterMax = IntervalMax = 0;
+    }
+
+    UInt32  PacketsReceived;   // Sensor reports decoded.
+    UInt32  SamplesDelivered;  // MessageBodyFrames sent to handlers, including repeated ones.
+    UInt32  SamplesMerged;     // Samples past the three a report holds, only seen as a longer TimeDelta.
+    UInt32  GapsFilled;        // Timestamp jumps of up to 254 ms, covered by repeating the last sample.
+    UInt32  SamplesFilled;     // Milliseconds of samples those gaps were missing.
+    UInt32  GapsDropped;       // Larger jumps, passed over without filling.
+    UInt32  TimestampWraps;    // Times the 16-bit device timestamp went around.
+    UInt32  ReportsDropped;    // Reports read while the dispatch thread's queue was full.
+
+    // Host side timing. Jitter is how far the time between two reports arriving on the host
+    // is from the time the device stamped between them; the buckets count reports off by up
+    // to 0.25, 0.5, 1, 2, 4, 8 and 16 ms, and by more than that.
+    UInt32  JitterHistogram[JitterBuckets];
+    float   JitterMax;         // In seconds.
+    float   IntervalMax;       // Longest time between two reports on the host, in seconds.
+};
+
 
 //-------------------------------------------------------------------------------------
 // ***** SensorDevice
@@ -491,6 +566,22 @@ public:
     // Return the current sensor range settings for the device. These may not exactly
     // match the values applied through SetRange.
     virtual void       GetRange(SensorRange* range) const = 0;
+
+    // Counters since the device was opened or last reset. They are kept on the device
+    // thread and can be read from any thread without taking a lock.
+    virtual void       GetStatistics(SensorStatistics* stats) const = 0;
+    virtual void       ResetStatistics() = 0;
+
+    // Reports are read from the device on the DeviceManager thread, which by default also
+    // decodes them and calls the message handlers, for all sensors in turn. With several
+    // sensors, give each one a dispatch thread of its own to do that, so that a slow handler
+    // of one sensor doesn't hold up the others; processor, if not -1, is the CPU to keep it
+    // on. Handlers are then called on the dispatch thread. Decoding takes no lock shared
+    // between sensors, but the handlers are called under the handler lock they all share,
+    // so handlers that do real work still take turns; for SensorFusion, enable its fusion
+    // thread too, which takes integration out from under that lock.
+    virtual bool       SetDispatchThreadEnabled(bool enable, int processor = -1) = 0;
+    virtual bool       IsDispatchThreadEnabled() const = 0;
 };
 
 //-------------------------------------------------------------------------------------
@@ -17,6 +17,7 @@ otherwise accompanies this software in either electronic or hard copy form.
 #include "Kernel/OVR_Atomic.h"
 #include "Kernel/OVR_Log.h"
 #include "Kernel/OVR_System.h"
+#include "Kernel/OVR_Timer.h"
 
 namespace OVR {
 
@@ -217,6 +218,243 @@ Lock* MessageHandler::GetHandlerLock() const
 }
 
 
+//-------------------------------------------------------------------------------------
+// ***** MessageHandlerList
+
+MessageHandlerList::MessageHandlerList(DeviceBase* device)
+    : pDevice(device), pLock(MessageHandlerSharedLock.GetLockAddRef()), pSnapshot(0), Count(0),
+      CallDepth(0), pPrimaryStatsHandler(0)
+{
+}
+
+MessageHandlerList::~MessageHandlerList()
+{
+    RemoveAll();
+    {
+        Lock::Locker lockScope(pLock);
+        freeRetired_NTS();
+    }
+    MessageHandlerSharedLock.ReleaseLock(pLock);
+    pLock = 0;
+}
+
+MessageHandlerList::Snapshot* MessageHandlerList::newSnapshot(UPInt capacity)
+{
+    UPInt     size     = sizeof(Snapshot) + ((capacity > 1) ? (capacity - 1) * sizeof(Entry*) : 0);
+    Snapshot* snapshot = (Snapshot*)OVR_ALLOC(size);
+    snapshot->Count = 0;
+    return snapshot;
+}
+
+bool MessageHandlerList::Add(MessageHandler* handler)
+{
+    OVR_ASSERT(!handler ||
+               MessageHandlerImpl::FromHandler(handler)->pLock == pLock);
+    if (!handler)
+        return false;
+    return update(handler, 0, false);
+}
+
+bool MessageHandlerList::Remove(MessageHandler* handler)
+{
+    if (!handler)
+        return false;
+    return update(0, handler, false);
+}
+
+void MessageHandlerList::RemoveAll()
+{
+    update(0, 0, true);
+}
+
+bool MessageHandlerList::update(MessageHandler* add, const MessageHandler* remove, bool removeAll)
+{
+    Entry* entry = add ? new Entry(pDevice) : 0;
+
+    while (true)
+    {
+        // Everything is allocated before the handler lock is taken, the device thread only ever
+        // waits for a few pointers to be copied. If the list grew in the meantime, go again.
+        UPInt     capacity   = Count + 1;
+        Snapshot* snapshot   = newSnapshot(capacity);
+        Entry**   dropped    = (Entry**)OVR_ALLOC(capacity * sizeof(Entry*));
+        UPInt     numDropped = 0;
+        Snapshot* old        = 0;
+        bool      fits       = false;
+        bool      changed    = false;
+        bool      retired    = false;
+
+        {
+            Lock::Locker lockScope(pLock);
+            old  = pSnapshot;
+            fits = !old || (old->Count < capacity);
+
+            if (fits)
+            {
+                bool found = false;
+                for (UPInt i = 0; old && i < old->Count; i++)
+                {
+                    Entry*          oldEntry = old->Entries[i];
+                    MessageHandler* handler  = oldEntry->GetHandler();
+
+                    // Entries whose handler went through RemoveHandlerFromDevices are dropped as well.
+                    if (handler && (handler == add || handler == remove))
+                        found = true;
+                    if (!handler || removeAll || handler == remove)
+                        dropped[numDropped++] = oldEntry;
+                    else
+                        snapshot->Entries[snapshot->Count++] = oldEntry;
+                }
+                changed = add ? !found : (found || removeAll);
+            }
+
+            if (changed)
+            {
+                for (UPInt i = 0; i < numDropped; i++)
+                    dropped[i]->SetHandler_NTS(0);
+                if (add)
+                {
+                    entry->SetHandler_NTS(add);
+                    snapshot->Entries[snapshot->Count++] = entry;
+                }
+
+                Count = snapshot->Count;
+                AtomicOps<Snapshot*>::Store_Release(&pSnapshot, (snapshot->Count > 0) ? snapshot : 0);
+
+                // A handler changing the list from inside OnMessage; that dispatch is still walking old.
+                if (CallDepth > 0)
+                {
+                    if (old)
+                        RetiredSnapshots.PushBack(old);
+                    for (UPInt i = 0; i < numDropped; i++)
+                        RetiredEntries.PushBack(dropped[i]);
+                    retired = true;
+                }
+            }
+        }
+
+        if (changed)
+        {
+            if (!retired)
+            {
+                if (old)
+                    OVR_FREE(old);
+                for (UPInt i = 0; i < numDropped; i++)
+                    delete dropped[i];
+            }
+            if (snapshot->Count == 0)
+                OVR_FREE(snapshot);
+        }
+        else
+        {
+            OVR_FREE(snapshot);
+        }
+        OVR_FREE(dropped);
+
+        if (fits)
+        {
+            if (!changed && entry)
+                delete entry;
+            return changed;
+        }
+    }
+}
+
+bool MessageHandlerList::Contains(const MessageHandler* handler) const
+{
+    Lock::Locker lockScope(pLock);
+
+    const Snapshot* snapshot = pSnapshot;
+    for (UPInt i = 0; snapshot && i < snapshot->Count; i++)
+        if (snapshot->Entries[i]->GetHandler() == handler)
+            return true;
+    return false;
+}
+
+void MessageHandlerList::callTimed(MessageHandler* handler, const Message& msg, MessageHandlerStats* stats)
+{
+    UInt64 start = Timer::GetTicks();
+    handler->OnMessage(msg);
+    UInt64 ticks = Timer::GetTicks() - start;
+
+    stats->NumCalls++;
+    stats->TotalTicks += ticks;
+    if (ticks > stats->MaxTicks)
+        stats->MaxTicks = ticks;
+}
+
+void MessageHandlerList::Call(const Message& msg, MessageHandler* primary)
+{
+    if (primary)
+    {
+        if (primary != pPrimaryStatsHandler)
+        {
+            PrimaryStats         = MessageHandlerStats();
+            pPrimaryStatsHandler = primary;
+        }
+        callTimed(primary, msg, &PrimaryStats);
+    }
+
+    Snapshot* snapshot = AtomicOps<Snapshot*>::Load_Acquire(&pSnapshot);
+    if (!snapshot)
+        return;
+
+    CallDepth++;
+    for (UPInt i = 0; i < snapshot->Count; i++)
+    {
+        Entry*          entry   = snapshot->Entries[i];
+        MessageHandler* handler = entry->GetHandler();
+        if (handler && handler->SupportsMessageType(msg.Type))
+            callTimed(handler, msg, &entry->Stats);
+    }
+    if (--CallDepth == 0)
+        freeRetired_NTS();
+}
+
+void MessageHandlerList::freeRetired_NTS()
+{
+    for (UPInt i = 0; i < RetiredSnapshots.GetSize(); i++)
+        OVR_FREE(RetiredSnapshots[i]);
+    for (UPInt i = 0; i < RetiredEntries.GetSize(); i++)
+        delete RetiredEntries[i];
+    RetiredSnapshots.Clear();
+    RetiredEntries.Clear();
+}
+
+bool MessageHandlerList::GetStats(const MessageHandler* handler, const MessageHandler* primary,
+                                  MessageHandlerStats* stats) const
+{
+    Lock::Locker lockScope(pLock);
+
+    if (handler && handler == primary)
+    {
+        *stats = (primary == pPrimaryStatsHandler) ? PrimaryStats : MessageHandlerStats();
+        return true;
+    }
+
+    const Snapshot* snapshot = pSnapshot;
+    for (UPInt i = 0; snapshot && i < snapshot->Count; i++)
+    {
+        if (handler && snapshot->Entries[i]->GetHandler() == handler)
+        {
+            *stats = snapshot->Entries[i]->Stats;
+            return true;
+        }
+    }
+    return false;
+}
+
+void MessageHandlerList::ResetStats()
+{
+    Lock::Locker lockScope(pLock);
+
+    PrimaryStats = MessageHandlerStats();
+    const Snapshot* snapshot = pSnapshot;
+    for (UPInt i = 0; snapshot && i < snapshot->Count; i++)
+        snapshot->Entries[i]->Stats = MessageHandlerStats();
+}
+
+
 //-------------------------------------------------------------------------------------
 // ***** DeviceBase
    
@@ -249,6 +487,31 @@ MessageHandler* DeviceBase::GetMessageHandler() const
     return getDeviceCommon()->HandlerRef.GetHandler();
 }
 
+bool DeviceBase::AddMessageHandler(MessageHandler* handler)
+{
+    if (handler && getDeviceCommon()->HandlerRef.GetHandler() == handler)
+        return false;
+    return getDeviceCommon()->Handlers.Add(handler);
+}
+bool DeviceBase::RemoveMessageHandler(MessageHandler* handler)
+{
+    return getDeviceCommon()->Handlers.Remove(handler);
+}
+bool DeviceBase::HasMessageHandler(const MessageHandler* handler) const
+{
+    return handler && (getDeviceCommon()->HandlerRef.GetHandler() == handler ||
+                       getDeviceCommon()->Handlers.Contains(handler));
+}
+
+bool DeviceBase::GetMessageHandlerStats(const MessageHandler* handler, MessageHandlerStats* stats) const
+{
+    return getDeviceCommon()->Handlers.GetStats(handler, getDeviceCommon()->HandlerRef.GetHandler(), stats);
+}
+void DeviceBase::ResetMessageHandlerStats()
+{
+    getDeviceCommon()->Handlers.ResetStats();
+}
+
 DeviceType DeviceBase::GetType() const
 {
     return getDeviceCommon()->pCreateDesc->Type;
@@ -322,6 +585,18 @@ bool DeviceManagerImpl::Initialize(DeviceBase* parent)
     return true;
 }
 
+bool DeviceManagerImpl::SetThreadScheduling(UInt64 affinityMask, Thread::SchedulingPolicy policy,
+                                            int realTimePriority)
+{
+    Thread* thread = GetThread();
+    if (!thread)
+        return false;
+
+    bool affinitySet   = thread->SetAffinityMask(affinityMask);
+    bool schedulingSet = thread->SetSchedulingPolicy(policy, realTimePriority);
+    return affinitySet && schedulingSet;
+}
+
 void DeviceManagerImpl::Shutdown()
 {
     // Remove all device descriptors from list while the lock is held.
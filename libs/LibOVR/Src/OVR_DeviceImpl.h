@@ -22,6 +22,7 @@ otherwise accompanies this software in either electronic or hard copy form.
 #include "Kernel/OVR_System.h"
 
 #include "Kernel/OVR_Threads.h"
+#include "Kernel/OVR_Array.h"
 #include "OVR_ThreadCommandQueue.h"
 #include "OVR_HIDDevice.h"
 
@@ -84,6 +85,69 @@ private:
 };
 
 
+// Handlers added to a device with AddMessageHandler. Each has its own MessageHandlerRef,
+// so RemoveHandlerFromDevices and IsHandlerInstalled work as for the main handler.
+// The device thread goes through an immutable snapshot of the refs that is replaced as a
+// whole on every change (copy on write). Everything a change needs is allocated before the
+// handler lock is taken, and since dispatch happens under that lock the old snapshot can be
+// freed once it is released. If a handler changes the list from inside OnMessage, the old
+// snapshot is kept until that dispatch is done with it.
+class MessageHandlerList
+{
+public:
+    MessageHandlerList(DeviceBase* device);
+    ~MessageHandlerList();
+
+    bool Add(MessageHandler* handler);
+    bool Remove(MessageHandler* handler);
+    void RemoveAll();
+    bool Contains(const MessageHandler* handler) const;
+
+    // May count handlers that were removed through RemoveHandlerFromDevices,
+    // until the list changes again.
+    bool HasHandlers() const { return Count != 0; }
+
+    // Calls primary, then the added handlers, timing each. The handler lock must be held.
+    void Call(const Message& msg, MessageHandler* primary);
+
+    bool GetStats(const MessageHandler* handler, const MessageHandler* primary,
+                  MessageHandlerStats* stats) const;
+    void ResetStats();
+
+private:
+    struct Entry : public MessageHandlerRef, public NewOverrideBase
+    {
+        Entry(DeviceBase* device) : MessageHandlerRef(device) { }
+        MessageHandlerStats Stats;
+    };
+
+    struct Snapshot
+    {
+        UPInt  Count;
+        Entry* Entries[1];
+    };
+
+    static Snapshot* newSnapshot(UPInt capacity);
+    static void      callTimed(MessageHandler* handler, const Message& msg, MessageHandlerStats* stats);
+
+    // Adds add or takes out remove (or everything), dropping entries whose handler went away.
+    // Returns false if there was nothing to do.
+    bool             update(MessageHandler* add, const MessageHandler* remove, bool removeAll);
+    void             freeRetired_NTS();
+
+    DeviceBase*         pDevice;
+    Lock*               pLock;      // Shared handler lock, the same one as MessageHandlerRef's.
+    Snapshot* volatile  pSnapshot;  // Null when empty.
+    volatile UPInt      Count;
+    int                 CallDepth;  // Dispatches in progress on the thread holding pLock.
+    ArrayPOD<Snapshot*> RetiredSnapshots;
+    ArrayPOD<Entry*>    RetiredEntries;
+
+    MessageHandlerStats   PrimaryStats;
+    const MessageHandler* pPrimaryStatsHandler; // Handler PrimaryStats belong to.
+};
+
+
 
 //-------------------------------------------------------------------------------------
 
@@ -196,12 +260,19 @@ public:
     Ptr<DeviceCreateDesc>  pCreateDesc;
     Ptr<DeviceBase>        pParent;
     MessageHandlerRef      HandlerRef;
+    MessageHandlerList     Handlers;
 
     DeviceCommon(DeviceCreateDesc* createDesc, DeviceBase* device, DeviceBase* parent)
-        : RefCount(1), pCreateDesc(createDesc), pParent(parent), HandlerRef(device)
+        : RefCount(1), pCreateDesc(createDesc), pParent(parent), HandlerRef(device), Handlers(device)
     {
     }
 
+    // Both of these need the handler lock, HandlerRef.GetLock(), to be held.
+    bool HasMessageHandlers_NTS() const
+    { return HandlerRef.GetHandler() || Handlers.HasHandlers(); }
+    void CallMessageHandlers_NTS(const Message& msg)
+    { Handlers.Call(msg, HandlerRef.GetHandler()); }
+
     // Device reference counting delegates to Manager thread to actually kill devices.
     void DeviceAddRef();
     void DeviceRelease();
@@ -321,10 +392,15 @@ public:
     // Override to return ThreadCommandQueue implementation used to post commands
     // to the background device manager thread (that must be created by Initialize).
     virtual ThreadCommandQueue* GetThreadQueue() = 0;
+    // The same thread, for its affinity and scheduling.
+    virtual Thread*             GetThread() = 0;
 
 
     virtual DeviceEnumerator<> EnumerateDevicesEx(const DeviceEnumerationArgs& args);
 
+    virtual bool SetThreadScheduling(UInt64 affinityMask, Thread::SchedulingPolicy policy,
+                                     int realTimePriority);
+
 
     // 
     void AddFactory(DeviceFactory* factory)
@@ -337,11 +413,13 @@ public:
 
     void CallOnDeviceAdded(DeviceCreateDesc* desc)
     {
-        HandlerRef.Call(MessageDeviceStatus(Message_DeviceAdded, this, DeviceHandle(desc)));
+        Lock::Locker scopeLock(HandlerRef.GetLock());
+        CallMessageHandlers_NTS(MessageDeviceStatus(Message_DeviceAdded, this, DeviceHandle(desc)));
     }
     void CallOnDeviceRemoved(DeviceCreateDesc* desc)
     {
-        HandlerRef.Call(MessageDeviceStatus(Message_DeviceRemoved, this, DeviceHandle(desc)));
+        Lock::Locker scopeLock(HandlerRef.GetLock());
+        CallMessageHandlers_NTS(MessageDeviceStatus(Message_DeviceRemoved, this, DeviceHandle(desc)));
     }
 
     // Helper to access Common data for a device.
@@ -64,10 +64,10 @@ public:
         {
             Lock::Locker scopeLock(this->HandlerRef.GetLock());
 
-            if (this->HandlerRef.GetHandler())
+            if (this->HasMessageHandlers_NTS())
             {
                 MessageDeviceStatus status(handlerMessageType, this, OVR::DeviceHandle(this->pCreateDesc));
-                this->HandlerRef.GetHandler()->OnMessage(status);
+                this->CallMessageHandlers_NTS(status);
             }
         }
 
@@ -111,8 +111,9 @@ public:
     {   
         InternalDevice->SetHandler(NULL);
 
-        // Remove the handler, if any.
+        // Remove the handlers, if any.
         this->HandlerRef.SetHandler(0);
+        this->Handlers.RemoveAll();
 
         DeviceImpl<B>::pParent.Clear();
     }
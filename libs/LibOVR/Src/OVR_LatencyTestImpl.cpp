@@ -705,7 +705,7 @@ void LatencyTestDeviceImpl::onLatencyTestSamplesMessage(LatencyTestSamplesMessag
     // Call OnMessage() within a lock to avoid conflicts with handlers.
     Lock::Locker scopeLock(HandlerRef.GetLock());
   
-    if (HandlerRef.GetHandler())
+    if (HasMessageHandlers_NTS())
     {
         MessageLatencyTestSamples samples(this);
         for (UByte i = 0; i < s.SampleCount; i++)
@@ -713,7 +713,7 @@ void LatencyTestDeviceImpl::onLatencyTestSamplesMessage(LatencyTestSamplesMessag
             samples.Samples.PushBack(Color(s.Samples[i].Value[0], s.Samples[i].Value[1], s.Samples[i].Value[2]));
         }
 
-        HandlerRef.GetHandler()->OnMessage(samples);
+        CallMessageHandlers_NTS(samples);
     }
 }
 
@@ -727,14 +727,14 @@ void LatencyTestDeviceImpl::onLatencyTestColorDetectedMessage(LatencyTestColorDe
     // Call OnMessage() within a lock to avoid conflicts with handlers.
     Lock::Locker scopeLock(HandlerRef.GetLock());
 
-    if (HandlerRef.GetHandler())
+    if (HasMessageHandlers_NTS())
     {
         MessageLatencyTestColorDetected detected(this);
         detected.Elapsed = s.Elapsed;
         detected.DetectedValue = Color(s.TriggerValue[0], s.TriggerValue[1], s.TriggerValue[2]);
         detected.TargetValue = Color(s.TargetValue[0], s.TargetValue[1], s.TargetValue[2]);
 
-        HandlerRef.GetHandler()->OnMessage(detected);
+        CallMessageHandlers_NTS(detected);
     }
 }
 
@@ -748,12 +748,12 @@ void LatencyTestDeviceImpl::onLatencyTestStartedMessage(LatencyTestStartedMessag
     // Call OnMessage() within a lock to avoid conflicts with handlers.
     Lock::Locker scopeLock(HandlerRef.GetLock());
 
-    if (HandlerRef.GetHandler())
+    if (HasMessageHandlers_NTS())
     {
         MessageLatencyTestStarted started(this);
         started.TargetValue = Color(ts.TargetValue[0], ts.TargetValue[1], ts.TargetValue[2]);
 
-        HandlerRef.GetHandler()->OnMessage(started);
+        CallMessageHandlers_NTS(started);
     }
 }
 
@@ -767,11 +767,11 @@ void LatencyTestDeviceImpl::onLatencyTestButtonMessage(LatencyTestButtonMessage*
     // Call OnMessage() within a lock to avoid conflicts with handlers.
     Lock::Locker scopeLock(HandlerRef.GetLock());
 
-    if (HandlerRef.GetHandler())
+    if (HasMessageHandlers_NTS())
     {
         MessageLatencyTestButton button(this);
 
-        HandlerRef.GetHandler()->OnMessage(button);
+        CallMessageHandlers_NTS(button);
     }
 }
 
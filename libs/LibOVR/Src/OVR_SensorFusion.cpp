@@ -14,8 +14,10 @@ otherwise accompanies this software in either electronic or hard copy form.
 *************************************************************************************/
 
 #include "OVR_SensorFusion.h"
+#include "Kernel/OVR_Alg.h"
 #include "Kernel/OVR_Log.h"
 #include "Kernel/OVR_System.h"
+#include "Kernel/OVR_Timer.h"
 
 namespace OVR {
 
@@ -24,11 +26,17 @@ namespace OVR {
 
 SensorFusion::SensorFusion(SensorDevice* sensor)
   : Handler(getThis()), pDelegate(0),
-    Gain(0.05f), YawMult(1), EnableGravity(true), Stage(0), 
-	EnablePrediction(false), PredictionDT(0.03f),
-    FMag(10), FAccW(20), FAngV(20),
+    Gain(0.05f), YawMult(1), EnableGravity(true), Stage(0), SampleTime(0), 
+	EnablePrediction(false), PredictionDT(0.03f), pPredictor(&DefaultPredictor), Integrator(Integrator_AxisAngle),
+    FMag(10), FAccW(20), FAngV(20), AccelWindow(20), AngVelWindow(20),
+    TiltGravityEpsilon(0.4f), TiltAngVelEpsilon(0.1f), TiltPeriod(50),
     TiltCondCount(0), TiltErrorAngle(0), 
-    TiltErrorAxis(0,1,0),
+    TiltErrorAxis(0,1,0), Estimator(Estimator_Window), NumSteadySamples(0),
+    SampleIndex(0), NotifiedSampleTime(0), NumSampleWaiters(0),
+    WakeIndexArmed(false), WakeIndex(0), WakeTimeArmed(false), WakeTime(0), CancelCount(0),
+    FusionThreadSleeping(0), NumFusedSamples(0), NumDroppedSamples(0),
+    FusionLatencySum(0), FusionLatencyMax(0), FusionThreadAffinity(0),
+    FusionThreadPolicy(Thread::NormalScheduling), FusionThreadPriority(0),
     MagCondCount(0), MagReady(false), MagCalibrated(false), MagReferenced(false), 
     MagRefQ(0, 0, 0, 1), MagRefM(0), MagRefYaw(0), YawErrorAngle(0), MagRefDistance(0.15f),
     YawErrorCount(0), YawCorrectionInProgress(false), EnableYawCorrection(false)
@@ -40,6 +48,7 @@ SensorFusion::SensorFusion(SensorDevice* sensor)
 
 SensorFusion::~SensorFusion()
 {
+    SetFusionThreadEnabled(false);
 }
 
 
@@ -48,20 +57,11 @@ bool SensorFusion::AttachToSensor(SensorDevice* sensor)
     
     if (sensor != NULL)
     {
-        MessageHandler* pCurrentHandler = sensor->GetMessageHandler();
-
-        if (pCurrentHandler == &Handler)
+        if (sensor->HasMessageHandler(&Handler))
         {
             Reset();
             return true;
         }
-
-        if (pCurrentHandler != NULL)
-        {
-            OVR_DEBUG_LOG(
-                ("SensorFusion::AttachToSensor failed - sensor %p already has handler", sensor));
-            return false;
-        }
     }
 
     if (Handler.IsHandlerInstalled())
@@ -71,7 +71,20 @@ bool SensorFusion::AttachToSensor(SensorDevice* sensor)
 
     if (sensor != NULL)
     {
-        sensor->SetMessageHandler(&Handler);
+        // Share the sensor with whoever is its main handler already.
+        if (sensor->GetMessageHandler() != NULL)
+        {
+            if (!sensor->AddMessageHandler(&Handler))
+            {
+                OVR_DEBUG_LOG(
+                    ("SensorFusion::AttachToSensor failed - can't add handler to sensor %p", sensor));
+                return false;
+            }
+        }
+        else
+        {
+            sensor->SetMessageHandler(&Handler);
+        }
     }
 
     Reset();
@@ -79,6 +92,21 @@ bool SensorFusion::AttachToSensor(SensorDevice* sensor)
 }
 
 
+SensorState SensorFusion::GetSensorState() const
+{
+    SensorState state;
+
+    Lock::Locker lockScope(&FusionLock);
+    state.Orientation     = Q;
+    state.Predicted       = QP;
+    state.Acceleration    = A;
+    state.AngularVelocity = AngV;
+    state.SampleTime      = SampleTime;
+    state.PredictionDelta = EnablePrediction ? PredictionDT : 0.0f;
+    state.SampleIndex     = SampleIndex;
+
+    return state;
+}
 
 
 void SensorFusion::handleMessage(const MessageBodyFrame& msg)
@@ -102,11 +130,7 @@ void SensorFusion::handleMessage(const MessageBodyFrame& msg)
 
     // Apply the calibration parameters to raw mag
     if (HasMagCalibration())
-    {
-        mag.x += MagCalibrationMatrix.M[0][3];
-        mag.y += MagCalibrationMatrix.M[1][3];
-        mag.z += MagCalibrationMatrix.M[2][3];
-    }
+        mag = MagCalibrationMatrix.Transform(mag);
 
     // Provide external access to calibrated mag values
     // (if the mag is not calibrated, then the raw value is returned)
@@ -121,6 +145,7 @@ void SensorFusion::handleMessage(const MessageBodyFrame& msg)
 
     // Keep track of time
     Stage++;
+    SampleTime = Timer::TicksToSeconds(Timer::GetTicks());
     float currentTime  = Stage * deltaT; // Assumes uniform time spacing
 
     // Insert current sensor data into filter history
@@ -128,44 +153,40 @@ void SensorFusion::handleMessage(const MessageBodyFrame& msg)
     FAccW.AddElement(accWorld);
     FAngV.AddElement(angVel);
 
+    // Same mean age as the 10 sample window.
+    if (Stage == 1)
+        MagMean = mag;
+    else
+        MagMean += (mag - MagMean) * (2.0f / 11.0f);
+
     // Update orientation Q based on gyro outputs.  This technique is
     // based on direct properties of the angular velocity vector:
     // Its direction is the current rotation axis, and its magnitude
     // is the rotation rate (rad/sec) about that axis.  Our sensor
     // sampling rate is so fast that we need not worry about integral
     // approximation error (not yet, anyway).
-    if (angVelLength > 0.0f)
-    {
-        Vector3f     rotAxis      = angVel / angVelLength;  
-        float        halfRotAngle = angVelLength * deltaT * 0.5f;
-        float        sinHRA       = sin(halfRotAngle);
-        Quatf        deltaQ(rotAxis.x*sinHRA, rotAxis.y*sinHRA, rotAxis.z*sinHRA, cos(halfRotAngle));
+    // The first sample after a reset has no previous one to average with. Midpoint still
+    // turns while the rate drops to zero, so the step is only skipped when both are zero.
+    Vector3f lastAngVel = (Stage > 1) ? LastAngVel : angVel;
+    if (angVelLength > 0.0f || lastAngVel.LengthSq() > 0.0f)
+        Q = IntegrateGyro(Integrator, Q, angVel, lastAngVel, deltaT);
+    
+    LastAngVel = angVel;
 
-        Q =  Q * deltaQ;
+    // Note that both QP (the predicted future orientation) and Q (the current orientation) are both maintained.
+    // The predictor sees every sample, so that one with state keeps it up to date while prediction is off.
+    PredictorInput predictorInput;
+    predictorInput.Orientation   = Q;
+    predictorInput.AngVel        = angVel;
+    predictorInput.AngVelHistory = &FAngV;
+    predictorInput.DeltaT        = deltaT;
+    pPredictor->Update(predictorInput);
+
+    QP = EnablePrediction ? pPredictor->Predict(Q, PredictionDT) : Q;
 
-        // This is a simple predictive filter based only on extrapolating the smoothed, current angular velocity.
-        // Note that both QP (the predicted future orientation) and Q (the current orientation) are both maintained.
-        QP = Q;
-        if (EnablePrediction)
-        {
-            Vector3f angVelF  = FAngV.SavitzkyGolaySmooth8();
-            float    angVelFL = angVelF.Length();
-            
-            if (angVelFL > 0.001f)
-            {
-                Vector3f    rotAxisP = angVelF / angVelFL;  
-                float       halfRotAngleP = angVelFL * PredictionDT * 0.5f;
-                float       sinaHRAP  = sin(halfRotAngleP);
-                Quatf       deltaQP(rotAxisP.x*sinaHRAP, rotAxisP.y*sinaHRAP,
-                                    rotAxisP.z*sinaHRAP, cos(halfRotAngleP));
-                QP = Q * deltaQP;
-            }
-        }
-    }
-    
     // The quaternion magnitude may slowly drift due to numerical error,
     // so it is periodically normalized.
-    if (Stage % 5000 == 0)
+    if ((Stage % 5000 == 0) && (Integrator != Integrator_ExpMap))
         Q.Normalize();
     
     // Perform tilt correction using the accelerometer data. This enables 
@@ -174,24 +195,29 @@ void SensorFusion::handleMessage(const MessageBodyFrame& msg)
     if (EnableGravity)
     {
         // Correcting for tilt error by using accelerometer data
-        const float  gravityEpsilon = 0.4f;
-        const float  angVelEpsilon  = 0.1f; // Relatively slow rotation
-        const int    tiltPeriod     = 50;   // Req'd time steps of stability
+        const float  gravityEpsilon = TiltGravityEpsilon;
+        const float  angVelEpsilon  = TiltAngVelEpsilon; // Relatively slow rotation
+        const int    tiltPeriod     = TiltPeriod;        // Req'd time steps of stability
         const float  maxTiltError   = 0.05f;
         const float  minTiltError   = 0.01f;
 
         // This condition estimates whether the only measured acceleration is due to gravity 
         // (the Rift is not linearly accelerating).  It is often wrong, but tends to average
         // out well over time.
-        if ((fabs(accLength - 9.81f) < gravityEpsilon) &&
-            (angVelLength < angVelEpsilon))
+        bool steady = (fabs(accLength - 9.81f) < gravityEpsilon) &&
+                      (angVelLength < angVelEpsilon);
+        if (steady)
             TiltCondCount++;
         else
             TiltCondCount = 0;
     
         // After stable measurements have been taken over a sufficiently long period,
         // estimate the amount of tilt error and calculate the tilt axis for later correction.
-        if (TiltCondCount >= tiltPeriod)
+        if (Estimator == Estimator_Running)
+        {
+            updateRunningTilt(accWorld, steady);
+        }
+        else if (TiltCondCount >= tiltPeriod)
         {   // Update TiltErrorEstimate
             TiltCondCount = 0;
             // Use an average value to reduce noice (could alternatively use an LPF)
@@ -216,7 +242,9 @@ void SensorFusion::handleMessage(const MessageBodyFrame& msg)
         {
             if ((TiltErrorAngle > 0.4f)&&(Stage < 2000))
             {   // Tilt completely to correct orientation
-                Q = Quatf(TiltErrorAxis, -TiltErrorAngle) * Q;
+                Quatf deltaTilt(TiltErrorAxis, -TiltErrorAngle);
+                Q = deltaTilt * Q;
+                AccWMean = deltaTilt.Rotate(AccWMean);
                 TiltErrorAngle = 0.0f;
             }
             else 
@@ -227,7 +255,9 @@ void SensorFusion::handleMessage(const MessageBodyFrame& msg)
                 // This uses agressive correction steps while your head is moving fast
                 float deltaTiltAngle = -Gain*TiltErrorAngle*0.005f*(5.0f*angVelLength+1.0f);
                 // Incrementally "untilt" by a small step size
-                Q = Quatf(TiltErrorAxis, deltaTiltAngle) * Q;
+                Quatf deltaTilt(TiltErrorAxis, deltaTiltAngle);
+                Q = deltaTilt * Q;
+                AccWMean = deltaTilt.Rotate(AccWMean);
                 TiltErrorAngle += deltaTiltAngle;
             }
         }
@@ -255,7 +285,7 @@ void SensorFusion::handleMessage(const MessageBodyFrame& msg)
         // Use rotational invariance to bring reference mag value into global frame
         Vector3f grefmag = MagRefQ.Rotate(MagRefM);
         // Bring current (averaged) mag reading into global frame
-        Vector3f gmag = Q.Rotate(FMag.Mean());
+        Vector3f gmag = Q.Rotate(getMagMean());
         // Calculate the reference yaw in the global frame
         float gryaw = atan2(grefmag.x,grefmag.z);
         // Calculate the current yaw in the global frame
@@ -283,13 +313,429 @@ void SensorFusion::handleMessage(const MessageBodyFrame& msg)
             Q = Quatf(Vector3f(0.0f,1.0f,0.0f), -yawRotationStep * sign) * Q;
         }
     }
+
+    notifySampleWaiters();
+}
+
+
+// Initialized at load; a function static would be on first use, which MSVC2010 doesn't
+// guard, and several fusion threads can be in updateRunningTilt at once.
+static const float RunningMaxTiltError      = 0.05f;
+static const float RunningCosMaxTiltErrorSq = cos(RunningMaxTiltError) * cos(RunningMaxTiltError);
+
+void SensorFusion::updateRunningTilt(const Vector3f& accWorld, bool steady)
+{
+    const float minTiltError = 0.01f;
+
+    // Steady samples only, so that head motion doesn't pull the mean off gravity; same
+    // mean age as the window.
+    if (steady)
+    {
+        if (NumSteadySamples == 0)
+            AccWMean = accWorld;
+        else
+            AccWMean += (accWorld - AccWMean) * (2.0f / (AccelWindow + 1));
+        NumSteadySamples++;
+    }
+
+    if (NumSteadySamples < (UInt32)TiltPeriod)
+        return;
+
+    // As the window estimate does, but from where the mean is now. A correction under way
+    // keeps being measured until it is done; a new one waits until the error is large,
+    // which is told from the squared cosine without any trig.
+    float    lengthSq  = AccWMean.LengthSq();
+    bool     largeTilt = (AccWMean.y <= 0.0f) || (AccWMean.y * AccWMean.y < RunningCosMaxTiltErrorSq * lengthSq);
+
+    if (largeTilt || (TiltErrorAngle > minTiltError))
+    {
+        Vector3f xzAcc = Vector3f(AccWMean.x, 0.0f, AccWMean.z);
+        TiltErrorAngle = acos(Alg::Clamp(AccWMean.y / sqrt(lengthSq), -1.0f, 1.0f));
+        if (xzAcc.LengthSq() > 0.0f)
+            TiltErrorAxis = Vector3f(xzAcc.z, 0.0f, -xzAcc.x).Normalized();
+    }
+}
+
+
+//-------------------------------------------------------------------------------------
+// ***** Gyro integration
+
+// Half angles at 1kHz stay far below this unless a sample covers a long gap; beyond it the
+// series below lose accuracy and sin and cos are used instead.
+static const float IntegratorSeriesLimit = 0.5f;
+
+// Taylor polynomials of sin and cos, good to float precision for |x| < IntegratorSeriesLimit.
+static inline float seriesSin(float x)
+{
+    float x2 = x * x;
+    return x * (1.0f - x2 * (1.0f / 6.0f) * (1.0f - x2 * (1.0f / 20.0f) * (1.0f - x2 * (1.0f / 42.0f))));
+}
+
+static inline float seriesCos(float x)
+{
+    float x2 = x * x;
+    return 1.0f - x2 * 0.5f * (1.0f - x2 * (1.0f / 12.0f) * (1.0f - x2 * (1.0f / 30.0f)));
+}
+
+Quatf SensorFusion::IntegrateGyro(GyroIntegrator integrator, const Quatf& q, const Vector3f& angVel,
+                                  const Vector3f& lastAngVel, float deltaT)
+{
+    switch (integrator)
+    {
+    case Integrator_Midpoint:
+        {
+            Vector3f meanAngVel = (angVel + lastAngVel) * 0.5f;
+            float    length     = meanAngVel.Length();
+            if (length <= 0.0f)
+                return q;
+
+            float    halfRotAngle = length * deltaT * 0.5f;
+            float    sinHRA, cosHRA;
+            if (halfRotAngle < IntegratorSeriesLimit)
+            {
+                sinHRA = seriesSin(halfRotAngle);
+                cosHRA = seriesCos(halfRotAngle);
+            }
+            else
+            {
+                sinHRA = sin(halfRotAngle);
+                cosHRA = cos(halfRotAngle);
+            }
+
+            Vector3f v = meanAngVel * (sinHRA / length);
+            return q * Quatf(v.x, v.y, v.z, cosHRA);
+        }
+
+    case Integrator_ExpMap:
+        {
+            // exp of half the rotation vector: (v sin|v| / |v|, cos|v|), with both
+            // factors as series in |v|^2.
+            Vector3f v     = angVel * (deltaT * 0.5f);
+            float    theta2 = v.LengthSq();
+            if (theta2 >= IntegratorSeriesLimit * IntegratorSeriesLimit)
+                return IntegrateGyro(Integrator_AxisAngle, q, angVel, lastAngVel, deltaT).Normalized();
+
+            float sinc = 1.0f - theta2 * (1.0f / 6.0f) * (1.0f - theta2 * (1.0f / 20.0f));
+            float cosT = 1.0f - theta2 * 0.5f * (1.0f - theta2 * (1.0f / 12.0f));
+            v *= sinc;
+            return (q * Quatf(v.x, v.y, v.z, cosT)).Normalized();
+        }
+
+    default:
+        {
+            float angVelLength = angVel.Length();
+            if (angVelLength <= 0.0f)
+                return q;
+
+            Vector3f     rotAxis      = angVel / angVelLength;  
+            float        halfRotAngle = angVelLength * deltaT * 0.5f;
+            float        sinHRA       = sin(halfRotAngle);
+            Quatf        deltaQ(rotAxis.x*sinHRA, rotAxis.y*sinHRA, rotAxis.z*sinHRA, cos(halfRotAngle));
+
+            return q * deltaQ;
+        }
+    }
+}
+
+
+//-------------------------------------------------------------------------------------
+// ***** Waiting for samples
+
+bool SensorFusion::WaitForSample(SensorSubscriber& subscriber, SensorState* state, unsigned timeoutMs)
+{
+    {
+        Mutex::Locker lockScope(&SampleWaitMutex);
+
+        UInt32 decimation = (subscriber.Decimation > 0) ? subscriber.Decimation : 1;
+        UInt32 waitIndex  = subscriber.Started ? subscriber.LastSampleIndex + decimation
+                                               : SampleIndex + 1;
+
+        if (!waitForSampleLocked(true, waitIndex, 0, timeoutMs))
+            return false;
+
+        // Whatever came in after the sample we waited for went by unseen.
+        subscriber.NumMissed      += SampleIndex - waitIndex;
+        subscriber.LastSampleIndex = SampleIndex;
+        subscriber.Started         = true;
+    }
+
+    if (state)
+        *state = GetSensorState();
+    return true;
+}
+
+bool SensorFusion::WaitForSampleAfter(double time, SensorState* state, unsigned timeoutMs)
+{
+    {
+        Mutex::Locker lockScope(&SampleWaitMutex);
+
+        if (!waitForSampleLocked(false, 0, time, timeoutMs))
+            return false;
+    }
+
+    if (state)
+        *state = GetSensorState();
+    return true;
+}
+
+void SensorFusion::CancelWaits()
+{
+    Mutex::Locker lockScope(&SampleWaitMutex);
+    CancelCount++;
+    SampleWaitCondition.NotifyAll();
+}
+
+bool SensorFusion::waitForSampleLocked(bool armIndex, UInt32 waitIndex, double waitTime, unsigned timeoutMs)
+{
+    UInt32 cancelCount = CancelCount;
+    UInt32 startMs     = Timer::GetTicksMs();
+
+    while (true)
+    {
+        // Indices are compared through their difference so that wrapping around is fine.
+        bool ready = armIndex ? ((SInt32)(SampleIndex - waitIndex) >= 0)
+                              : (NotifiedSampleTime > waitTime);
+        if (ready)
+            return true;
+        if (CancelCount != cancelCount)
+            return false;
+
+        unsigned delay = OVR_WAIT_INFINITE;
+        if (timeoutMs != OVR_WAIT_INFINITE)
+        {
+            UInt32 elapsedMs = Timer::GetTicksMs() - startMs;
+            if (elapsedMs >= timeoutMs)
+                return false;
+            delay = timeoutMs - elapsedMs;
+        }
+
+        // Leave word of what we are waiting for; the earliest of all waiters is kept.
+        if (armIndex)
+        {
+            if (!WakeIndexArmed || (SInt32)(waitIndex - WakeIndex) < 0)
+                WakeIndex = waitIndex;
+            WakeIndexArmed = true;
+        }
+        else
+        {
+            if (!WakeTimeArmed || waitTime < WakeTime)
+                WakeTime = waitTime;
+            WakeTimeArmed = true;
+        }
+
+        NumSampleWaiters++;
+        SampleWaitCondition.Wait(&SampleWaitMutex, delay);
+        NumSampleWaiters--;
+    }
+}
+
+void SensorFusion::notifySampleWaiters()
+{
+    Mutex::Locker lockScope(&SampleWaitMutex);
+
+    SampleIndex++;
+    NotifiedSampleTime = SampleTime;
+
+    if (NumSampleWaiters == 0)
+        return;
+
+    bool wake = (WakeIndexArmed && (SInt32)(SampleIndex - WakeIndex) >= 0) ||
+                (WakeTimeArmed  && NotifiedSampleTime > WakeTime);
+    if (wake)
+    {
+        // Everybody wakes up, the ones this sample isn't for leave word again.
+        WakeIndexArmed = false;
+        WakeTimeArmed  = false;
+        SampleWaitCondition.NotifyAll();
+    }
+}
+
+
+//-------------------------------------------------------------------------------------
+// ***** Fusion thread
+
+bool SensorFusion::SetFusionThreadEnabled(bool enable, int processor)
+{
+    if (enable)
+    {
+        if (pFusionThread)
+            return true;
+
+        Ptr<FusionThread> thread = *new FusionThread(this, processor);
+        if (FusionThreadAffinity)
+            thread->SetAffinityMask(FusionThreadAffinity);
+        thread->SetSchedulingPolicy(FusionThreadPolicy, FusionThreadPriority);
+        if (!thread->Start())
+        {
+            OVR_DEBUG_LOG(("SensorFusion::SetFusionThreadEnabled failed - can't start thread"));
+            return false;
+        }
+
+        Lock::Locker lockScope(Handler.GetHandlerLock());
+        pFusionThread = thread;
+        return true;
+    }
+
+    if (!pFusionThread)
+        return true;
+
+    // The device thread keeps queueing while the fusion thread winds down; the thread
+    // integrates what it finds before it exits.
+    pFusionThread->SetExitFlag(true);
+    FusionThreadEvent.SetEvent();
+    while (!pFusionThread->IsFinished())
+        Thread::MSleep(1);
+
+    // The device thread queues under the handler lock, so nothing can be added while the
+    // rest is integrated here, and after that samples are integrated in order again.
+    Lock::Locker lockScope(Handler.GetHandlerLock());
+    pFusionThread.Clear();
+    drainSampleQueue();
+    return true;
+}
+
+bool SensorFusion::SetFusionThreadScheduling(UInt64 affinityMask, Thread::SchedulingPolicy policy,
+                                             int realTimePriority)
+{
+    FusionThreadAffinity = affinityMask;
+    FusionThreadPolicy   = policy;
+    FusionThreadPriority = realTimePriority;
+
+    if (!pFusionThread)
+        return true;
+
+    bool affinitySet   = !affinityMask || pFusionThread->SetAffinityMask(affinityMask);
+    bool schedulingSet = pFusionThread->SetSchedulingPolicy(policy, realTimePriority);
+    return affinitySet && schedulingSet;
+}
+
+FusionThreadStats SensorFusion::GetFusionThreadStats() const
+{
+    FusionThreadStats stats;
+
+    Lock::Locker lockScope(&FusionLock);
+    stats.NumSamples     = NumFusedSamples;
+    stats.NumDropped     = NumDroppedSamples.Load_Acquire();
+    stats.QueueHighWater = SampleQueue.GetHighWater();
+    stats.LatencyMean    = NumFusedSamples ? (float)(FusionLatencySum / NumFusedSamples) : 0.0f;
+    stats.LatencyMax     = FusionLatencyMax;
+    return stats;
+}
+
+void SensorFusion::ResetFusionThreadStats()
+{
+    Lock::Locker lockScope(&FusionLock);
+    NumFusedSamples   = 0;
+    NumDroppedSamples.Store_Release(0);
+    FusionLatencySum  = 0;
+    FusionLatencyMax  = 0;
+    SampleQueue.ResetHighWater();
+}
+
+void SensorFusion::OnMessage(const MessageBodyFrame& msg)
+{
+    OVR_ASSERT(!IsAttachedToSensor());
+
+    // Queued under the handler lock, as a device would, so that SetFusionThreadEnabled
+    // can stop the thread in between.
+    if (pFusionThread)
+    {
+        Lock::Locker handlerScope(Handler.GetHandlerLock());
+        queueSample(msg);
+        return;
+    }
+
+    // Readers take FusionLock, and may well be on other threads while this is fed.
+    Lock::Locker lockScope(&FusionLock);
+    handleMessage(msg);
+}
+
+void SensorFusion::queueSample(const MessageBodyFrame& msg)
+{
+    QueuedSample sample;
+    sample.Frame       = msg;
+    sample.QueuedTicks = Timer::GetTicks();
+
+    if (!SampleQueue.PushBack(sample))
+    {
+        NumDroppedSamples.Increment_NoSync();
+        return;
+    }
+
+    // Only go through the event when the fusion thread is asleep; most of the time it
+    // is still busy with the previous sample.
+    if (FusionThreadSleeping.CompareAndSet_Sync(1, 0))
+        FusionThreadEvent.SetEvent();
+}
+
+void SensorFusion::drainSampleQueue()
+{
+    QueuedSample sample;
+
+    while (SampleQueue.PopFront(&sample))
+    {
+        {
+            Lock::Locker lockScope(&FusionLock);
+
+            handleMessage(sample.Frame);
+
+            float latency = (float)Timer::TicksToSeconds(Timer::GetTicks() - sample.QueuedTicks);
+            NumFusedSamples++;
+            FusionLatencySum += latency;
+            if (latency > FusionLatencyMax)
+                FusionLatencyMax = latency;
+        }
+
+        // Only a delegate needs the handler lock, and only for as long as it runs.
+        if (pDelegate)
+        {
+            Lock::Locker handlerScope(Handler.GetHandlerLock());
+            if (pDelegate)
+                pDelegate->OnMessage(sample.Frame);
+        }
+    }
+}
+
+int SensorFusion::FusionThread::Run()
+{
+    SetThreadName("OVR::SensorFusion");
+
+    while (!GetExitFlag())
+    {
+        pFusion->drainSampleQueue();
+
+        // Announce the sleep before looking at the queue once more; the device thread
+        // looks at the flag after queueing, so one of the two sees the other's sample.
+        pFusion->FusionThreadEvent.ResetEvent();
+        pFusion->FusionThreadSleeping.Exchange_Sync(1);
+        if (pFusion->SampleQueue.IsEmpty() && !GetExitFlag())
+            pFusion->FusionThreadEvent.Wait();
+        pFusion->FusionThreadSleeping.Exchange_Sync(0);
+    }
+
+    pFusion->drainSampleQueue();
+    return 0;
+}
+
+
+void SensorFusion::SetFilterWindows(int accelWindow, int angVelWindow)
+{
+    // SavitzkyGolayDerivative12 needs 12 samples; SensorFilter holds 100 at most.
+    accelWindow  = Alg::Clamp(accelWindow, 12, 100);
+    angVelWindow = Alg::Clamp(angVelWindow, 12, 100);
+
+    Lock::Locker lockScope(&FusionLock);
+    AccelWindow  = accelWindow;
+    AngVelWindow = angVelWindow;
+    FAccW        = SensorFilter(accelWindow);
+    FAngV        = SensorFilter(angVelWindow);
 }
 
 
 void SensorFusion::SetMagReference(const Quatf& q) 
 {
         MagRefQ = q;
-        MagRefM = FMag.Mean();
+        MagRefM = getMagMean();
 
         float pitch, roll, yaw;
         Q.GetEulerAngles<Axis_X, Axis_Z, Axis_Y>(&pitch, &roll, &yaw);
@@ -317,8 +763,18 @@ SensorFusion::BodyFrameHandler::~BodyFrameHandler()
 
 void SensorFusion::BodyFrameHandler::OnMessage(const Message& msg)
 {
+    // With the fusion thread running, it does the rest, delegate included.
+    if (msg.Type == Message_BodyFrame && pFusion->pFusionThread)
+    {
+        pFusion->queueSample(static_cast<const MessageBodyFrame&>(msg));
+        return;
+    }
+
     if (msg.Type == Message_BodyFrame)
+    {
+        Lock::Locker lockScope(&pFusion->FusionLock);
         pFusion->handleMessage(static_cast<const MessageBodyFrame&>(msg));
+    }
     if (pFusion->pDelegate)
         pFusion->pDelegate->OnMessage(msg);
 }
@@ -19,9 +19,66 @@ otherwise accompanies this software in either electronic or hard copy form.
 
 #include "OVR_Device.h"
 #include "OVR_SensorFilter.h"
+#include "OVR_SensorPredictor.h"
+#include "Kernel/OVR_Threads.h"
+#include "Kernel/OVR_SPSCQueue.h"
 
 namespace OVR {
 
+//-------------------------------------------------------------------------------------
+// ***** SensorState
+
+// SensorState is a snapshot of the SensorFusion state taken under a single lock,
+// so that the orientation, prediction and raw readings all come from the same sample.
+struct SensorState
+{
+    SensorState() : SampleTime(0), PredictionDelta(0), SampleIndex(0) { }
+
+    Quatf       Orientation;      // Current accumulated orientation.
+    Quatf       Predicted;        // Predicted orientation; same as Orientation if prediction is off.
+    Vector3f    Acceleration;     // Last acceleration reading, in m/s^2.
+    Vector3f    AngularVelocity;  // Last angular velocity reading, in rad/s.
+    double      SampleTime;       // Timer::GetTicks() in seconds when the last sample was integrated, 0 if none yet.
+    float       PredictionDelta;  // Seconds of prediction applied to Predicted, 0 if disabled.
+    UInt32      SampleIndex;      // Number of samples integrated since the SensorFusion was created.
+};
+
+
+//-------------------------------------------------------------------------------------
+// ***** SensorSubscriber
+
+// SensorSubscriber keeps track of where one consumer is in the stream of fused samples,
+// for SensorFusion::WaitForSample. Use one per waiting thread; a Decimation of N only
+// wakes the thread up on every Nth sample, so it can run at its own rate.
+struct SensorSubscriber
+{
+    SensorSubscriber(unsigned decimation = 1)
+        : Decimation(decimation), LastSampleIndex(0), Started(false), NumMissed(0) { }
+
+    unsigned    Decimation;
+    UInt32      LastSampleIndex;  // Sample the subscriber was last woken up for.
+    bool        Started;          // False until the first wait; that one returns on the next sample.
+    UInt32      NumMissed;        // Samples beyond the decimation that went by while the subscriber was busy.
+};
+
+
+//-------------------------------------------------------------------------------------
+// ***** FusionThreadStats
+
+// How the fusion thread has kept up since it was started or its stats were reset.
+struct FusionThreadStats
+{
+    FusionThreadStats()
+        : NumSamples(0), NumDropped(0), QueueHighWater(0), LatencyMean(0), LatencyMax(0) { }
+
+    UInt32      NumSamples;       // Samples integrated on the fusion thread.
+    UInt32      NumDropped;       // Samples the device thread threw away because the queue was full.
+    UInt32      QueueHighWater;   // Most samples that were waiting in the queue at once.
+    float       LatencyMean;      // Seconds from the device thread queueing a sample to it being integrated.
+    float       LatencyMax;
+};
+
+
 //-------------------------------------------------------------------------------------
 // ***** SensorFusion
 
@@ -44,6 +101,7 @@ public:
     // Attaches this SensorFusion to a sensor device, from which it will receive
     // notification messages. If a sensor is attached, manual message notification
     // is not necessary. Calling this function also resets SensorFusion state.
+    // If the sensor already has a message handler, the fusion is added next to it.
     bool        AttachToSensor(SensorDevice* sensor);
 
     // Returns true if this Sensor fusion object is attached to a sensor.
@@ -61,9 +119,11 @@ public:
     // Yaw correction is currently working (forcing a corrective yaw rotation)
     bool        IsYawCorrectionInProgress() const { return YawCorrectionInProgress;}
 
-    // Store the calibration matrix for the magnetometer
+    // Store the calibration matrix for the magnetometer. Raw readings are transformed by it:
+    // the upper 3x3 corrects their scale, the last column offsets them.
     void        SetMagCalibration(const Matrix4f& m)
     {
+        Lock::Locker lockScope(&FusionLock);
         MagCalibrationMatrix = m;
         MagCalibrated = true;
     }
@@ -96,47 +156,84 @@ public:
     void        SetMagRefDistance(const float d) { MagRefDistance = d; }
 
     // Notifies SensorFusion object about a new BodyFrame message from a sensor.
-    // Should be called by user if not attaching to a sensor.
-    void        OnMessage(const MessageBodyFrame& msg)
-    {
-        OVR_ASSERT(!IsAttachedToSensor());
-        handleMessage(msg);
-    }
+    // Should be called by user if not attaching to a sensor. With the fusion thread
+    // enabled, the sample is queued for it; call from one thread at a time then.
+    void        OnMessage(const MessageBodyFrame& msg);
 
     // Obtain the current accumulated orientation.
     Quatf       GetOrientation() const
     {
-        Lock::Locker lockScope(Handler.GetHandlerLock());
+        Lock::Locker lockScope(&FusionLock);
         return Q;
     }    
     Quatf       GetPredictedOrientation() const
     {
-        Lock::Locker lockScope(Handler.GetHandlerLock());
+        Lock::Locker lockScope(&FusionLock);
         return QP;
     }    
     // Obtain the last absolute acceleration reading, in m/s^2.
     Vector3f    GetAcceleration() const
     {
-        Lock::Locker lockScope(Handler.GetHandlerLock());
+        Lock::Locker lockScope(&FusionLock);
         return A;
     }
     
     // Obtain the last angular velocity reading, in rad/s.
     Vector3f    GetAngularVelocity() const
     {
-        Lock::Locker lockScope(Handler.GetHandlerLock());
+        Lock::Locker lockScope(&FusionLock);
         return AngV;
     }
+
+    // Obtain orientation, prediction and the last readings together, consistent
+    // with each other. Prefer this to calling the individual getters in a row.
+    SensorState GetSensorState() const;
+
+    // Waiting for samples, instead of polling the getters. WaitForSample blocks until the
+    // subscriber's next sample has been integrated, WaitForSampleAfter until the first one
+    // integrated after the given time (Timer::GetTicks() in seconds). Only waiters whose sample
+    // has come are woken up. Both fill in state when not null and return false on timeout
+    // or when CancelWaits is called.
+    bool        WaitForSample(SensorSubscriber& subscriber, SensorState* state = 0,
+                              unsigned timeoutMs = OVR_WAIT_INFINITE);
+    bool        WaitForSampleAfter(double time, SensorState* state = 0,
+                                   unsigned timeoutMs = OVR_WAIT_INFINITE);
+
+    // Wakes up all waiting threads with a false return, so they can shut down.
+    void        CancelWaits();
+
+    // Moves integration of the attached sensor's samples to a thread of its own. The device
+    // thread then only copies each sample into a wait-free queue and goes back to reading the
+    // sensor; the fusion thread integrates it, notifies waiters and calls the delegate handler,
+    // with the handler lock held as on the device thread. If the fusion thread falls behind
+    // by a whole queue, new samples are dropped and counted rather than holding up the device.
+    // Samples passed to OnMessage by hand go through the queue the same way.
+    // Integration only takes the fusion's own lock, not the handler lock all devices share,
+    // so fusions of several sensors run side by side. processor, if not -1, is the CPU to
+    // run the thread on.
+    bool        SetFusionThreadEnabled(bool enable, int processor = -1);
+    bool        IsFusionThreadEnabled() const { return pFusionThread.GetPtr() != 0; }
+
+    FusionThreadStats GetFusionThreadStats() const;
+    void        ResetFusionThreadStats();
+
+    // Affinity and scheduling of the fusion thread, now if it runs and whenever it starts;
+    // a non-zero affinityMask takes the place of SetFusionThreadEnabled's processor. Returns
+    // false if the system refused either; see Thread::SetSchedulingPolicy.
+    bool        SetFusionThreadScheduling(UInt64 affinityMask,
+                                          Thread::SchedulingPolicy policy = Thread::NormalScheduling,
+                                          int realTimePriority = 0);
+
     // Obtain the last magnetometer reading, in Gauss
     Vector3f    GetMagnetometer() const
     {
-        Lock::Locker lockScope(Handler.GetHandlerLock());
+        Lock::Locker lockScope(&FusionLock);
         return Mag;
     }
     // Obtain the raw magnetometer reading, in Gauss (uncalibrated!)
     Vector3f    GetRawMagnetometer() const
     {
-        Lock::Locker lockScope(Handler.GetHandlerLock());
+        Lock::Locker lockScope(&FusionLock);
         return RawMag;
     }
 
@@ -152,11 +249,14 @@ public:
     {
         MagReferenced = false;
 
-        Lock::Locker lockScope(Handler.GetHandlerLock());
+        Lock::Locker lockScope(&FusionLock);
         Q  = Quatf();
         QP = Quatf();
 
         Stage = 0;
+        SampleTime = 0;
+        NumSteadySamples = 0;
+        pPredictor->Reset();
     }
 
     // Configuration
@@ -171,8 +271,28 @@ public:
     float       GetYawMultiplier() const  { return YawMult; }
     void        SetYawMultiplier(float y) { YawMult = y; }
 
+    // Tilt correction measures the tilt once the acceleration has stayed within gravityEpsilon
+    // (m/s^2) of gravity, and the rate below angVelEpsilon (rad/s), for period samples in a
+    // row. The defaults are 0.4, 0.1 and 50.
+    void        SetTiltThresholds(float gravityEpsilon, float angVelEpsilon, int period)
+    {
+        TiltGravityEpsilon = gravityEpsilon;
+        TiltAngVelEpsilon  = angVelEpsilon;
+        TiltPeriod         = period;
+    }
+    float       GetTiltGravityEpsilon() const { return TiltGravityEpsilon; }
+    float       GetTiltAngVelEpsilon() const  { return TiltAngVelEpsilon; }
+    int         GetTiltPeriod() const         { return TiltPeriod; }
+
+    // Number of samples averaged for the tilt estimate, and kept of the rate for prediction,
+    // between 12 and 100; both default to 20. Changing them starts the windows over.
+    void        SetFilterWindows(int accelWindow, int angVelWindow);
+    int         GetAccelWindow() const        { return AccelWindow; }
+    int         GetAngVelWindow() const       { return AngVelWindow; }
+
     void        SetDelegateMessageHandler(MessageHandler* handler)
     { pDelegate = handler; }
+    MessageHandler* GetDelegateMessageHandler() const { return pDelegate; }
 
 	// Prediction functions.
     // Prediction delta specifes how much prediction should be applied in seconds; it should in
@@ -183,6 +303,63 @@ public:
 	void		SetPredictionEnabled(bool enable = true)    { EnablePrediction = enable; }    
 	bool		IsPredictionEnabled()                       { return EnablePrediction; }
 
+    // The predictor behind GetPredictedOrientation; 0 goes back to the default, a
+    // ConstantVelocityPredictor. The fusion doesn't own it, it has to outlive the fusion
+    // or be replaced first.
+    void        SetPredictor(SensorPredictor* predictor)
+    {
+        Lock::Locker lockScope(&FusionLock);
+        pPredictor = predictor ? predictor : &DefaultPredictor;
+        pPredictor->Reset();
+    }
+    SensorPredictor* GetPredictor() const                   { return pPredictor; }
+
+    // How the gyro rate is integrated into the orientation each sample.
+    enum GyroIntegrator
+    {
+        // First order: rotates by the current rate about its axis, with sin and cos per
+        // sample; Q is normalized every 5000 samples. The default.
+        Integrator_AxisAngle,
+        // Second order: rotates by the mean of the current and the previous rate, with
+        // polynomial sin and cos.
+        Integrator_Midpoint,
+        // Series expansion of the exponential map of the current rate, no trig and no
+        // square root for the axis; Q is normalized every sample.
+        Integrator_ExpMap,
+        Integrator_Count
+    };
+
+    GyroIntegrator GetGyroIntegrator() const            { return Integrator; }
+    void        SetGyroIntegrator(GyroIntegrator integrator) { Integrator = integrator; }
+
+    // How tilt and yaw correction average the accelerometer and the magnetometer.
+    enum CorrectionEstimator
+    {
+        // Tilt is measured from the mean of the last AccelWindow samples each time TiltPeriod
+        // steady samples have gone by, yaw from the mean of the last 10 magnetometer readings.
+        // The default.
+        Estimator_Window,
+        // Exponentially weighted means of the same age, updated every sample, the gravity
+        // one from steady samples only. Tilt is measured and corrected every sample once
+        // TiltPeriod steady samples are in; the mean turns with each correction. Opt in
+        // with SetCorrectionEstimator.
+        Estimator_Running,
+        Estimator_Count
+    };
+
+    CorrectionEstimator GetCorrectionEstimator() const  { return Estimator; }
+    void        SetCorrectionEstimator(CorrectionEstimator estimator)
+    {
+        Lock::Locker lockScope(&FusionLock);
+        Estimator        = estimator;
+        NumSteadySamples = 0;
+    }
+
+    // One step of an integrator as handleMessage takes it, normalization included, for
+    // comparing them on recorded data; lastAngVel is only used by Integrator_Midpoint.
+    static Quatf IntegrateGyro(GyroIntegrator integrator, const Quatf& q, const Vector3f& angVel,
+                               const Vector3f& lastAngVel, float deltaT);
+
     // Methods for magnetometer calibration
     float       AngleDifference(float theta1, float theta2);
     Vector3f    CalculateSphereCenter(Vector3f p1, Vector3f p2,
@@ -195,6 +372,44 @@ private:
     // Internal handler for messages; bypasses error checking.
     void handleMessage(const MessageBodyFrame& msg);
 
+    // Counts the sample and wakes up the waiters it is for.
+    void notifySampleWaiters();
+
+    // Estimator_Running: takes a steady sample into the gravity mean and measures the tilt.
+    void updateRunningTilt(const Vector3f& accWorld, bool steady);
+    // Mean of the recent magnetometer readings, as the estimator keeps it.
+    Vector3f getMagMean() { return (Estimator == Estimator_Running) ? MagMean : FMag.Mean(); }
+
+    // Sleeps until the sample index reaches waitIndex (if armIndex) or a sample after
+    // waitTime comes in; SampleWaitMutex must be held.
+    bool waitForSampleLocked(bool armIndex, UInt32 waitIndex, double waitTime, unsigned timeoutMs);
+
+    // Device thread side of the fusion thread; touches only the queue, the dropped count
+    // and the wake-up flag, never the fusion state or FusionLock.
+    void queueSample(const MessageBodyFrame& msg);
+    // Fusion thread side; integrates everything in the queue.
+    void drainSampleQueue();
+
+    class FusionThread : public Thread
+    {
+        SensorFusion* pFusion;
+    public:
+        FusionThread(SensorFusion* fusion, int processor)
+            : Thread(128 * 1024, processor), pFusion(fusion) { }
+
+        virtual int Run();
+    };
+
+    struct QueuedSample
+    {
+        QueuedSample() : Frame(0), QueuedTicks(0) { }
+
+        MessageBodyFrame Frame;
+        UInt64           QueuedTicks;
+    };
+
+    enum { FusionQueueSize = 256 };
+
     class BodyFrameHandler : public MessageHandler
     {
         SensorFusion* pFusion;
@@ -212,6 +427,7 @@ private:
     Vector3f          Mag;
     Vector3f          RawMag;
     unsigned int      Stage;
+    double            SampleTime;
     BodyFrameHandler  Handler;
     MessageHandler*   pDelegate;
     float             Gain;
@@ -221,15 +437,63 @@ private:
     bool              EnablePrediction;
     float             PredictionDT;
     Quatf             QP;
+    SensorPredictor*  pPredictor;
+    ConstantVelocityPredictor DefaultPredictor;
+
+    GyroIntegrator    Integrator;
+    Vector3f          LastAngVel;
 
     SensorFilter      FMag;
     SensorFilter      FAccW;
     SensorFilter      FAngV;
+    int               AccelWindow;
+    int               AngVelWindow;
 
+    float             TiltGravityEpsilon;
+    float             TiltAngVelEpsilon;
+    int               TiltPeriod;
     int               TiltCondCount;
     float             TiltErrorAngle;
     Vector3f          TiltErrorAxis;
 
+    CorrectionEstimator Estimator;
+    Vector3f          AccWMean;
+    Vector3f          MagMean;
+    UInt32            NumSteadySamples;
+
+    // Sample notification. WakeIndex and WakeTime are the earliest sample anyone is waiting
+    // for, so samples that are of no interest to anyone don't wake anybody up.
+    Mutex             SampleWaitMutex;
+    WaitCondition     SampleWaitCondition;
+    UInt32            SampleIndex;
+    double            NotifiedSampleTime;
+    int               NumSampleWaiters;
+    bool              WakeIndexArmed;
+    UInt32            WakeIndex;
+    bool              WakeTimeArmed;
+    double            WakeTime;
+    UInt32            CancelCount;
+
+    // Fusion state, everything that changes as samples are integrated. Taken inside the
+    // handler lock when both are needed.
+    mutable Lock      FusionLock;
+
+    // Fusion thread. The pointer changes under the handler lock, the stats the fusion thread
+    // keeps under FusionLock; the queue is only pushed to on the device thread and popped
+    // from on the fusion thread, and the dropped count is atomic so that queueing never has
+    // to wait for FusionLock.
+    Ptr<FusionThread> pFusionThread;
+    SPSCQueue<QueuedSample, FusionQueueSize> SampleQueue;
+    AtomicInt<UInt32> FusionThreadSleeping;
+    Event             FusionThreadEvent;
+    UInt32            NumFusedSamples;
+    AtomicInt<UInt32> NumDroppedSamples;
+    double            FusionLatencySum;
+    float             FusionLatencyMax;
+    UInt64            FusionThreadAffinity;
+    Thread::SchedulingPolicy FusionThreadPolicy;
+    int               FusionThreadPriority;
+
     bool              EnableYawCorrection;
     Matrix4f          MagCalibrationMatrix;
     bool              MagCalibrated;
@@ -18,6 +18,12 @@ otherwise accompanies this software in either electronic or hard copy form.
 // HMDDeviceDesc can be created/updated through Sensor carrying DisplayInfo.
 
 #include "Kernel/OVR_Timer.h"
+#include "Kernel/OVR_Alg.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define OVR_SENSOR_DECODE_SSE2
+#endif
 
 namespace OVR {
     
@@ -476,6 +482,15 @@ SensorDeviceImpl::SensorDeviceImpl(SensorDeviceCreateDesc* createDesc)
     LastTimestamp   = 0;
 
     OldCommandId = 0;
+
+    updateFrameConversion();
+
+    StatsSequence       = 0;
+    StatsResetRequested = 0;
+    LastReportTicks     = 0;
+
+    DispatchThreadSleeping = 0;
+    ReportsDropped         = 0;
 }
 
 SensorDeviceImpl::~SensorDeviceImpl()
@@ -537,6 +552,9 @@ void SensorDeviceImpl::closeDeviceOnError()
 
 void SensorDeviceImpl::Shutdown()
 {   
+    // Runs on the DeviceManager thread; no handler is called after this.
+    setDispatchThreadEnabled(false, -1);
+
     HIDDeviceImpl<OVR::SensorDevice>::Shutdown();
 
     LogText("OVR::SensorDevice - Closed '%s'\n", getHIDDesc()->Path.ToCStr());
@@ -545,18 +563,36 @@ void SensorDeviceImpl::Shutdown()
 
 void SensorDeviceImpl::OnInputReport(UByte* pData, UInt32 length)
 {
+    UInt64 arrivalTicks = Timer::GetTicks();
 
-    bool processed = false;
-    if (!processed)
+    if (!pDispatchThread)
     {
+        processReport(pData, length, arrivalTicks);
+        return;
+    }
 
-        TrackerMessage message;
-        if (DecodeTrackerMessage(&message, pData, length))
-        {
-            processed = true;
-            onTrackerMessage(&message);
-        }
+    // Sensor reports are 62 bytes; nothing past MaxReportSize would be decoded anyway.
+    QueuedReport report;
+    report.Length       = Alg::Min(length, (UInt32)MaxReportSize);
+    report.ArrivalTicks = arrivalTicks;
+    memcpy(report.Data, pData, report.Length);
+
+    if (!ReportQueue.PushBack(report))
+    {
+        ReportsDropped++;
+        return;
     }
+
+    // Only go through the event when the dispatch thread is asleep.
+    if (DispatchThreadSleeping.CompareAndSet_Sync(1, 0))
+        DispatchThreadEvent.SetEvent();
+}
+
+void SensorDeviceImpl::processReport(UByte* pData, UInt32 length, UInt64 arrivalTicks)
+{
+    TrackerMessage message;
+    if (DecodeTrackerMessage(&message, pData, length))
+        onTrackerMessage(&message, arrivalTicks);
 }
 
 UInt64 SensorDeviceImpl::OnTicks(UInt64 ticksMks)
@@ -605,6 +641,119 @@ void SensorDeviceImpl::GetRange(SensorRange* range) const
     *range = CurrentRange;
 }
 
+void SensorDeviceImpl::GetStatistics(SensorStatistics* stats) const
+{
+    OVR_COMPILER_ASSERT(sizeof(SensorStatistics) % sizeof(UInt32) == 0);
+
+    // Copied word by word through volatile pointers, so that the compiler keeps the copy
+    // between the two loads of the sequence. An update takes well under a microsecond.
+    while (true)
+    {
+        UInt32 before = AtomicOps<UInt32>::Load_Acquire(&StatsSequence);
+        if (before & 1)
+            continue;
+
+        volatile UInt32*       dest = (volatile UInt32*)stats;
+        const volatile UInt32* src  = (const volatile UInt32*)&Stats;
+        for (UPInt i = 0; i < sizeof(SensorStatistics) / sizeof(UInt32); i++)
+            dest[i] = src[i];
+
+        { AtomicOpsRawBase::FullSync sync; OVR_UNUSED(sync); }
+        if (AtomicOps<UInt32>::Load_Acquire(&StatsSequence) == before)
+            break;
+    }
+
+    // Not carried out yet; nothing has come in since the reset as far as the caller is concerned.
+    if (StatsResetRequested.Load_Acquire())
+        stats->Clear();
+
+    // Counted on the DeviceManager thread, outside of the sequence.
+    stats->ReportsDropped = ReportsDropped.Load_Acquire();
+}
+
+void SensorDeviceImpl::ResetStatistics()
+{
+    StatsResetRequested.Store_Release(1);
+    ReportsDropped.Store_Release(0);
+}
+
+bool SensorDeviceImpl::SetDispatchThreadEnabled(bool enable, int processor)
+{
+    bool result = false;
+
+    // Started and stopped on the DeviceManager thread, between two reads from the device,
+    // so that reports are decoded in order across the change.
+    if (!GetManagerImpl()->GetThreadQueue()->
+            PushCallAndWaitResult(this, &SensorDeviceImpl::setDispatchThreadEnabled,
+                                  &result, enable, processor))
+    {
+        return false;
+    }
+
+    return result;
+}
+
+bool SensorDeviceImpl::setDispatchThreadEnabled(bool enable, int processor)
+{
+    if (enable)
+    {
+        if (pDispatchThread)
+            return true;
+
+        Ptr<DispatchThread> thread = *new DispatchThread(this, processor);
+        if (!thread->Start())
+        {
+            OVR_DEBUG_LOG(("SensorDevice::SetDispatchThreadEnabled failed - can't start thread"));
+            return false;
+        }
+
+        pDispatchThread = thread;
+        return true;
+    }
+
+    if (!pDispatchThread)
+        return true;
+
+    // Nothing is read from the device while this waits; the thread decodes what is queued
+    // before it exits, and the next report is decoded here.
+    pDispatchThread->SetExitFlag(true);
+    DispatchThreadEvent.SetEvent();
+    while (!pDispatchThread->IsFinished())
+        Thread::MSleep(1);
+
+    pDispatchThread.Clear();
+    return true;
+}
+
+void SensorDeviceImpl::drainReportQueue()
+{
+    QueuedReport report;
+
+    while (ReportQueue.PopFront(&report))
+        processReport(report.Data, report.Length, report.ArrivalTicks);
+}
+
+int SensorDeviceImpl::DispatchThread::Run()
+{
+    SetThreadName("OVR::SensorDevice");
+
+    while (!GetExitFlag())
+    {
+        pDevice->drainReportQueue();
+
+        // Announce the sleep before looking at the queue once more; the DeviceManager thread
+        // looks at the flag after queueing, so one of the two sees the other's report.
+        pDevice->DispatchThreadEvent.ResetEvent();
+        pDevice->DispatchThreadSleeping.Exchange_Sync(1);
+        if (pDevice->ReportQueue.IsEmpty() && !GetExitFlag())
+            pDevice->DispatchThreadEvent.Wait();
+        pDevice->DispatchThreadSleeping.Exchange_Sync(0);
+    }
+
+    pDevice->drainReportQueue();
+    return 0;
+}
+
 bool SensorDeviceImpl::setRange(const SensorRange& range)
 {
     SensorRangeImpl sr(range);
@@ -658,6 +807,8 @@ Void SensorDeviceImpl::setCoordinateFrame(CoordinateFrame coordframe)
     {
         HWCoordinates = Coord_HMD;
     }
+
+    updateFrameConversion();
     return 0;
 }
 
@@ -674,6 +825,15 @@ void SensorDeviceImpl::SetMessageHandler(MessageHandler* handler)
     }    
 }
 
+bool SensorDeviceImpl::AddMessageHandler(MessageHandler* handler)
+{
+    // Same as for the main handler, no replicating samples from before it was there.
+    if (!DeviceBase::AddMessageHandler(handler))
+        return false;
+    SequenceValid = false;
+    return true;
+}
+
 // Sensor reports data in the following coordinate system:
 // Accelerometer: 10^-4 m/s^2; X forward, Y right, Z Down.
 // Gyro:          10^-4 rad/s; X positive roll right, Y positive pitch up; Z positive yaw right.
@@ -725,42 +885,92 @@ Vector3f EulerFromBodyFrameUpdate(const TrackerSensors& update, UByte sampleNumb
 }
 
 
-void SensorDeviceImpl::onTrackerMessage(TrackerMessage* message)
+void SensorDeviceImpl::updateFrameConversion()
+{
+    // Runs on the DeviceManager thread; onTrackerMessage may be running on the dispatch
+    // thread, and reads the flag once per report.
+    bool convert = (Coordinates == Coord_Sensor) && (HWCoordinates == Coord_HMD);
+    DecodeHMDToSensor.Store_Release(convert ? 1 : 0);
+}
+
+UInt32 SensorDeviceImpl::decodeSamples(const TrackerSensors& s, MessageBodyFrame* frames,
+                                       bool convertHMDToSensor)
+{
+    const float timeUnit    = (1.0f / 1000.f);
+    float       temperature = s.Temperature * 0.01f;
+
+    // Nothing to take the last sample from.
+    if (s.SampleCount == 0)
+        return 0;
+
+    UByte    iterations = (s.SampleCount > 3) ? 3 : s.SampleCount;
+    // There is one magnetometer reading per report.
+    Vector3f mag        = MagFromBodyFrameUpdate(s, convertHMDToSensor);
+
+    for (UByte i = 0; i < iterations; i++)
+    {
+        MessageBodyFrame& sensors = frames[i];
+
+        // Samples past the three a report holds are merged into the first; TimeDelta for
+        // the last two samples is always fixed.
+        sensors.TimeDelta     = ((i == 0) && (s.SampleCount > 3)) ? (s.SampleCount - 2) * timeUnit
+                                                                  : timeUnit;
+        sensors.Acceleration  = AccelFromBodyFrameUpdate(s, i, convertHMDToSensor);
+        sensors.RotationRate  = EulerFromBodyFrameUpdate(s, i, convertHMDToSensor);
+        sensors.MagneticField = mag;
+        sensors.Temperature   = temperature;
+    }
+
+    const MessageBodyFrame& last = frames[iterations - 1];
+    LastAcceleration  = last.Acceleration;
+    LastRotationRate  = last.RotationRate;
+    LastMagneticField = last.MagneticField;
+    LastTemperature   = last.Temperature;
+
+    return iterations;
+}
+
+
+void SensorDeviceImpl::onTrackerMessage(TrackerMessage* message, UInt64 arrivalTicks)
 {
     if (message->Type != TrackerMessage_Sensors)
         return;
     
     const float     timeUnit   = (1.0f / 1000.f);
     TrackerSensors& s = message->Sensors;
-    
-
-    // Call OnMessage() within a lock to avoid conflicts with handlers.
-    Lock::Locker scopeLock(HandlerRef.GetLock());
 
+    // The report is decoded into messages first. Everything up to the handler calls is
+    // touched only by the thread decoding reports, so the handler lock, which all devices
+    // share, is held for the calls alone.
+    MessageBodyFrame frames[MaxReportFrames] = { this, this, this, this };
+    UInt32           numFrames = 0;
+
+    // The timestamp counts milliseconds in 16 bits; the unsigned difference is right
+    // across a wraparound.
+    bool     havePrevious   = (LastReportTicks != 0);
+    unsigned timestampDelta = havePrevious ? (UInt16)(s.Timestamp - LastTimestamp) : 0;
+    bool     wrapped        = havePrevious && (s.Timestamp < LastTimestamp);
+    unsigned gapFilled      = 0;
+    bool     gapDropped     = false;
+    UInt32   delivered      = 0;
 
     if (SequenceValid)
     {
-        unsigned timestampDelta;
-
-        if (s.Timestamp < LastTimestamp)
-            timestampDelta = ((((int)s.Timestamp) + 0x10000) - (int)LastTimestamp);
-        else
-            timestampDelta = (s.Timestamp - LastTimestamp);
-
         // If we missed a small number of samples, replicate the last sample.
         if ((timestampDelta > LastSampleCount) && (timestampDelta <= 254))
         {
-            if (HandlerRef.GetHandler())
-            {
-                MessageBodyFrame sensors(this);
-                sensors.TimeDelta     = (timestampDelta - LastSampleCount) * timeUnit;
-                sensors.Acceleration  = LastAcceleration;
-                sensors.RotationRate  = LastRotationRate;
-                sensors.MagneticField = LastMagneticField;
-                sensors.Temperature   = LastTemperature;
-
-                HandlerRef.GetHandler()->OnMessage(sensors);
-            }
+            gapFilled = timestampDelta - LastSampleCount;
+
+            MessageBodyFrame& sensors = frames[numFrames++];
+            sensors.TimeDelta     = (timestampDelta - LastSampleCount) * timeUnit;
+            sensors.Acceleration  = LastAcceleration;
+            sensors.RotationRate  = LastRotationRate;
+            sensors.MagneticField = LastMagneticField;
+            sensors.Temperature   = LastTemperature;
+        }
+        else if (timestampDelta > 254)
+        {
+            gapDropped = true;
         }
     }
     else
@@ -775,47 +985,253 @@ void SensorDeviceImpl::onTrackerMessage(TrackerMessage* message)
     LastSampleCount = s.SampleCount;
     LastTimestamp   = s.Timestamp;
 
-    bool convertHMDToSensor = (Coordinates == Coord_Sensor) && (HWCoordinates == Coord_HMD);
+    numFrames += decodeSamples(s, frames + numFrames, DecodeHMDToSensor.Load_Acquire() != 0);
 
-    if (HandlerRef.GetHandler())
     {
-        MessageBodyFrame sensors(this);                
-        UByte            iterations = s.SampleCount;
+        Lock::Locker scopeLock(HandlerRef.GetLock());
+        if (HasMessageHandlers_NTS())
+        {
+            for (UInt32 i = 0; i < numFrames; i++)
+                CallMessageHandlers_NTS(frames[i]);
+            delivered = numFrames;
+        }
+    }
+
+    // Statistics, odd sequence while they are inconsistent.
+    AtomicOps<UInt32>::Exchange_Sync(&StatsSequence, StatsSequence + 1);
+
+    if (StatsResetRequested.CompareAndSet_Sync(1, 0))
+        Stats.Clear();
+
+    Stats.PacketsReceived++;
+    Stats.SamplesDelivered += delivered;
+    if (s.SampleCount > 3)
+        Stats.SamplesMerged += s.SampleCount - 3;
+    if (gapFilled)
+    {
+        Stats.GapsFilled++;
+        Stats.SamplesFilled += gapFilled;
+    }
+    if (gapDropped)
+        Stats.GapsDropped++;
+    if (wrapped)
+        Stats.TimestampWraps++;
 
-        if (s.SampleCount > 3)
+    if (havePrevious)
+    {
+        float interval = (float)Timer::TicksToSeconds(arrivalTicks - LastReportTicks);
+        float jitter   = fabs(interval - timestampDelta * timeUnit);
+
+        // Buckets double from 0.25 ms up.
+        int   bucket   = 0;
+        float limit    = 0.00025f;
+        while ((bucket < SensorStatistics::JitterBuckets - 1) && (jitter > limit))
         {
-            iterations        = 3;
-            sensors.TimeDelta = (s.SampleCount - 2) * timeUnit;
+            bucket++;
+            limit *= 2.0f;
         }
-        else
+        Stats.JitterHistogram[bucket]++;
+
+        if (jitter > Stats.JitterMax)
+            Stats.JitterMax = jitter;
+        if (interval > Stats.IntervalMax)
+            Stats.IntervalMax = interval;
+    }
+
+    AtomicOps<UInt32>::Store_Release(&StatsSequence, StatsSequence + 1);
+
+    LastReportTicks = arrivalTicks;
+}
+
+
+//-------------------------------------------------------------------------------------
+// ***** Batch decoding of sensor reports
+
+UPInt DecodeSensorPacketsReference(const SensorPacketArrays& out, const UByte* packets,
+                                   UPInt packetStride, UPInt numPackets, bool convertHMDToSensor)
+{
+    UPInt          numSensorPackets = 0;
+    TrackerMessage message;
+
+    for (UPInt p = 0; p < numPackets; p++)
+    {
+        // Everything is zero for a packet that fails to decode, the same as for missing samples.
+        bool            sensor = DecodeTrackerMessage(&message, (UByte*)packets + p * packetStride,
+                                                      (int)packetStride);
+        TrackerSensors& s      = message.Sensors;
+
+        for (UByte i = 0; i < 3; i++)
         {
-            sensors.TimeDelta = timeUnit;
+            Vector3f accel = AccelFromBodyFrameUpdate(s, i, convertHMDToSensor);
+            Vector3f gyro  = EulerFromBodyFrameUpdate(s, i, convertHMDToSensor);
+            out.AccelX[p * 3 + i] = accel.x;
+            out.AccelY[p * 3 + i] = accel.y;
+            out.AccelZ[p * 3 + i] = accel.z;
+            out.GyroX[p * 3 + i]  = gyro.x;
+            out.GyroY[p * 3 + i]  = gyro.y;
+            out.GyroZ[p * 3 + i]  = gyro.z;
         }
 
-        for (UByte i = 0; i < iterations; i++)
-        {            
-            sensors.Acceleration = AccelFromBodyFrameUpdate(s, i, convertHMDToSensor);
-            sensors.RotationRate = EulerFromBodyFrameUpdate(s, i, convertHMDToSensor);
-            sensors.MagneticField= MagFromBodyFrameUpdate(s, convertHMDToSensor);
-            sensors.Temperature  = s.Temperature * 0.01f;
-            HandlerRef.GetHandler()->OnMessage(sensors);
-            // TimeDelta for the last two sample is always fixed.
-            sensors.TimeDelta = timeUnit;
+        Vector3f mag = MagFromBodyFrameUpdate(s, convertHMDToSensor);
+        out.MagX[p]        = mag.x;
+        out.MagY[p]        = mag.y;
+        out.MagZ[p]        = mag.z;
+        out.Temperature[p] = s.Temperature * 0.01f;
+        out.Timestamp[p]   = s.Timestamp;
+        out.SampleCount[p] = sensor ? s.SampleCount : 0;
+
+        if (sensor)
+            numSensorPackets++;
+    }
+    return numSensorPackets;
+}
+
+// UnpackSensor's 21-bit fields are packed most significant bit first, unlike the rest of the
+// report. Read as big-endian words at byte offsets 0, 2 and 4 of the triple, each field is at
+// a fixed position in its word and an arithmetic shift sign-extends it.
+static UInt32 DecodeBigEndianUInt32(const UByte* buffer)
+{
+    return (UInt32(buffer[0]) << 24) | (UInt32(buffer[1]) << 16) | (UInt32(buffer[2]) << 8) | UInt32(buffer[3]);
+}
+
+static inline SInt32 UnpackField0(UInt32 word) { return ((SInt32)word) >> 11; }
+static inline SInt32 UnpackField1(UInt32 word) { return ((SInt32)(word << 5)) >> 11; }
+static inline SInt32 UnpackField2(UInt32 word) { return ((SInt32)(word << 10)) >> 11; }
+
+// Where a sample's raw axes go and how they are scaled, for the HMD to sensor conversion
+// (x, z, -y) or none. Negating through the scale gives the same bits as negating the value.
+struct SensorAxisMap
+{
+    float* X;
+    float* Y;
+    float* Z;
+    float  ScaleY;
+    float  ScaleZ;
+
+    SensorAxisMap(float* x, float* y, float* z, bool convertHMDToSensor)
+        : X(x), Y(convertHMDToSensor ? z : y), Z(convertHMDToSensor ? y : z),
+          ScaleY(convertHMDToSensor ? -0.0001f : 0.0001f), ScaleZ(0.0001f)
+    { }
+};
+
+// The six big-endian words of a sample's accel and gyro triples, zero if the packet doesn't
+// have the sample.
+static void GatherSampleWords(UInt32* words, UPInt wordStride, const UByte* packets,
+                              UPInt packetStride, const UByte* sampleCounts, UPInt sample)
+{
+    UPInt    packet     = sample / 3;
+    unsigned i          = (unsigned)(sample % 3);
+    unsigned numSamples = (sampleCounts[packet] > 2) ? 3 : sampleCounts[packet];
+
+    if (i >= numSamples)
+    {
+        for (int w = 0; w < 6; w++)
+            words[w * wordStride] = 0;
+        return;
+    }
+
+    const UByte* accel = packets + packet * packetStride + 8 + 16 * i;
+    const UByte* gyro  = accel + 8;
+    words[0 * wordStride] = DecodeBigEndianUInt32(accel);
+    words[1 * wordStride] = DecodeBigEndianUInt32(accel + 2);
+    words[2 * wordStride] = DecodeBigEndianUInt32(accel + 4);
+    words[3 * wordStride] = DecodeBigEndianUInt32(gyro);
+    words[4 * wordStride] = DecodeBigEndianUInt32(gyro + 2);
+    words[5 * wordStride] = DecodeBigEndianUInt32(gyro + 4);
+}
+
+static void StoreSample(const SensorAxisMap& map, UPInt sample, const UInt32* words)
+{
+    map.X[sample] = (float)UnpackField0(words[0]) * 0.0001f;
+    map.Y[sample] = (float)UnpackField1(words[1]) * map.ScaleY;
+    map.Z[sample] = (float)UnpackField2(words[2]) * map.ScaleZ;
+}
+
+#ifdef OVR_SENSOR_DECODE_SSE2
+
+// Four samples at a time; words holds the three words of each, four lanes per word.
+static void StoreSamples4(const SensorAxisMap& map, UPInt sample, const UInt32* words)
+{
+    __m128i w0 = _mm_loadu_si128((const __m128i*)(words + 0));
+    __m128i w1 = _mm_loadu_si128((const __m128i*)(words + 4));
+    __m128i w2 = _mm_loadu_si128((const __m128i*)(words + 8));
+
+    __m128  x  = _mm_cvtepi32_ps(_mm_srai_epi32(w0, 11));
+    __m128  y  = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(w1, 5), 11));
+    __m128  z  = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(w2, 10), 11));
+
+    _mm_storeu_ps(map.X + sample, _mm_mul_ps(x, _mm_set1_ps(0.0001f)));
+    _mm_storeu_ps(map.Y + sample, _mm_mul_ps(y, _mm_set1_ps(map.ScaleY)));
+    _mm_storeu_ps(map.Z + sample, _mm_mul_ps(z, _mm_set1_ps(map.ScaleZ)));
+}
+
+#endif
+
+UPInt DecodeSensorPackets(const SensorPacketArrays& out, const UByte* packets,
+                          UPInt packetStride, UPInt numPackets, bool convertHMDToSensor)
+{
+    UPInt numSensorPackets = 0;
+    bool  canDecode        = (packetStride >= 62);
+
+    // Per packet values first; the sample counts they leave in out drive the sample pass.
+    for (UPInt p = 0; p < numPackets; p++)
+    {
+        const UByte* buffer = packets + p * packetStride;
+        bool         sensor = canDecode && (buffer[0] == TrackerMessage_Sensors);
+
+        SInt16 magX = sensor ? DecodeSInt16(buffer + 56) : 0;
+        SInt16 magY = sensor ? DecodeSInt16(buffer + 58) : 0;
+        SInt16 magZ = sensor ? DecodeSInt16(buffer + 60) : 0;
+        SInt16 temp = sensor ? DecodeSInt16(buffer + 6)  : 0;
+
+        // Same axis swaps as MagFromBodyFrameUpdate.
+        if (convertHMDToSensor)
+        {
+            out.MagX[p] = (float)magX * 0.0001f;
+            out.MagY[p] = (float)magY * 0.0001f;
+            out.MagZ[p] = -(float)magZ * 0.0001f;
+        }
+        else
+        {
+            out.MagX[p] = (float)magX * 0.0001f;
+            out.MagY[p] = (float)magZ * 0.0001f;
+            out.MagZ[p] = (float)magY * 0.0001f;
         }
+        out.Temperature[p] = temp * 0.01f;
+        out.Timestamp[p]   = sensor ? DecodeUInt16(buffer + 2) : 0;
+        out.SampleCount[p] = sensor ? buffer[1] : 0;
 
-        LastAcceleration = sensors.Acceleration;
-        LastRotationRate = sensors.RotationRate;
-        LastMagneticField= sensors.MagneticField;
-        LastTemperature  = sensors.Temperature;
+        if (sensor)
+            numSensorPackets++;
     }
-    else
+
+    SensorAxisMap accel(out.AccelX, out.AccelY, out.AccelZ, convertHMDToSensor);
+    SensorAxisMap gyro(out.GyroX, out.GyroY, out.GyroZ, convertHMDToSensor);
+    UPInt         numSamples = numPackets * 3;
+    UPInt         sample     = 0;
+
+#ifdef OVR_SENSOR_DECODE_SSE2
+    for (; sample + 4 <= numSamples; sample += 4)
+    {
+        UInt32 words[6 * 4];
+        for (UPInt lane = 0; lane < 4; lane++)
+            GatherSampleWords(words + lane, 4, packets, packetStride, out.SampleCount, sample + lane);
+
+        StoreSamples4(accel, sample, words);
+        StoreSamples4(gyro, sample, words + 3 * 4);
+    }
+#endif
+
+    for (; sample < numSamples; sample++)
     {
-        UByte i = (s.SampleCount > 3) ? 2 : (s.SampleCount - 1);
-        LastAcceleration  = AccelFromBodyFrameUpdate(s, i, convertHMDToSensor);
-        LastRotationRate  = EulerFromBodyFrameUpdate(s, i, convertHMDToSensor);
-        LastMagneticField = MagFromBodyFrameUpdate(s, convertHMDToSensor);
-        LastTemperature   = s.Temperature * 0.01f;
+        UInt32 words[6];
+        GatherSampleWords(words, 1, packets, packetStride, out.SampleCount, sample);
+
+        StoreSample(accel, sample, words);
+        StoreSample(gyro, sample, words + 3);
     }
+
+    return numSensorPackets;
 }
 
 } // namespace OVR
@@ -17,10 +17,12 @@ otherwise accompanies this software in either electronic or hard copy form.
 #define OVR_SensorImpl_h
 
 #include "OVR_HIDDeviceImpl.h"
+#include "Kernel/OVR_SPSCQueue.h"
 
 namespace OVR {
     
 struct TrackerMessage;
+struct TrackerSensors;
 class ExternalVisitor;
 
 //-------------------------------------------------------------------------------------
@@ -105,6 +107,42 @@ struct SensorDisplayInfoImpl
 };
 
 
+//-------------------------------------------------------------------------------------
+// ***** Batch decoding of sensor reports
+
+// Arrays that DecodeSensorPackets fills in, allocated by the caller. Sample arrays take
+// three entries per packet, in the order of the packet's samples; entries past the
+// samples a packet holds are zero. The other arrays take one entry per packet.
+// Values are in the units and coordinate frame of MessageBodyFrame.
+struct SensorPacketArrays
+{
+    float*  AccelX;
+    float*  AccelY;
+    float*  AccelZ;
+    float*  GyroX;
+    float*  GyroY;
+    float*  GyroZ;
+    float*  MagX;
+    float*  MagY;
+    float*  MagZ;
+    float*  Temperature;
+    UInt16* Timestamp;
+    UByte*  SampleCount;    // As reported, may be over 3; 0 for packets that aren't sensor reports.
+};
+
+// Decodes numPackets raw HID reports, each packetStride bytes from the previous one, in
+// one pass. Packets that aren't sensor reports come out as all zero. convertHMDToSensor
+// is the conversion SensorDevice applies for Coord_Sensor on an HMD sensor. Returns the
+// number of sensor reports.
+UPInt DecodeSensorPackets(const SensorPacketArrays& out, const UByte* packets,
+                          UPInt packetStride, UPInt numPackets, bool convertHMDToSensor);
+
+// Same, through the per-message decoding the device itself uses. DecodeSensorPackets must
+// give bit-identical results; this is kept as the reference for it.
+UPInt DecodeSensorPacketsReference(const SensorPacketArrays& out, const UByte* packets,
+                                   UPInt packetStride, UPInt numPackets, bool convertHMDToSensor);
+
+
 //-------------------------------------------------------------------------------------
 // ***** OVR::SensorDeviceImpl
 
@@ -122,6 +160,7 @@ public:
     virtual void Shutdown();
     
     virtual void SetMessageHandler(MessageHandler* handler);
+    virtual bool AddMessageHandler(MessageHandler* handler);
 
     // HIDDevice::Notifier interface.
     virtual void OnInputReport(UByte* pData, UInt32 length);
@@ -135,6 +174,12 @@ public:
     virtual bool SetRange(const SensorRange& range, bool waitFlag);
     virtual void GetRange(SensorRange* range) const;
 
+    virtual void GetStatistics(SensorStatistics* stats) const;
+    virtual void ResetStatistics();
+
+    virtual bool SetDispatchThreadEnabled(bool enable, int processor);
+    virtual bool IsDispatchThreadEnabled() const { return pDispatchThread.GetPtr() != 0; }
+
     // Hack to create HMD device from sensor display info.
     static void EnumerateHMDFromSensorDisplayInfo(  const SensorDisplayInfoImpl& displayInfo, 
                                                     DeviceFactory::EnumerateVisitor& visitor);
@@ -145,9 +190,20 @@ protected:
 
     Void    setCoordinateFrame(CoordinateFrame coordframe);
     bool    setRange(const SensorRange& range);
+    bool    setDispatchThreadEnabled(bool enable, int processor);
+
+    // Decodes a report read at arrivalTicks and passes it on.
+    void        processReport(UByte* pData, UInt32 length, UInt64 arrivalTicks);
 
     // Called for decoded messages
-    void        onTrackerMessage(TrackerMessage* message);
+    void        onTrackerMessage(TrackerMessage* message, UInt64 arrivalTicks);
+
+    // Converts the samples of a report to the requested coordinate frame, into frames;
+    // returns how many there are. DecodeHMDToSensor tells whether the current pair of
+    // frames needs the HMD to sensor conversion.
+    UInt32      decodeSamples(const TrackerSensors& s, MessageBodyFrame* frames,
+                              bool convertHMDToSensor);
+    void        updateFrameConversion();
 
     // Helpers to reduce casting.
 /*
@@ -163,10 +219,14 @@ protected:
     // so we track its state.
     CoordinateFrame Coordinates;
     CoordinateFrame HWCoordinates;
+    AtomicInt<UInt32> DecodeHMDToSensor;
     UInt64      NextKeepAliveTicks;
 
+    // Messages one report can turn into: a filled gap and three samples.
+    enum { MaxReportFrames = 4 };
+
     bool        SequenceValid;
-    SInt16      LastTimestamp;
+    UInt16      LastTimestamp;
     UByte       LastSampleCount;
     float       LastTemperature;
     Vector3f    LastAcceleration;
@@ -178,6 +238,48 @@ protected:
     SensorRange CurrentRange;
     
     UInt16      OldCommandId;
+
+    // Written only by the thread decoding reports, the device thread or the dispatch thread,
+    // inside StatsSequence going odd and back to even; readers retry when the sequence
+    // changed under their copy. A reset is left for that thread to carry out, so it has a
+    // single writer.
+    SensorStatistics  Stats;
+    volatile UInt32   StatsSequence;
+    AtomicInt<UInt32> StatsResetRequested;
+    UInt64            LastReportTicks;
+
+    // Dispatch thread. Reports are queued as they were read, with the time they came in,
+    // and decoded on the thread. pDispatchThread only changes on the DeviceManager thread,
+    // which is also the only one to queue reports.
+    enum
+    {
+        ReportQueueSize = 64,
+        MaxReportSize   = 64
+    };
+
+    struct QueuedReport
+    {
+        UByte   Data[MaxReportSize];
+        UInt32  Length;
+        UInt64  ArrivalTicks;
+    };
+
+    void drainReportQueue();
+
+    class DispatchThread : public Thread
+    {
+        SensorDeviceImpl* pDevice;
+    public:
+        DispatchThread(SensorDeviceImpl* device, int processor)
+            : Thread(128 * 1024, processor), pDevice(device) { }
+        virtual int Run();
+    };
+
+    Ptr<DispatchThread> pDispatchThread;
+    SPSCQueue<QueuedReport, ReportQueueSize> ReportQueue;
+    AtomicInt<UInt32>   DispatchThreadSleeping;
+    Event               DispatchThreadEvent;
+    AtomicInt<UInt32>   ReportsDropped;
 };
 
 
@@ -0,0 +1,156 @@
+/************************************************************************************
+
+Filename    :   OVR_SensorPredictor.cpp
+Content     :   Orientation predictors for SensorFusion
+Created     :   October 19, 2026
+
+Copyright   :   Copyright 2013 Oculus VR, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Oculus license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+*************************************************************************************/
+
+#include "OVR_SensorPredictor.h"
+
+namespace OVR {
+
+//-------------------------------------------------------------------------------------
+// ***** SensorPredictor
+
+Quatf SensorPredictor::Extrapolate(const Quatf& q, const Vector3f& angVel, float dt)
+{
+    float angVelL = angVel.Length();
+
+    if (angVelL > 0.001f)
+    {
+        Vector3f    rotAxisP      = angVel / angVelL;
+        float       halfRotAngleP = angVelL * dt * 0.5f;
+        float       sinaHRAP      = sin(halfRotAngleP);
+        Quatf       deltaQP(rotAxisP.x*sinaHRAP, rotAxisP.y*sinaHRAP,
+                            rotAxisP.z*sinaHRAP, cos(halfRotAngleP));
+        return q * deltaQP;
+    }
+    return q;
+}
+
+// With the rate changing linearly, the rotation over dt is about the mean rate over it
+// (exactly so when the axis doesn't change).
+static Quatf ExtrapolateAccelerating(const Quatf& q, const Vector3f& angVel, const Vector3f& angAccel,
+                                     float maxRateChange, float dt)
+{
+    Vector3f rateChange = angAccel * dt;
+    float    length     = rateChange.Length();
+    if (length > maxRateChange)
+        rateChange *= maxRateChange / length;
+
+    return SensorPredictor::Extrapolate(q, angVel + rateChange * 0.5f, dt);
+}
+
+
+//-------------------------------------------------------------------------------------
+// ***** ConstantVelocityPredictor
+
+void ConstantVelocityPredictor::Update(const PredictorInput& input)
+{
+    AngVel = input.AngVelHistory->SavitzkyGolaySmooth8();
+}
+
+Quatf ConstantVelocityPredictor::Predict(const Quatf& q, float dt) const
+{
+    return Extrapolate(q, AngVel, dt);
+}
+
+
+//-------------------------------------------------------------------------------------
+// ***** ConstantAccelerationPredictor
+
+void ConstantAccelerationPredictor::Update(const PredictorInput& input)
+{
+    AngVel = input.AngVelHistory->SavitzkyGolaySmooth8();
+
+    // The derivative is per sample.
+    if (input.DeltaT > 0.0f)
+        AngAccel = input.AngVelHistory->SavitzkyGolayDerivative12() / input.DeltaT;
+}
+
+Quatf ConstantAccelerationPredictor::Predict(const Quatf& q, float dt) const
+{
+    return ExtrapolateAccelerating(q, AngVel, AngAccel, MaxRateChange, dt);
+}
+
+
+//-------------------------------------------------------------------------------------
+// ***** KalmanPredictor
+
+KalmanPredictor::KalmanPredictor(float jerkNoise, float gyroNoise)
+    : JerkNoise(jerkNoise), GyroNoise(gyroNoise)
+{
+    Reset();
+}
+
+void KalmanPredictor::Reset()
+{
+    Started  = false;
+    AngVel   = Vector3f();
+    AngAccel = Vector3f();
+    P00 = P01 = P11 = Vector3f();
+}
+
+void KalmanPredictor::Update(const PredictorInput& input)
+{
+    float dt = input.DeltaT;
+
+    if (!Started)
+    {
+        // Start from the first reading, not knowing the acceleration.
+        AngVel   = input.AngVel;
+        AngAccel = Vector3f();
+        P00      = Vector3f(GyroNoise, GyroNoise, GyroNoise);
+        P01      = Vector3f();
+        P11      = Vector3f(JerkNoise, JerkNoise, JerkNoise) * 0.01f;
+        Started  = true;
+        return;
+    }
+
+    // Predict with x' = F x, F = [1 dt; 0 1], and the process noise of white jerk.
+    float dt2 = dt * dt;
+    float q00 = JerkNoise * dt2 * dt * (1.0f / 3.0f);
+    float q01 = JerkNoise * dt2 * 0.5f;
+    float q11 = JerkNoise * dt;
+
+    AngVel += AngAccel * dt;
+    P00 += (P01 * 2.0f + P11 * dt) * dt + Vector3f(q00, q00, q00);
+    P01 += P11 * dt + Vector3f(q01, q01, q01);
+    P11 += Vector3f(q11, q11, q11);
+
+    // Correct with the gyro reading of the rate, one axis at a time.
+    for (int axis = 0; axis < 3; axis++)
+    {
+        float& p00 = (&P00.x)[axis];
+        float& p01 = (&P01.x)[axis];
+        float& p11 = (&P11.x)[axis];
+
+        float s  = p00 + GyroNoise;
+        float k0 = p00 / s;
+        float k1 = p01 / s;
+        float y  = (&input.AngVel.x)[axis] - (&AngVel.x)[axis];
+
+        (&AngVel.x)[axis]   += k0 * y;
+        (&AngAccel.x)[axis] += k1 * y;
+
+        p11 -= k1 * p01;
+        p01 -= k0 * p01;
+        p00 -= k0 * p00;
+    }
+}
+
+Quatf KalmanPredictor::Predict(const Quatf& q, float dt) const
+{
+    // No cap, the filter keeps the acceleration estimate smooth.
+    return ExtrapolateAccelerating(q, AngVel, AngAccel, Math<float>::MaxValue, dt);
+}
+
+
+} // namespace OVR
@@ -0,0 +1,132 @@
+/************************************************************************************
+
+PublicHeader:   OVR.h
+Filename    :   OVR_SensorPredictor.h
+Content     :   Orientation predictors for SensorFusion
+Created     :   October 19, 2026
+
+Copyright   :   Copyright 2013 Oculus VR, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Oculus license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+*************************************************************************************/
+
+#ifndef OVR_SensorPredictor_h
+#define OVR_SensorPredictor_h
+
+#include "OVR_SensorFilter.h"
+#include "Kernel/OVR_Allocator.h"
+
+namespace OVR {
+
+//-------------------------------------------------------------------------------------
+// ***** SensorPredictor
+
+// What a predictor is given after each sample has been integrated.
+struct PredictorInput
+{
+    Quatf           Orientation;    // Orientation after the sample.
+    Vector3f        AngVel;         // The sample's angular velocity, in rad/s.
+    SensorFilter*   AngVelHistory;  // Angular velocities of the last samples, this one included.
+    float           DeltaT;         // Time the sample covers, in seconds.
+};
+
+// SensorPredictor extrapolates the head orientation a little into the future, to make up
+// for the time between reading the sensor and the frame being shown. SensorFusion calls
+// Update for every sample and Predict right after, on the thread that integrates samples
+// and with the fusion's lock held; a predictor can be driven by hand the same way, with
+// Predict called for as many horizons as needed in between.
+
+class SensorPredictor : public NewOverrideBase
+{
+public:
+    virtual ~SensorPredictor() { }
+
+    virtual void  Reset() { }
+    virtual void  Update(const PredictorInput& input) = 0;
+
+    // Orientation q predicted dt seconds ahead.
+    virtual Quatf Predict(const Quatf& q, float dt) const = 0;
+
+    // Rotates q by a constant angular velocity for dt seconds.
+    static Quatf  Extrapolate(const Quatf& q, const Vector3f& angVel, float dt);
+};
+
+
+//-------------------------------------------------------------------------------------
+// ***** ConstantVelocityPredictor
+
+// Keeps turning at the smoothed current rate. What SensorFusion has always done, and its
+// default; it tends to overshoot when a fast head turn stops.
+
+class ConstantVelocityPredictor : public SensorPredictor
+{
+public:
+    ConstantVelocityPredictor() { }
+
+    virtual void  Update(const PredictorInput& input);
+    virtual Quatf Predict(const Quatf& q, float dt) const;
+
+private:
+    Vector3f    AngVel;
+};
+
+
+//-------------------------------------------------------------------------------------
+// ***** ConstantAccelerationPredictor
+
+// Keeps changing the rate at the current angular acceleration, taken as the Savitzky-Golay
+// derivative of the rate over the last 12 samples; sees a turn slowing down, at the price
+// of more noise. The extrapolated rate change is capped at maxRateChange (rad/s) so that
+// noise can't throw the prediction far off.
+
+class ConstantAccelerationPredictor : public SensorPredictor
+{
+public:
+    ConstantAccelerationPredictor(float maxRateChange = 4.0f)
+        : MaxRateChange(maxRateChange) { }
+
+    virtual void  Update(const PredictorInput& input);
+    virtual Quatf Predict(const Quatf& q, float dt) const;
+
+private:
+    float       MaxRateChange;
+    Vector3f    AngVel;
+    Vector3f    AngAccel;
+};
+
+
+//-------------------------------------------------------------------------------------
+// ***** KalmanPredictor
+
+// Tracks angular velocity and acceleration on each axis with a Kalman filter of a constant
+// acceleration model, driven by the gyro; predicts like ConstantAccelerationPredictor from
+// the filtered state. jerkNoise is the spectral density of the angular jerk the model allows
+// for, gyroNoise the variance of a gyro reading; the ratio sets how fast the filter follows.
+
+class KalmanPredictor : public SensorPredictor
+{
+public:
+    KalmanPredictor(float jerkNoise = 2000.0f, float gyroNoise = 0.0004f);
+
+    virtual void  Reset();
+    virtual void  Update(const PredictorInput& input);
+    virtual Quatf Predict(const Quatf& q, float dt) const;
+
+private:
+    float       JerkNoise;
+    float       GyroNoise;
+    bool        Started;
+
+    // State and the symmetric 2x2 covariance, one component per axis.
+    Vector3f    AngVel;
+    Vector3f    AngAccel;
+    Vector3f    P00, P01, P11;
+};
+
+
+} // namespace OVR
+
+#endif // OVR_SensorPredictor_h
@@ -85,6 +85,11 @@ ThreadCommandQueue* DeviceManager::GetThreadQueue()
     return pThread;
 }
 
+Thread* DeviceManager::GetThread()
+{
+    return pThread;
+}
+
 bool DeviceManager::GetDeviceInfo(DeviceInfo* info) const
 {
     if ((info->InfoClassType != Device_Manager) &&
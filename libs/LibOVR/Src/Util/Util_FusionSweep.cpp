@@ -0,0 +1,415 @@
+/************************************************************************************
+
+Filename    :   Util_FusionSweep.cpp
+Content     :   Runs SensorFusion over recorded captures for a grid of parameters,
+                on all cores, and scores each configuration.
+Created     :   October 19, 2026
+
+Copyright   :   Copyright 2013 Oculus VR, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Oculus license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+*************************************************************************************/
+
+#include "Util_FusionSweep.h"
+
+#include "../Kernel/OVR_Log.h"
+#include "../Kernel/OVR_Timer.h"
+#include "../Kernel/OVR_Threads.h"
+
+namespace OVR { namespace Util {
+
+//-------------------------------------------------------------------------------------
+// ***** FusionSweepParams
+
+FusionSweepParams::FusionSweepParams()
+    : AccelGain(0.05f), TiltGravityEpsilon(0.4f), TiltAngVelEpsilon(0.1f), TiltPeriod(50),
+      AccelWindow(20), AngVelWindow(20), PredictionDelta(0.03f)
+{
+}
+
+void FusionSweepParams::Apply(SensorFusion* fusion) const
+{
+    fusion->SetAccelGain(AccelGain);
+    fusion->SetTiltThresholds(TiltGravityEpsilon, TiltAngVelEpsilon, TiltPeriod);
+    fusion->SetFilterWindows(AccelWindow, AngVelWindow);
+    fusion->SetPrediction(PredictionDelta);
+}
+
+
+//-------------------------------------------------------------------------------------
+// ***** Scoring
+
+// Installed as the fusion's predictor, records what the fusion had and predicted at each
+// sample. The fusion's getters would take the lock all message handlers share, and the
+// runs on the other threads with it.
+class SweepRecorder : public ConstantVelocityPredictor
+{
+public:
+    SweepRecorder(Quatf* fused, Quatf* predicted)
+        : pFused(fused), pPredicted(predicted), Index(0), Current(0) { }
+
+    virtual void Update(const PredictorInput& input)
+    {
+        ConstantVelocityPredictor::Update(input);
+        Current = Index++;
+        pFused[Current] = input.Orientation;
+    }
+
+    virtual Quatf Predict(const Quatf& q, float dt) const
+    {
+        Quatf predicted = ConstantVelocityPredictor::Predict(q, dt);
+        pPredicted[Current] = predicted;
+        return predicted;
+    }
+
+private:
+    Quatf*  pFused;
+    Quatf*  pPredicted;
+    UPInt   Index;
+    UPInt   Current;
+};
+
+// Angle of the rotation from a to b.
+static float angleBetween(const Quatf& a, const Quatf& b)
+{
+    float dot = fabs(a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w) / (a.Length() * b.Length());
+    return 2.0f * acos(Alg::Min(dot, 1.0f));
+}
+
+void FusionSweep::runOne(const SensorReplay& capture, const FusionSweepParams& params,
+                         RunTotals* totals)
+{
+    // The headset counts as still, and the accelerometer as measuring gravity alone, well
+    // inside the default tilt thresholds; fixed, so that configurations compare fairly.
+    const float stillGravityEpsilon = 0.2f;
+    const float stillAngVelEpsilon  = 0.05f;
+
+    UInt32           numSamples = capture.GetNumSamples();
+    Array<Quatf>     fused;
+    Array<Quatf>     predicted;
+    ArrayPOD<double> times;
+    fused.Resize(numSamples);
+    predicted.Resize(numSamples);
+    times.Resize(numSamples);
+
+    memset(totals, 0, sizeof(RunTotals));
+    totals->NumSamples = numSamples;
+    if (numSamples == 0)
+        return;
+
+    SweepRecorder    recorder(&fused[0], &predicted[0]);
+    SensorFusion     fusion;
+    MessageBodyFrame msg(0);
+    double           time = 0;
+
+    params.Apply(&fusion);
+    fusion.SetPredictor(&recorder);
+
+    UInt64 start = Timer::GetTicks();
+    for (UInt32 s = 0; s < numSamples; s++)
+    {
+        SensorReplay::ToMessage(capture.GetSample(s), &msg);
+        fusion.OnMessage(msg);
+        time    += msg.TimeDelta;
+        times[s] = time;
+    }
+    totals->Seconds = Timer::TicksToSeconds(Timer::GetTicks() - start);
+    fusion.SetPredictor(0);
+
+    UInt32 future = 0;
+    for (UInt32 s = 0; s < numSamples; s++)
+    {
+        const SensorCaptureSample& sample = capture.GetSample(s);
+        Vector3f accel(sample.Acceleration[0], sample.Acceleration[1], sample.Acceleration[2]);
+        Vector3f angVel(sample.RotationRate[0], sample.RotationRate[1], sample.RotationRate[2]);
+
+        // Tilt error while still.
+        float accelLength = accel.Length();
+        if ((fabs(accelLength - 9.81f) < stillGravityEpsilon) &&
+            (angVel.Length() < stillAngVelEpsilon))
+        {
+            Vector3f up       = fused[s].Rotate(accel) / accelLength;
+            float    tiltError = acos(Alg::Clamp(up.y, -1.0f, 1.0f));
+            totals->TiltErrorSum += tiltError;
+            totals->TiltErrorMax  = Alg::Max(totals->TiltErrorMax, tiltError);
+            totals->NumStill++;
+        }
+
+        // Rotation the prediction adds to this sample's step.
+        if (s > 0)
+        {
+            float jitter = angleBetween(predicted[s - 1].Inverted() * predicted[s],
+                                        fused[s - 1].Inverted() * fused[s]);
+            totals->JitterSumSq += jitter * jitter;
+        }
+
+        // Prediction against what came.
+        while (future < numSamples && times[future] < times[s] + params.PredictionDelta)
+            future++;
+        if (future < numSamples)
+        {
+            float error = angleBetween(predicted[s], fused[future]);
+            totals->PredictionErrorSumSq += error * error;
+            totals->PredictionErrorMax    = Alg::Max(totals->PredictionErrorMax, error);
+            totals->NumPredicted++;
+        }
+    }
+}
+
+
+//-------------------------------------------------------------------------------------
+// ***** Work stealing
+
+struct FusionSweep::WorkRange
+{
+    Lock    RangeLock;
+    UPInt   Begin;
+    UPInt   End;
+    // Keeps the next worker's lock off this cache line.
+    UByte   Pad[64];
+};
+
+class FusionSweep::Worker : public Thread
+{
+public:
+    Worker(FusionSweep* sweep, int index) : pSweep(sweep), Index(index) { }
+
+    virtual int Run()
+    {
+        SetThreadName("OVR::FusionSweep");
+
+        UPInt run;
+        while (pSweep->takeRun(Index, &run))
+            pSweep->doRun(run);
+
+        Done.SetEvent();
+        return 0;
+    }
+
+    // Set once there is nothing left to take, for FusionSweep::Run to wait on.
+    Event        Done;
+
+private:
+    FusionSweep* pSweep;
+    int          Index;
+};
+
+bool FusionSweep::takeRun(int worker, UPInt* run)
+{
+    WorkRange& own = pRanges[worker];
+    {
+        Lock::Locker lockScope(&own.RangeLock);
+        if (own.Begin < own.End)
+        {
+            *run = own.Begin++;
+            return true;
+        }
+    }
+
+    // Out of work: take the back half of the largest range left. A worker only ever
+    // shrinks another's range, and refills only its own, so once all are empty none
+    // can fill up again.
+    for (;;)
+    {
+        int   victim = -1;
+        UPInt most   = 0;
+        for (int w = 0; w < NumWorkers; w++)
+        {
+            Lock::Locker lockScope(&pRanges[w].RangeLock);
+            UPInt left = pRanges[w].End - pRanges[w].Begin;
+            if (left > most)
+            {
+                most   = left;
+                victim = w;
+            }
+        }
+        if (victim < 0)
+            return false;
+
+        UPInt begin, end;
+        {
+            WorkRange&   range = pRanges[victim];
+            Lock::Locker lockScope(&range.RangeLock);
+            UPInt        left  = range.End - range.Begin;
+            if (left == 0)
+                continue;
+
+            end         = range.End;
+            begin       = end - (left + 1) / 2;
+            range.End   = begin;
+        }
+        NumSteals.ExchangeAdd_NoSync((UInt32)(end - begin));
+
+        Lock::Locker lockScope(&own.RangeLock);
+        own.Begin = begin + 1;
+        own.End   = end;
+        *run      = begin;
+        return true;
+    }
+}
+
+void FusionSweep::doRun(UPInt run)
+{
+    UPInt numCaptures = Captures.GetSize();
+    runOne(*Captures[run % numCaptures], Configs[run / numCaptures], &Runs[run]);
+}
+
+
+//-------------------------------------------------------------------------------------
+// ***** FusionSweep
+
+FusionSweep::FusionSweep()
+    : pRanges(0), NumWorkers(0), NumSteals(0)
+{
+}
+
+FusionSweep::~FusionSweep()
+{
+    for (UPInt i = 0; i < Captures.GetSize(); i++)
+        delete Captures[i];
+}
+
+bool FusionSweep::AddCapture(const char* path)
+{
+    SensorReplay* capture = new SensorReplay;
+    if (!capture->Open(path))
+    {
+        OVR_DEBUG_LOG(("FusionSweep::AddCapture failed - can't load %s", path));
+        delete capture;
+        return false;
+    }
+    Captures.PushBack(capture);
+    return true;
+}
+
+void FusionSweep::AddConfig(const FusionSweepParams& params)
+{
+    Configs.PushBack(params);
+}
+
+void FusionSweep::AddGrid(const FusionSweepGrid& grid)
+{
+    enum { NumSettings = 7 };
+
+    UPInt sizes[NumSettings] =
+    {
+        grid.AccelGain.GetSize(), grid.TiltGravityEpsilon.GetSize(),
+        grid.TiltAngVelEpsilon.GetSize(), grid.TiltPeriod.GetSize(),
+        grid.AccelWindow.GetSize(), grid.AngVelWindow.GetSize(),
+        grid.PredictionDelta.GetSize()
+    };
+
+    UPInt numConfigs = 1;
+    for (int i = 0; i < NumSettings; i++)
+        numConfigs *= Alg::Max<UPInt>(sizes[i], 1);
+
+    // Counts through every combination, the first setting changing fastest.
+    for (UPInt c = 0; c < numConfigs; c++)
+    {
+        UPInt index[NumSettings];
+        UPInt rest = c;
+        for (int i = 0; i < NumSettings; i++)
+        {
+            UPInt size = Alg::Max<UPInt>(sizes[i], 1);
+            index[i]   = rest % size;
+            rest      /= size;
+        }
+
+        FusionSweepParams params;
+        if (sizes[0]) params.AccelGain          = grid.AccelGain[index[0]];
+        if (sizes[1]) params.TiltGravityEpsilon = grid.TiltGravityEpsilon[index[1]];
+        if (sizes[2]) params.TiltAngVelEpsilon  = grid.TiltAngVelEpsilon[index[2]];
+        if (sizes[3]) params.TiltPeriod         = grid.TiltPeriod[index[3]];
+        if (sizes[4]) params.AccelWindow        = grid.AccelWindow[index[4]];
+        if (sizes[5]) params.AngVelWindow       = grid.AngVelWindow[index[5]];
+        if (sizes[6]) params.PredictionDelta    = grid.PredictionDelta[index[6]];
+        Configs.PushBack(params);
+    }
+}
+
+bool FusionSweep::Run(int numThreads)
+{
+    UPInt numCaptures = Captures.GetSize();
+    UPInt numRuns     = numCaptures * Configs.GetSize();
+    if (numRuns == 0)
+        return false;
+
+    if (numThreads <= 0)
+        numThreads = Thread::GetCPUCount();
+    numThreads = (int)Alg::Min<UPInt>(numThreads, numRuns);
+
+    Runs.Resize(numRuns);
+    NumSteals = 0;
+
+    // Contiguous shares to begin with; the calling thread is worker 0.
+    NumWorkers = numThreads;
+    pRanges    = new WorkRange[numThreads];
+    for (int w = 0; w < numThreads; w++)
+    {
+        pRanges[w].Begin = numRuns * w / numThreads;
+        pRanges[w].End   = numRuns * (w + 1) / numThreads;
+    }
+
+    // A thread that fails to start leaves its share to be stolen.
+    Array<Ptr<Worker> > workers;
+    for (int w = 1; w < numThreads; w++)
+    {
+        Ptr<Worker> worker = *new Worker(this, w);
+        if (worker->Start())
+            workers.PushBack(worker);
+        else
+            OVR_DEBUG_LOG(("FusionSweep::Run - can't start worker %d", w));
+    }
+
+    UPInt run;
+    while (takeRun(0, &run))
+        doRun(run);
+
+    for (UPInt i = 0; i < workers.GetSize(); i++)
+        workers[i]->Done.Wait();
+
+    delete[] pRanges;
+    pRanges    = 0;
+    NumWorkers = 0;
+
+    // Combined in a fixed order, so the scores don't depend on who ran what.
+    Scores.Resize(Configs.GetSize());
+    for (UPInt c = 0; c < Configs.GetSize(); c++)
+    {
+        RunTotals sum;
+        memset(&sum, 0, sizeof(sum));
+        for (UPInt i = 0; i < numCaptures; i++)
+        {
+            const RunTotals& r = Runs[c * numCaptures + i];
+            sum.TiltErrorSum         += r.TiltErrorSum;
+            sum.TiltErrorMax          = Alg::Max(sum.TiltErrorMax, r.TiltErrorMax);
+            sum.NumStill             += r.NumStill;
+            sum.JitterSumSq          += r.JitterSumSq;
+            sum.PredictionErrorSumSq += r.PredictionErrorSumSq;
+            sum.PredictionErrorMax    = Alg::Max(sum.PredictionErrorMax, r.PredictionErrorMax);
+            sum.NumPredicted         += r.NumPredicted;
+            sum.Seconds              += r.Seconds;
+            sum.NumSamples           += r.NumSamples;
+        }
+
+        FusionSweepScore& score  = Scores[c];
+        score.TiltErrorMean      = sum.NumStill ? (float)(sum.TiltErrorSum / sum.NumStill) : 0.0f;
+        score.TiltErrorMax       = sum.TiltErrorMax;
+        score.Jitter             = sum.NumSamples > numCaptures ?
+                                   (float)sqrt(sum.JitterSumSq / (sum.NumSamples - numCaptures)) : 0.0f;
+        score.PredictionErrorRms = sum.NumPredicted ?
+                                   (float)sqrt(sum.PredictionErrorSumSq / sum.NumPredicted) : 0.0f;
+        score.PredictionErrorMax = sum.PredictionErrorMax;
+        score.NsPerSample        = sum.NumSamples ? sum.Seconds * 1e9 / sum.NumSamples : 0.0;
+        score.NumSamples         = sum.NumSamples;
+    }
+
+    Runs.Clear();
+    return true;
+}
+
+
+}} // namespace OVR::Util
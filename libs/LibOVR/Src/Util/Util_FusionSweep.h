@@ -0,0 +1,145 @@
+/************************************************************************************
+
+PublicHeader:   OVR.h
+Filename    :   Util_FusionSweep.h
+Content     :   Runs SensorFusion over recorded captures for a grid of parameters,
+                on all cores, and scores each configuration.
+Created     :   October 19, 2026
+
+Copyright   :   Copyright 2013 Oculus VR, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Oculus license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+*************************************************************************************/
+
+#ifndef OVR_Util_FusionSweep_h
+#define OVR_Util_FusionSweep_h
+
+#include "Util_SensorCapture.h"
+
+namespace OVR { namespace Util {
+
+
+//-------------------------------------------------------------------------------------
+// ***** FusionSweepParams
+
+// The SensorFusion settings a sweep varies. The constructor gives SensorFusion's defaults.
+struct FusionSweepParams
+{
+    float   AccelGain;
+    float   TiltGravityEpsilon;
+    float   TiltAngVelEpsilon;
+    int     TiltPeriod;
+    int     AccelWindow;
+    int     AngVelWindow;
+    float   PredictionDelta;
+
+    FusionSweepParams();
+
+    void    Apply(SensorFusion* fusion) const;
+};
+
+// Values to try for each setting; the sweep takes every combination. An empty list
+// leaves that setting at its default.
+struct FusionSweepGrid
+{
+    ArrayPOD<float> AccelGain;
+    ArrayPOD<float> TiltGravityEpsilon;
+    ArrayPOD<float> TiltAngVelEpsilon;
+    ArrayPOD<int>   TiltPeriod;
+    ArrayPOD<int>   AccelWindow;
+    ArrayPOD<int>   AngVelWindow;
+    ArrayPOD<float> PredictionDelta;
+};
+
+// How a configuration did, over all captures. Angles are in radians.
+struct FusionSweepScore
+{
+    // Angle between the fused up direction and the measured gravity, over the samples
+    // where the headset is close to still; what is left of pitch and roll drift.
+    float   TiltErrorMean;
+    float   TiltErrorMax;
+    // RMS per-sample rotation the prediction adds on top of the fused motion.
+    float   Jitter;
+    // Angle between the predicted orientation and the fused one PredictionDelta later.
+    float   PredictionErrorRms;
+    float   PredictionErrorMax;
+    // Fusion and prediction cost.
+    double  NsPerSample;
+    UInt32  NumSamples;
+};
+
+
+//-------------------------------------------------------------------------------------
+// ***** FusionSweep
+
+// FusionSweep loads a set of captures and plays each through a separate SensorFusion for
+// every configuration, each run independent of the others. Runs are spread over a pool
+// of threads: each thread starts on its own share and, when done, steals half of what is
+// left from the thread with the most, so slow captures don't leave cores idle. Scores
+// don't depend on the number of threads.
+
+class FusionSweep : public NewOverrideBase
+{
+public:
+    FusionSweep();
+    ~FusionSweep();
+
+    bool        AddCapture(const char* path);
+    void        AddConfig(const FusionSweepParams& params);
+    void        AddGrid(const FusionSweepGrid& grid);
+
+    UPInt       GetNumCaptures() const { return Captures.GetSize(); }
+    UPInt       GetNumConfigs() const  { return Configs.GetSize(); }
+
+    // Runs every configuration over every capture on numThreads threads, 0 for one per
+    // CPU, and blocks until done.
+    bool        Run(int numThreads = 0);
+
+    const FusionSweepParams& GetParams(UPInt config) const { return Configs[config]; }
+    const FusionSweepScore&  GetScore(UPInt config) const  { return Scores[config]; }
+
+    // Runs taken from another thread during the last Run.
+    UInt32      GetNumSteals() const { return NumSteals; }
+
+private:
+    class Worker;
+    struct WorkRange;
+
+    // What one run of a configuration over a capture leaves for Run to combine.
+    struct RunTotals
+    {
+        double  TiltErrorSum;
+        float   TiltErrorMax;
+        UInt32  NumStill;
+        double  JitterSumSq;
+        double  PredictionErrorSumSq;
+        float   PredictionErrorMax;
+        UInt32  NumPredicted;
+        double  Seconds;
+        UInt32  NumSamples;
+    };
+
+    static void runOne(const SensorReplay& capture, const FusionSweepParams& params,
+                       RunTotals* totals);
+    bool        takeRun(int worker, UPInt* run);
+    void        doRun(UPInt run);
+
+    Array<SensorReplay*>       Captures;
+    Array<FusionSweepParams>   Configs;
+    Array<FusionSweepScore>    Scores;
+
+    // Run r is configuration r / GetNumCaptures() over capture r % GetNumCaptures().
+    // Each worker owns a range of runs still to do while Run is going.
+    WorkRange*                 pRanges;
+    int                        NumWorkers;
+    ArrayPOD<RunTotals>        Runs;
+    AtomicInt<UInt32>          NumSteals;
+};
+
+
+}} // namespace OVR::Util
+
+#endif // OVR_Util_FusionSweep_h
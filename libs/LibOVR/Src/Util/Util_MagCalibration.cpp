@@ -17,6 +17,190 @@ otherwise accompanies this software in either electronic or hard copy form.
 
 namespace OVR { namespace Util {
 
+//-------------------------------------------------------------------------------------
+// ***** MagFit
+
+// Sphere: |m - c|^2 = r^2 is linear in (2c, r^2 - |c|^2) with the regressors (x, y, z, 1)
+// and |m|^2 as the target.
+// Ellipsoid: x^2 + B y^2 + C z^2 - D x - E y - F z - G = 0 is linear in (B, C, D, E, F, G)
+// with the regressors (-y^2, -z^2, x, y, z, 1) and x^2 as the target.
+
+template<int N>
+static void accumulateNormal(double (&normal)[N][N], double (&rhs)[N], double* targetSq,
+                             const double (&row)[N], double target)
+{
+    for (int i = 0; i < N; i++)
+    {
+        for (int j = i; j < N; j++)
+            normal[i][j] += row[i] * row[j];
+        rhs[i] += row[i] * target;
+    }
+    *targetSq += target * target;
+}
+
+// Solves the normal equations by Gaussian elimination with partial pivoting, and returns
+// the sum of squared residuals of the solution.
+template<int N>
+static bool solveNormal(const double (&normal)[N][N], const double (&rhs)[N], double targetSq,
+                        double (&x)[N], double* residualSq)
+{
+    double a[N][N + 1];
+    double scale = 0;
+    for (int i = 0; i < N; i++)
+    {
+        for (int j = 0; j < N; j++)
+            a[i][j] = (j >= i) ? normal[i][j] : normal[j][i];
+        a[i][N] = rhs[i];
+        scale   = Alg::Max(scale, fabs(normal[i][i]));
+    }
+
+    for (int col = 0; col < N; col++)
+    {
+        int pivot = col;
+        for (int row = col + 1; row < N; row++)
+            if (fabs(a[row][col]) > fabs(a[pivot][col]))
+                pivot = row;
+        if (fabs(a[pivot][col]) <= scale * 1e-12)
+            return false;
+
+        if (pivot != col)
+            for (int j = col; j <= N; j++)
+                Alg::Swap(a[col][j], a[pivot][j]);
+
+        for (int row = col + 1; row < N; row++)
+        {
+            double f = a[row][col] / a[col][col];
+            for (int j = col; j <= N; j++)
+                a[row][j] -= f * a[col][j];
+        }
+    }
+
+    for (int row = N - 1; row >= 0; row--)
+    {
+        double sum = a[row][N];
+        for (int j = row + 1; j < N; j++)
+            sum -= a[row][j] * x[j];
+        x[row] = sum / a[row][row];
+    }
+
+    // |Ax - b|^2 = x'A'Ax - 2x'A'b + b'b
+    double sse = targetSq;
+    for (int i = 0; i < N; i++)
+    {
+        sse -= 2.0 * x[i] * rhs[i];
+        for (int j = 0; j < N; j++)
+            sse += x[i] * x[j] * ((j >= i) ? normal[i][j] : normal[j][i]);
+    }
+    *residualSq = Alg::Max(sse, 0.0);
+    return true;
+}
+
+void MagFit::Clear()
+{
+    NumSamples = 0;
+    Origin     = Vector3f();
+    memset(SphereNormal, 0, sizeof(SphereNormal));
+    memset(SphereRhs, 0, sizeof(SphereRhs));
+    memset(EllipsoidNormal, 0, sizeof(EllipsoidNormal));
+    memset(EllipsoidRhs, 0, sizeof(EllipsoidRhs));
+    SphereTargetSq    = 0;
+    EllipsoidTargetSq = 0;
+}
+
+void MagFit::AddSample(const Vector3f& m)
+{
+    if (NumSamples == 0)
+        Origin = m;
+    NumSamples++;
+
+    double x = m.x - Origin.x;
+    double y = m.y - Origin.y;
+    double z = m.z - Origin.z;
+
+    double sphere[SphereParams] = { x, y, z, 1.0 };
+    accumulateNormal(SphereNormal, SphereRhs, &SphereTargetSq, sphere, x*x + y*y + z*z);
+
+    double ellipsoid[EllipsoidParams] = { -y*y, -z*z, x, y, z, 1.0 };
+    accumulateNormal(EllipsoidNormal, EllipsoidRhs, &EllipsoidTargetSq, ellipsoid, x*x);
+}
+
+bool MagFit::Solve(Model model, Result* result) const
+{
+    double center[3], radii[3], residualSq;
+
+    if (model == Model_Sphere)
+    {
+        double p[SphereParams];
+        if (NumSamples < SphereParams ||
+            !solveNormal(SphereNormal, SphereRhs, SphereTargetSq, p, &residualSq))
+            return false;
+
+        center[0] = p[0] * 0.5;
+        center[1] = p[1] * 0.5;
+        center[2] = p[2] * 0.5;
+        double r2 = p[3] + center[0]*center[0] + center[1]*center[1] + center[2]*center[2];
+        if (r2 <= 0)
+            return false;
+        radii[0] = radii[1] = radii[2] = sqrt(r2);
+    }
+    else
+    {
+        double p[EllipsoidParams];
+        if (NumSamples < EllipsoidParams ||
+            !solveNormal(EllipsoidNormal, EllipsoidRhs, EllipsoidTargetSq, p, &residualSq))
+            return false;
+        if (p[0] <= 0 || p[1] <= 0)
+            return false;
+
+        center[0] = p[2] * 0.5;
+        center[1] = p[3] / (2.0 * p[0]);
+        center[2] = p[4] / (2.0 * p[1]);
+        double r2 = p[5] + center[0]*center[0] + p[0]*center[1]*center[1] + p[1]*center[2]*center[2];
+        if (r2 <= 0)
+            return false;
+        radii[0] = sqrt(r2);
+        radii[1] = sqrt(r2 / p[0]);
+        radii[2] = sqrt(r2 / p[1]);
+    }
+
+    // The algebraic residual is about the distance from the surface times the gradient,
+    // 2 r for a sphere; for the ellipsoid, scaled by x^2, 2 rx^2 / r on average.
+    double meanRadius = (radii[0] + radii[1] + radii[2]) / 3.0;
+    double gradient   = 2.0 * radii[0] * radii[0] / meanRadius;
+
+    result->Center     = Vector3f((float)(center[0] + Origin.x), (float)(center[1] + Origin.y),
+                                  (float)(center[2] + Origin.z));
+    result->Radii      = Vector3f((float)radii[0], (float)radii[1], (float)radii[2]);
+    result->Residual   = (float)(sqrt(residualSq / NumSamples) / gradient);
+    result->NumSamples = NumSamples;
+    return true;
+}
+
+Matrix4f MagFit::Result::GetCalibrationMatrix() const
+{
+    float    meanRadius = (Radii.x + Radii.y + Radii.z) / 3.0f;
+    Vector3f scale(meanRadius / Radii.x, meanRadius / Radii.y, meanRadius / Radii.z);
+
+    Matrix4f calMat;
+    calMat.M[0][0] = scale.x;
+    calMat.M[1][1] = scale.y;
+    calMat.M[2][2] = scale.z;
+    calMat.M[0][3] = -scale.x * Center.x;
+    calMat.M[1][3] = -scale.y * Center.y;
+    calMat.M[2][3] = -scale.z * Center.z;
+    return calMat;
+}
+
+
+//-------------------------------------------------------------------------------------
+// ***** MagCalibration
+
+MagCalibration::~MagCalibration()
+{
+    if (pStreamFusion)
+        EndStreamingCalibration(*pStreamFusion);
+}
+
 void MagCalibration::BeginAutoCalibration(SensorFusion& sf)
 {
     Status = Mag_AutoCalibrating;
@@ -115,6 +299,92 @@ bool MagCalibration::SetCalibration(SensorFusion& sf)
 }
 
 
+void MagCalibration::BeginStreamingCalibration(SensorFusion& sf, MagFit::Model model)
+{
+    if (pStreamFusion)
+        EndStreamingCalibration(*pStreamFusion);
+
+    Status = Mag_StreamCalibrating;
+    sf.ClearMagReference();
+    sf.ClearMagCalibration();
+
+    // Hooked in under the handler lock, which the delegate is called with.
+    Lock::Locker lockScope(Streamer.GetHandlerLock());
+    StreamModel          = model;
+    StreamFit.Clear();
+    StreamResult         = MagFit::Result();
+    Streamer.pNext       = sf.GetDelegateMessageHandler();
+    sf.SetDelegateMessageHandler(&Streamer);
+    pStreamFusion        = &sf;
+}
+
+unsigned MagCalibration::UpdateStreamingCalibration(SensorFusion& sf)
+{
+    if (pStreamFusion != &sf)
+        return Status;
+
+    // The sums are small; solving is done on a copy, off the lock.
+    MagFit fit;
+    {
+        Lock::Locker lockScope(Streamer.GetHandlerLock());
+        fit = StreamFit;
+    }
+
+    MagFit::Result result;
+    if (fit.GetNumSamples() < MinStreamSamples || !fit.Solve(StreamModel, &result))
+        return Status;
+    StreamResult = result;
+
+    if (result.Residual > MaxStreamResidual)
+        return Status;
+    if (Status == Mag_Calibrated && (result.Center - AppliedCenter).Length() <= StreamMoveLimit)
+        return Status;
+
+    // A reference taken under the old calibration is in a frame the new one no longer
+    // maps to; keeping it would show up as a yaw error. Drop it before switching over.
+    MagCenter     = result.Center;
+    AppliedCenter = result.Center;
+    sf.ClearMagReference();
+    sf.SetMagCalibration(result.GetCalibrationMatrix());
+    Status = Mag_Calibrated;
+    return Status;
+}
+
+void MagCalibration::EndStreamingCalibration(SensorFusion& sf)
+{
+    if (pStreamFusion != &sf)
+        return;
+
+    Lock::Locker lockScope(Streamer.GetHandlerLock());
+    if (sf.GetDelegateMessageHandler() == &Streamer)
+        sf.SetDelegateMessageHandler(Streamer.pNext);
+    Streamer.pNext = 0;
+    pStreamFusion  = 0;
+    if (Status == Mag_StreamCalibrating)
+        Status = Mag_Uninitialized;
+}
+
+void MagCalibration::StreamHandler::OnMessage(const Message& msg)
+{
+    if (msg.Type == Message_BodyFrame)
+    {
+        const MessageBodyFrame& frame = static_cast<const MessageBodyFrame&>(msg);
+        MagCalibration*         cal   = pCalibration;
+
+        if (cal->StreamFit.GetNumSamples() == 0 ||
+            (frame.MagneticField - cal->LastStreamSample).LengthSq() >
+                cal->StreamSpacing * cal->StreamSpacing)
+        {
+            cal->StreamFit.AddSample(frame.MagneticField);
+            cal->LastStreamSample = frame.MagneticField;
+        }
+    }
+
+    if (pNext)
+        pNext->OnMessage(msg);
+}
+
+
 // Calculate the center of a sphere that passes through p1, p2, p3, p4
 Vector3f MagCalibration::CalculateSphereCenter(const Vector3f& p1, const Vector3f& p2,
                                                const Vector3f& p3, const Vector3f& p4) 
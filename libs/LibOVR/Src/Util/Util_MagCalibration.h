@@ -23,6 +23,71 @@ otherwise accompanies this software in either electronic or hard copy form.
 
 namespace OVR { namespace Util {
 
+//-------------------------------------------------------------------------------------
+// ***** MagFit
+
+// Least-squares fit of a sphere, or of an ellipsoid aligned with the sensor axes, to
+// magnetometer readings. Each sample only adds to the sums of the normal equations, in
+// constant time and without allocating, and Solve can be called at any point. The sums
+// are kept in double and relative to the first sample, which keeps them well conditioned.
+
+class MagFit
+{
+public:
+    enum Model
+    {
+        Model_Sphere,       // Hard iron only, an offset.
+        Model_Ellipsoid     // Hard iron and soft iron scaling along the sensor axes.
+    };
+
+    struct Result
+    {
+        Vector3f    Center;     // Offset of the readings.
+        Vector3f    Radii;      // All the same for a sphere.
+        // RMS distance of the samples from the fitted surface, approximately; small next
+        // to the radii for a good fit.
+        float       Residual;
+        unsigned    NumSamples;
+
+        // Calibration for SensorFusion::SetMagCalibration; an ellipsoid is scaled to a
+        // sphere of the mean radius.
+        Matrix4f    GetCalibrationMatrix() const;
+    };
+
+    MagFit() { Clear(); }
+
+    void     Clear();
+    void     AddSample(const Vector3f& m);
+    unsigned GetNumSamples() const { return NumSamples; }
+
+    // Fails while the samples don't pin the model down, for instance while they all lie
+    // close to one plane.
+    bool     Solve(Model model, Result* result) const;
+
+private:
+    enum
+    {
+        SphereParams    = 4,
+        EllipsoidParams = 6
+    };
+
+    unsigned NumSamples;
+    Vector3f Origin;
+
+    // Upper triangles of the normal matrices, their right hand sides, and the sums of
+    // the squared targets for the residual.
+    double   SphereNormal[SphereParams][SphereParams];
+    double   SphereRhs[SphereParams];
+    double   SphereTargetSq;
+    double   EllipsoidNormal[EllipsoidParams][EllipsoidParams];
+    double   EllipsoidRhs[EllipsoidParams];
+    double   EllipsoidTargetSq;
+};
+
+
+//-------------------------------------------------------------------------------------
+// ***** MagCalibration
+
 class MagCalibration
 {
 public:
@@ -32,16 +97,20 @@ public:
         Mag_AutoCalibrating = 1,
         Mag_ManuallyCalibrating = 2,
         Mag_Calibrated  = 3,
+        Mag_StreamCalibrating = 4,
     };
 
     MagCalibration() :
         Status(Mag_Uninitialized),
         MinMagDistance(0.3f), MinQuatDistance(0.5f),
-        SampleCount(0)
+        SampleCount(0),
+        Streamer(getThis()), pStreamFusion(0), StreamModel(MagFit::Model_Sphere),
+        StreamSpacing(0.02f), MinStreamSamples(100), MaxStreamResidual(0.01f), StreamMoveLimit(0.01f)
     {
         MinMagDistanceSq = MinMagDistance * MinMagDistance;
         MinQuatDistanceSq = MinQuatDistance * MinQuatDistance;
     }
+    ~MagCalibration();
 
     // Methods that are useful for either auto or manual calibration
     bool     IsUnitialized() const     { return Status == Mag_Uninitialized; }
@@ -62,6 +131,29 @@ public:
     bool     SetCalibration(SensorFusion& sf);
     bool     IsManuallyCalibrating() const { return Status == Mag_ManuallyCalibrating; }
 
+    // Methods for streaming calibration, which needs no particular motion. Every raw reading
+    // the fusion integrates that is StreamSpacing away from the last one taken goes into a
+    // MagFit, from the thread doing the integration. UpdateStreamingCalibration solves the fit
+    // and, once there are MinStreamSamples and the residual is under MaxStreamResidual, sets
+    // the calibration; after that it keeps fitting and replaces the calibration when the
+    // center has moved by more than StreamMoveLimit, clearing the fusion's mag reference,
+    // which has to be set again. Takes the fusion's delegate handler slot, passing
+    // messages on to whatever handler was there.
+    void     BeginStreamingCalibration(SensorFusion& sf, MagFit::Model model = MagFit::Model_Sphere);
+    unsigned UpdateStreamingCalibration(SensorFusion& sf);
+    void     EndStreamingCalibration(SensorFusion& sf);
+    bool     IsStreamCalibrating() const { return pStreamFusion != 0; }
+    // The last fit UpdateStreamingCalibration solved.
+    const MagFit::Result& GetStreamResult() const { return StreamResult; }
+
+    void     SetStreamThresholds(float spacing, unsigned minSamples, float maxResidual, float moveLimit)
+    {
+        StreamSpacing     = spacing;
+        MinStreamSamples  = minSamples;
+        MaxStreamResidual = maxResidual;
+        StreamMoveLimit   = moveLimit;
+    }
+
     // This is the minimum acceptable distance (Euclidean) between raw
     // magnetometer values to be acceptable for usage in calibration.
     void SetMinMagDistance(float dist) 
@@ -83,6 +175,8 @@ public:
     Vector3f GetMagCenter() const { return MagCenter; }
 
 private:
+    MagCalibration* getThis() { return this; }
+
     // Determine the unique sphere through 4 non-coplanar points
     Vector3f CalculateSphereCenter(const Vector3f& p1, const Vector3f& p2,
                                    const Vector3f& p3, const Vector3f& p4);
@@ -102,6 +196,29 @@ private:
     Vector3f MagSamples[4];
     Quatf    QuatSamples[4];
 
+    // Streaming calibration. StreamFit and LastStreamSample change under the handler lock.
+    class StreamHandler : public MessageHandler
+    {
+    public:
+        StreamHandler(MagCalibration* cal) : pCalibration(cal), pNext(0) { }
+
+        virtual void OnMessage(const Message& msg);
+
+        MagCalibration* pCalibration;
+        MessageHandler* pNext;
+    };
+
+    StreamHandler  Streamer;
+    SensorFusion*  pStreamFusion;
+    MagFit::Model  StreamModel;
+    MagFit         StreamFit;
+    Vector3f       LastStreamSample;
+    MagFit::Result StreamResult;
+    Vector3f       AppliedCenter;
+    float          StreamSpacing;
+    unsigned       MinStreamSamples;
+    float          MaxStreamResidual;
+    float          StreamMoveLimit;
 };
 
 }}
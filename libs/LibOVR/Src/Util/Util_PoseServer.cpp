@@ -0,0 +1,389 @@
+/************************************************************************************
+
+Filename    :   Util_PoseServer.cpp
+Content     :   Publishes the fused head pose into shared memory for other
+                processes, and the client that reads it.
+Created     :   October 19, 2026
+
+Copyright   :   Copyright 2013 Oculus VR, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Oculus license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+*************************************************************************************/
+
+#include "Util_PoseServer.h"
+
+#include "../Kernel/OVR_Alg.h"
+#include "../Kernel/OVR_Atomic.h"
+#include "../Kernel/OVR_Log.h"
+#include "../Kernel/OVR_Std.h"
+
+#if !defined(OVR_OS_WIN32)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace OVR { namespace Util {
+
+//-------------------------------------------------------------------------------------
+// ***** PoseSegment
+
+// Layout of the shared memory. The pose and the history each have their own sequence
+// and start on their own cache line, so that readers of the pose don't retry because of
+// history writes. A sequence is odd while its part is being written.
+struct PoseSegment
+{
+    UInt32          Magic;          // Written last when the server sets the segment up.
+    UInt32          Version;
+    UInt32          Size;
+    UInt32          HistorySize;
+    UInt32          HeaderPad[12];
+
+    volatile UInt32 PoseSequence;
+    UInt32          PosePad;
+    SharedPose      Pose;
+    UInt32          PosePad2[12];
+
+    volatile UInt32 HistorySequence;
+    volatile UInt32 HistoryCount;   // Samples written since the segment was created.
+    UInt32          HistoryPad[14];
+    SharedSample    History[PoseServer_HistorySize];
+};
+
+enum
+{
+    PoseSegment_Magic   = 0x5053564F, // "OVSP"
+    PoseSegment_Version = 1,
+
+    // A reader gives up after this many torn copies; only happens if the server died while writing.
+    PoseSegment_MaxReadTries = 10000
+};
+
+// Copy to and from the segment word by word through volatile pointers, so that the compiler
+// can't move any of it to the other side of the sequence loads and stores around it. The
+// local side goes through memcpy, reading a SharedPose as UInt32 words directly would break
+// strict aliasing and let the optimizer drop the stores to it.
+template<class T>
+static void writeShared(volatile T* dest, const T& src)
+{
+    UInt32 words[sizeof(T) / sizeof(UInt32)];
+    memcpy(words, &src, sizeof(T));
+
+    volatile UInt32* destWords = (volatile UInt32*)dest;
+    for (UPInt i = 0; i < sizeof(T) / sizeof(UInt32); i++)
+        destWords[i] = words[i];
+}
+
+template<class T>
+static void readShared(T* dest, const volatile T* src)
+{
+    UInt32 words[sizeof(T) / sizeof(UInt32)];
+
+    const volatile UInt32* srcWords = (const volatile UInt32*)src;
+    for (UPInt i = 0; i < sizeof(T) / sizeof(UInt32); i++)
+        words[i] = srcWords[i];
+
+    memcpy(dest, words, sizeof(T));
+}
+
+static void beginWrite(volatile UInt32* sequence)
+{
+    // Full fence, the data must not be written before readers can see the odd sequence.
+    AtomicOps<UInt32>::Exchange_Sync(sequence, *sequence + 1);
+}
+
+static void endWrite(volatile UInt32* sequence)
+{
+    AtomicOps<UInt32>::Store_Release(sequence, *sequence + 1);
+}
+
+static bool readDone(const volatile UInt32* sequence, UInt32 before)
+{
+    // The copy must be done reading before the sequence is read again.
+    { AtomicOpsRawBase::FullSync sync; OVR_UNUSED(sync); }
+    return AtomicOps<UInt32>::Load_Acquire(sequence) == before;
+}
+
+
+//-------------------------------------------------------------------------------------
+// ***** PoseServer
+
+PoseServer::PoseServer()
+  : Handler(getThis()), pFusion(0), pSegment(0)
+{
+    OVR_COMPILER_ASSERT(sizeof(SharedPose) == 72);
+    OVR_COMPILER_ASSERT(sizeof(SharedSample) == 48);
+    Name[0] = 0;
+}
+
+PoseServer::~PoseServer()
+{
+    SetFusion(0);
+    Close();
+}
+
+#if !defined(OVR_OS_WIN32)
+
+bool PoseServer::Open(const char* name)
+{
+    Close();
+
+    int fd = shm_open(name, O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        LogError("PoseServer - can't create shared memory '%s'", name);
+        return false;
+    }
+
+    void* memory = MAP_FAILED;
+    if (ftruncate(fd, sizeof(PoseSegment)) == 0)
+        memory = mmap(0, sizeof(PoseSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (memory == MAP_FAILED)
+    {
+        LogError("PoseServer - can't map shared memory '%s'", name);
+        shm_unlink(name);
+        return false;
+    }
+
+    PoseSegment* segment = (PoseSegment*)memory;
+
+    // Taking over from a server that went away; clients may still have it mapped, so keep
+    // the sequences going rather than starting over, and finish a write that was cut short.
+    if (segment->Magic == PoseSegment_Magic && segment->Version == PoseSegment_Version &&
+        segment->Size == sizeof(PoseSegment))
+    {
+        if (segment->PoseSequence & 1)
+            endWrite(&segment->PoseSequence);
+        if (segment->HistorySequence & 1)
+            endWrite(&segment->HistorySequence);
+    }
+    else
+    {
+        // Value-initialized, which zeroes the plain fields and sets up the Quatf/Vector3f members.
+        segment = ::new(memory) PoseSegment();
+        segment->Version     = PoseSegment_Version;
+        segment->Size        = sizeof(PoseSegment);
+        segment->HistorySize = PoseServer_HistorySize;
+        AtomicOps<UInt32>::Store_Release(&segment->Magic, PoseSegment_Magic);
+    }
+
+    OVR_strcpy(Name, sizeof(Name), name);
+    pSegment = segment;
+    return true;
+}
+
+void PoseServer::Close()
+{
+    if (!pSegment)
+        return;
+
+    // Stop the device thread from publishing before the memory goes away.
+    Lock::Locker lockScope(Handler.GetHandlerLock());
+
+    munmap(pSegment, sizeof(PoseSegment));
+    shm_unlink(Name);
+    pSegment = 0;
+}
+
+#else // OVR_OS_WIN32
+
+bool PoseServer::Open(const char* name)
+{
+    LogError("PoseServer - shared memory is not supported on this platform ('%s')", name);
+    return false;
+}
+
+void PoseServer::Close()
+{
+}
+
+#endif
+
+void PoseServer::SetFusion(SensorFusion* fusion)
+{
+    if (pFusion)
+    {
+        // The delegate is called with the handler lock held, on the device thread or the
+        // fusion's own thread; taking it waits for a sample that is still being published.
+        Lock::Locker lockScope(Handler.GetHandlerLock());
+        pFusion->SetDelegateMessageHandler(0);
+    }
+
+    pFusion = fusion;
+    if (pFusion)
+        pFusion->SetDelegateMessageHandler(&Handler);
+}
+
+void PoseServer::Publish(const SensorState& state, const MessageBodyFrame* sample)
+{
+    Lock::Locker lockScope(Handler.GetHandlerLock());
+    if (!pSegment)
+        return;
+
+    // History first, so that whoever sees the pose of a sample can find the sample too.
+    if (sample)
+    {
+        SharedSample shared;
+        shared.Acceleration  = sample->Acceleration;
+        shared.RotationRate  = sample->RotationRate;
+        shared.MagneticField = sample->MagneticField;
+        shared.Temperature   = sample->Temperature;
+        shared.TimeDelta     = sample->TimeDelta;
+        shared.SampleIndex   = state.SampleIndex;
+
+        beginWrite(&pSegment->HistorySequence);
+        writeShared<SharedSample>(&pSegment->History[pSegment->HistoryCount % PoseServer_HistorySize], shared);
+        pSegment->HistoryCount++;
+        endWrite(&pSegment->HistorySequence);
+    }
+
+    SharedPose pose;
+    pose.Orientation     = state.Orientation;
+    pose.Predicted       = state.Predicted;
+    pose.Acceleration    = state.Acceleration;
+    pose.AngularVelocity = state.AngularVelocity;
+    pose.SampleTime      = state.SampleTime;
+    pose.PredictionDelta = state.PredictionDelta;
+    pose.SampleIndex     = state.SampleIndex;
+
+    beginWrite(&pSegment->PoseSequence);
+    writeShared<SharedPose>(&pSegment->Pose, pose);
+    endWrite(&pSegment->PoseSequence);
+}
+
+PoseServer::BodyFrameHandler::~BodyFrameHandler()
+{
+    RemoveHandlerFromDevices();
+}
+
+void PoseServer::BodyFrameHandler::OnMessage(const Message& msg)
+{
+    // Called after the fusion has integrated the sample, as its delegate or by SensorReplay.
+    if (msg.Type == Message_BodyFrame && pServer->pFusion)
+        pServer->Publish(pServer->pFusion->GetSensorState(), static_cast<const MessageBodyFrame*>(&msg));
+}
+
+bool PoseServer::BodyFrameHandler::SupportsMessageType(MessageType type) const
+{
+    return (type == Message_BodyFrame);
+}
+
+
+//-------------------------------------------------------------------------------------
+// ***** PoseClient
+
+PoseClient::PoseClient()
+  : pSegment(0)
+{
+}
+
+PoseClient::~PoseClient()
+{
+    Close();
+}
+
+#if !defined(OVR_OS_WIN32)
+
+bool PoseClient::Open(const char* name)
+{
+    Close();
+
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    void* memory = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && info.st_size >= (off_t)sizeof(PoseSegment))
+        memory = mmap(0, sizeof(PoseSegment), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (memory == MAP_FAILED)
+        return false;
+
+    const PoseSegment* segment = (const PoseSegment*)memory;
+    if (AtomicOps<UInt32>::Load_Acquire(&segment->Magic) != PoseSegment_Magic ||
+        segment->Version != PoseSegment_Version || segment->Size != sizeof(PoseSegment))
+    {
+        munmap(memory, sizeof(PoseSegment));
+        return false;
+    }
+
+    pSegment = segment;
+    return true;
+}
+
+void PoseClient::Close()
+{
+    if (pSegment)
+        munmap((void*)pSegment, sizeof(PoseSegment));
+    pSegment = 0;
+}
+
+#else // OVR_OS_WIN32
+
+bool PoseClient::Open(const char* name)
+{
+    OVR_UNUSED(name);
+    return false;
+}
+
+void PoseClient::Close()
+{
+}
+
+#endif
+
+bool PoseClient::ReadPose(SharedPose* pose) const
+{
+    if (!pSegment)
+        return false;
+
+    for (int tries = 0; tries < PoseSegment_MaxReadTries; tries++)
+    {
+        UInt32 before = AtomicOps<UInt32>::Load_Acquire(&pSegment->PoseSequence);
+        if (before & 1)
+            continue;
+
+        readShared<SharedPose>(pose, &pSegment->Pose);
+
+        if (readDone(&pSegment->PoseSequence, before))
+            return (before != 0);
+    }
+    return false;
+}
+
+unsigned PoseClient::ReadHistory(SharedSample* samples, unsigned maxSamples) const
+{
+    if (!pSegment)
+        return 0;
+
+    for (int tries = 0; tries < PoseSegment_MaxReadTries; tries++)
+    {
+        UInt32 before = AtomicOps<UInt32>::Load_Acquire(&pSegment->HistorySequence);
+        if (before & 1)
+            continue;
+
+        UInt32   count      = pSegment->HistoryCount;
+        unsigned numSamples = Alg::Min<UInt32>(Alg::Min<UInt32>(count, PoseServer_HistorySize), maxSamples);
+
+        for (unsigned i = 0; i < numSamples; i++)
+        {
+            UInt32 index = (count - numSamples + i) % PoseServer_HistorySize;
+            readShared<SharedSample>(&samples[i], &pSegment->History[index]);
+        }
+
+        if (readDone(&pSegment->HistorySequence, before))
+            return numSamples;
+    }
+    return 0;
+}
+
+
+}} // namespace OVR::Util
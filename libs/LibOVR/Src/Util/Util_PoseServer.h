@@ -0,0 +1,154 @@
+/************************************************************************************
+
+PublicHeader:   OVR.h
+Filename    :   Util_PoseServer.h
+Content     :   Publishes the fused head pose into shared memory for other
+                processes, and the client that reads it.
+Created     :   October 19, 2026
+
+Copyright   :   Copyright 2013 Oculus VR, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Oculus license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+*************************************************************************************/
+
+#ifndef OVR_Util_PoseServer_h
+#define OVR_Util_PoseServer_h
+
+#include "../OVR_Device.h"
+#include "../OVR_SensorFusion.h"
+
+namespace OVR { namespace Util {
+
+// Name of the shared memory segment when none is given.
+#define OVR_POSESERVER_DEFAULT_NAME "/ovr_pose"
+
+
+//-------------------------------------------------------------------------------------
+// ***** SharedPose, SharedSample
+
+// What the pose server publishes; plain data of fixed layout, the same in every process.
+struct SharedPose
+{
+    Quatf       Orientation;
+    Quatf       Predicted;        // Same as Orientation if prediction is off.
+    Vector3f    Acceleration;
+    Vector3f    AngularVelocity;
+    double      SampleTime;       // Timer::GetTicks() in seconds of the server, 0 before the first sample.
+    float       PredictionDelta;
+    UInt32      SampleIndex;
+};
+
+// A raw sensor reading as the fusion got it.
+struct SharedSample
+{
+    Vector3f    Acceleration;
+    Vector3f    RotationRate;
+    Vector3f    MagneticField;
+    float       Temperature;
+    float       TimeDelta;
+    UInt32      SampleIndex;
+};
+
+enum
+{
+    PoseServer_HistorySize = 256 // Raw samples kept in the segment, about a quarter second at 1kHz.
+};
+
+
+struct PoseSegment;
+
+
+//-------------------------------------------------------------------------------------
+// ***** PoseServer
+
+// Only one process can own the HID device. PoseServer lets that process share what its
+// SensorFusion makes with others: the latest pose, the predicted pose and a history of
+// raw samples go into a POSIX shared memory segment, each part guarded by a sequence
+// lock. The writer never waits for readers and readers never block the writer, a read
+// costs about as much as the cache misses on the pose itself.
+//
+// With SetFusion the server becomes the fusion's delegate message handler and publishes
+// on the device thread (or the fusion thread), right after each sample is integrated. A fusion fed by hand
+// (SensorReplay) doesn't call its delegate, so also pass GetMessageHandler() as the
+// listener there, or call Publish after each SensorFusion::OnMessage.
+//
+// Only implemented for POSIX systems; on Windows Open returns false.
+
+class PoseServer : public NewOverrideBase
+{
+public:
+    PoseServer();
+    ~PoseServer();
+
+    // Creates the segment, or takes over one left behind by a server that died.
+    bool        Open(const char* name = OVR_POSESERVER_DEFAULT_NAME);
+    // Unmaps and removes the segment; clients that have it mapped keep reading the last pose.
+    void        Close();
+    bool        IsOpen() const { return pSegment != 0; }
+
+    // Publishes from every sample fusion integrates; 0 detaches.
+    void        SetFusion(SensorFusion* fusion);
+
+    // For when the fusion is fed by hand; publishes the state of the fusion given to
+    // SetFusion with each BodyFrame.
+    MessageHandler* GetMessageHandler() { return &Handler; }
+
+    void        Publish(const SensorState& state, const MessageBodyFrame* sample = 0);
+
+private:
+    PoseServer* getThis()  { return this; }
+
+    class BodyFrameHandler : public MessageHandler
+    {
+        PoseServer* pServer;
+    public:
+        BodyFrameHandler(PoseServer* server) : pServer(server) { }
+        ~BodyFrameHandler();
+
+        virtual void OnMessage(const Message& msg);
+        virtual bool SupportsMessageType(MessageType type) const;
+    };
+
+    BodyFrameHandler  Handler;
+    SensorFusion*     pFusion;
+    PoseSegment*      pSegment;
+    char              Name[64];
+};
+
+
+//-------------------------------------------------------------------------------------
+// ***** PoseClient
+
+// PoseClient maps a pose server's segment read-only. Reads never block; they retry the
+// copy while the server is in the middle of writing, which is only ever a few hundred
+// nanoseconds. A client can be opened before the server and after it restarted, Open
+// simply fails until the segment is there.
+
+class PoseClient : public NewOverrideBase
+{
+public:
+    PoseClient();
+    ~PoseClient();
+
+    bool        Open(const char* name = OVR_POSESERVER_DEFAULT_NAME);
+    void        Close();
+    bool        IsOpen() const { return pSegment != 0; }
+
+    // False if not open or nothing has been published yet.
+    bool        ReadPose(SharedPose* pose) const;
+
+    // Copies up to maxSamples of the latest raw samples, oldest first, and returns
+    // how many were copied.
+    unsigned    ReadHistory(SharedSample* samples, unsigned maxSamples) const;
+
+private:
+    const PoseSegment* pSegment;
+};
+
+
+}} // namespace OVR::Util
+
+#endif // OVR_Util_PoseServer_h
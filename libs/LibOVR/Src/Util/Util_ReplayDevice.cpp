@@ -0,0 +1,488 @@
+/************************************************************************************
+
+Filename    :   Util_ReplayDevice.cpp
+Content     :   A DeviceManager whose sensors play back a capture through the same
+                HID report path as the headset's sensor.
+Created     :   October 19, 2026
+
+Copyright   :   Copyright 2013 Oculus VR, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Oculus license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+*************************************************************************************/
+
+#include "Util_ReplayDevice.h"
+
+#include "../Kernel/OVR_Timer.h"
+#include "../Kernel/OVR_Std.h"
+#include "../Kernel/OVR_Log.h"
+#include "../Kernel/OVR_Alg.h"
+
+namespace OVR { namespace Util {
+
+//-------------------------------------------------------------------------------------
+// ***** Tracker report encoding
+
+// The layout SensorDevice decodes; see TrackerSensors::Decode.
+enum
+{
+    Replay_VendorId         = 0x2833,
+    Replay_ProductId        = 0x0001,
+
+    Replay_ReportSize       = 62,
+    Replay_FeatureSize      = 64,
+    Replay_MaxFeatureId     = 16,
+
+    Replay_ConfigReportId   = 2,
+    Replay_ConfigFlagsByte  = 3,
+    Replay_SensorCoordFlag  = 0x40
+};
+
+static void encodeSInt16(UByte* buffer, SInt32 value)
+{
+    value     = Alg::Clamp<SInt32>(value, -32768, 32767);
+    buffer[0] = UByte(value & 0xFF);
+    buffer[1] = UByte((value >> 8) & 0xFF);
+}
+
+// Inverse of UnpackSensor: three 21 bit values, high bits first.
+static void packSensor(UByte* buffer, SInt32 x, SInt32 y, SInt32 z)
+{
+    const SInt32 limit = (1 << 20) - 1;
+    x = Alg::Clamp<SInt32>(x, -limit, limit);
+    y = Alg::Clamp<SInt32>(y, -limit, limit);
+    z = Alg::Clamp<SInt32>(z, -limit, limit);
+
+    buffer[0] = UByte(x >> 13);
+    buffer[1] = UByte(x >> 5);
+    buffer[2] = UByte(((x & 0x1F) << 3) | ((y >> 18) & 0x07));
+    buffer[3] = UByte(y >> 10);
+    buffer[4] = UByte(y >> 2);
+    buffer[5] = UByte(((y & 0x03) << 6) | ((z >> 15) & 0x3F));
+    buffer[6] = UByte(z >> 7);
+    buffer[7] = UByte((z & 0x7F) << 1);
+}
+
+// To the sensor's 10^-4 units, to nearest.
+static SInt32 toFixed(float value)
+{
+    float scaled = value * 10000.0f;
+    return (SInt32)((scaled < 0.0f) ? (scaled - 0.5f) : (scaled + 0.5f));
+}
+
+
+//-------------------------------------------------------------------------------------
+// ***** ReplayHIDDevice
+
+// A sensor's HID device. Feature reports are kept as they were set and handed back, with
+// the config's sensor coordinates flag dropped for old firmware; reports never set, display
+// info among them, fail as they would on a sensor that doesn't have them.
+
+class ReplayHIDDevice : public HIDDevice
+{
+public:
+    ReplayHIDDevice(ReplayDeviceManager* manager, bool open)
+        : pManager(manager), Open(open), Timestamp(0)
+    {
+        memset(FeatureLengths, 0, sizeof(FeatureLengths));
+        if (Open)
+            pManager->addDevice(this);
+    }
+
+    ~ReplayHIDDevice()
+    {
+        if (Open)
+            pManager->removeDevice(this);
+    }
+
+    virtual bool SetFeatureReport(UByte* data, UInt32 length)
+    {
+        if ((length == 0) || (length > Replay_FeatureSize) || (data[0] >= Replay_MaxFeatureId))
+            return false;
+
+        memcpy(FeatureReports[data[0]], data, length);
+        FeatureLengths[data[0]] = length;
+
+        if ((data[0] == Replay_ConfigReportId) && (length > Replay_ConfigFlagsByte) &&
+            !pManager->SensorCoordinates)
+        {
+            FeatureReports[data[0]][Replay_ConfigFlagsByte] &= ~Replay_SensorCoordFlag;
+        }
+        return true;
+    }
+
+    virtual bool GetFeatureReport(UByte* data, UInt32 length)
+    {
+        if ((length == 0) || (data[0] >= Replay_MaxFeatureId) || (FeatureLengths[data[0]] == 0))
+            return false;
+
+        memcpy(data, FeatureReports[data[0]], Alg::Min(length, FeatureLengths[data[0]]));
+        return true;
+    }
+
+    UInt64 OnTicks(UInt64 ticksMks)
+    {
+        return Handler ? Handler->OnTicks(ticksMks) : Timer::MksPerSecond;
+    }
+
+    // Encodes the sample in the frame the sensor reports in and hands it to the handler.
+    void   SendSample(const SensorCaptureSample& sample)
+    {
+        if (!Handler)
+            return;
+
+        bool sensorFrame = (FeatureLengths[Replay_ConfigReportId] > Replay_ConfigFlagsByte) &&
+                           (FeatureReports[Replay_ConfigReportId][Replay_ConfigFlagsByte] &
+                            Replay_SensorCoordFlag);
+
+        const float* a = sample.Acceleration;
+        const float* g = sample.RotationRate;
+        const float* m = sample.MagneticField;
+
+        // Inverses of AccelFromBodyFrameUpdate and the others; the magnetometer has Y and Z swapped.
+        SInt32 accel[3], gyro[3], mag[3];
+        if (sensorFrame)
+        {
+            accel[0] = toFixed(a[0]);  accel[1] = toFixed(a[1]);  accel[2] = toFixed(a[2]);
+            gyro[0]  = toFixed(g[0]);  gyro[1]  = toFixed(g[1]);  gyro[2]  = toFixed(g[2]);
+            mag[0]   = toFixed(m[0]);  mag[1]   = toFixed(m[2]);  mag[2]   = toFixed(m[1]);
+        }
+        else
+        {
+            accel[0] = toFixed(a[0]);  accel[1] = toFixed(-a[2]); accel[2] = toFixed(a[1]);
+            gyro[0]  = toFixed(g[0]);  gyro[1]  = toFixed(-g[2]); gyro[2]  = toFixed(g[1]);
+            mag[0]   = toFixed(m[0]);  mag[1]   = toFixed(m[1]);  mag[2]   = toFixed(-m[2]);
+        }
+
+        int    numSamples = Alg::Clamp((int)(sample.TimeDelta * 1000.0f + 0.5f), 1, 255);
+
+        UByte  report[Replay_ReportSize];
+        memset(report, 0, sizeof(report));
+        report[0] = 1;
+        report[1] = UByte(numSamples);
+        report[2] = UByte(Timestamp & 0xFF);
+        report[3] = UByte(Timestamp >> 8);
+        encodeSInt16(report + 6, (SInt32)(sample.Temperature * 100.0f));
+
+        for (int i = 0; i < Alg::Min(numSamples, 3); i++)
+        {
+            packSensor(report + 8 + 16 * i,  accel[0], accel[1], accel[2]);
+            packSensor(report + 16 + 16 * i, gyro[0],  gyro[1],  gyro[2]);
+        }
+
+        encodeSInt16(report + 56, mag[0]);
+        encodeSInt16(report + 58, mag[1]);
+        encodeSInt16(report + 60, mag[2]);
+
+        // The timestamp is that of the report's first sample.
+        Timestamp = UInt16(Timestamp + numSamples);
+
+        Handler->OnInputReport(report, Replay_ReportSize);
+    }
+
+private:
+    ReplayDeviceManager* pManager;
+    bool                 Open;
+    UInt16               Timestamp;
+    UByte                FeatureReports[Replay_MaxFeatureId][Replay_FeatureSize];
+    UInt32               FeatureLengths[Replay_MaxFeatureId];
+};
+
+
+//-------------------------------------------------------------------------------------
+// ***** ReplayHIDDeviceManager
+
+class ReplayHIDDeviceManager : public HIDDeviceManager
+{
+public:
+    ReplayHIDDeviceManager(ReplayDeviceManager* manager) : pManager(manager) { }
+
+    virtual bool Enumerate(HIDEnumerateVisitor* enumVisitor)
+    {
+        HIDDeviceDesc desc;
+
+        for (unsigned i = 0; pManager->getSensorDesc(i, &desc); i++)
+        {
+            if (!enumVisitor->MatchVendorProduct(desc.VendorId, desc.ProductId))
+                continue;
+
+            Ptr<ReplayHIDDevice> device = *new ReplayHIDDevice(pManager, false);
+            enumVisitor->Visit(*device, desc);
+        }
+        return true;
+    }
+
+    virtual HIDDevice* Open(const String& path)
+    {
+        HIDDeviceDesc desc;
+
+        for (unsigned i = 0; pManager->getSensorDesc(i, &desc); i++)
+        {
+            if (desc.Path == path)
+                return new ReplayHIDDevice(pManager, true);
+        }
+        return 0;
+    }
+
+private:
+    ReplayDeviceManager* pManager;
+};
+
+
+//-------------------------------------------------------------------------------------
+// ***** ReplayDeviceManager
+
+ReplayDeviceManager::ReplayDeviceManager(const SensorReplay& capture, unsigned numSensors,
+                                         bool sensorCoordinates)
+    : Capture(capture), NumSensors(numSensors), SensorCoordinates(sensorCoordinates),
+      PlaySpeedup(0.0f), PlayPasses(0), PlayPass(0), PlayIndex(0), PlayDue(0.0),
+      PlayStartTicks(0)
+{
+    Playing          = 0;
+    NumReportsPlayed = 0;
+}
+
+ReplayDeviceManager::~ReplayDeviceManager()
+{
+    // The factory is a member, gone before ~DeviceManagerImpl would take it out.
+    SensorFactory.RemovedFromManager();
+    SensorFactory.RemoveNode();
+}
+
+ReplayDeviceManager* ReplayDeviceManager::Create(const SensorReplay& capture, unsigned numSensors,
+                                                 bool sensorCoordinates)
+{
+    if (!System::IsInitialized() || (numSensors == 0))
+        return 0;
+
+    Ptr<ReplayDeviceManager> manager = *new ReplayDeviceManager(capture, numSensors,
+                                                                sensorCoordinates);
+    if (!manager->Initialize(0))
+        return 0;
+
+    manager->AddFactory(&manager->SensorFactory);
+    manager->AddRef();
+    return manager.GetPtr();
+}
+
+bool ReplayDeviceManager::Initialize(DeviceBase*)
+{
+    if (!DeviceManagerImpl::Initialize(0))
+        return false;
+
+    pThread = *new ReplayDeviceManagerThread(this);
+    if (!pThread || !pThread->Start())
+        return false;
+
+    HidDeviceManager = *new ReplayHIDDeviceManager(this);
+
+    pCreateDesc->pDevice = this;
+    LogText("OVR::Util::ReplayDeviceManager - initialized.\n");
+    return true;
+}
+
+void ReplayDeviceManager::Shutdown()
+{
+    LogText("OVR::Util::ReplayDeviceManager - shutting down.\n");
+
+    // As the platform managers do: after this, DeviceHandles can't reach the manager, and
+    // the thread runs what is queued, then exits and releases itself.
+    pCreateDesc->pLock->pManager = 0;
+
+    pThread->pManager = 0;
+    pThread->PushExitCommand(false);
+    pThread.Clear();
+
+    DeviceManagerImpl::Shutdown();
+}
+
+ThreadCommandQueue* ReplayDeviceManager::GetThreadQueue()
+{
+    return pThread;
+}
+
+Thread* ReplayDeviceManager::GetThread()
+{
+    return pThread;
+}
+
+DeviceEnumerator<> ReplayDeviceManager::EnumerateDevicesEx(const DeviceEnumerationArgs& args)
+{
+    pThread->PushCall((DeviceManagerImpl*)this,
+                      &DeviceManagerImpl::EnumerateAllFactoryDevices, true);
+
+    return DeviceManagerImpl::EnumerateDevicesEx(args);
+}
+
+bool ReplayDeviceManager::GetDeviceInfo(DeviceInfo* info) const
+{
+    if ((info->InfoClassType != Device_Manager) &&
+        (info->InfoClassType != Device_None))
+        return false;
+
+    info->Type    = Device_Manager;
+    info->Version = 0;
+    OVR_strcpy(info->ProductName, DeviceInfo::MaxNameLength, "ReplayDeviceManager");
+    OVR_strcpy(info->Manufacturer,DeviceInfo::MaxNameLength, "Oculus VR, Inc.");
+    return true;
+}
+
+bool ReplayDeviceManager::Play(float speedup, unsigned passes)
+{
+    bool result = false;
+    if (!pThread->PushCallAndWaitResult(this, &ReplayDeviceManager::play, &result,
+                                        speedup, passes))
+        return false;
+    return result;
+}
+
+void ReplayDeviceManager::Stop()
+{
+    pThread->PushCall(this, &ReplayDeviceManager::stop, true);
+}
+
+bool ReplayDeviceManager::play(float speedup, unsigned passes)
+{
+    if ((Capture.GetNumSamples() == 0) || (passes == 0) || (speedup < 0.0f))
+        return false;
+
+    PlaySpeedup    = speedup;
+    PlayPasses     = passes;
+    PlayPass       = 0;
+    PlayIndex      = 0;
+    PlayStartTicks = Timer::GetTicks();
+    PlayDue        = Timer::TicksToSeconds(PlayStartTicks);
+    NumReportsPlayed.Store_Release(0);
+    Playing.Store_Release(1);
+    return true;
+}
+
+Void ReplayDeviceManager::stop()
+{
+    Playing.Store_Release(0);
+    return 0;
+}
+
+void ReplayDeviceManager::playSample()
+{
+    const SensorCaptureSample& sample = Capture.GetSample(PlayIndex);
+
+    for (UPInt i = 0; i < OpenDevices.GetSize(); i++)
+        OpenDevices[i]->SendSample(sample);
+
+    NumReportsPlayed.Store_Release(NumReportsPlayed.Load_Acquire() + 1);
+    if (PlaySpeedup > 0.0f)
+        PlayDue += sample.TimeDelta / PlaySpeedup;
+
+    if (++PlayIndex == Capture.GetNumSamples())
+    {
+        PlayIndex = 0;
+        if (++PlayPass == PlayPasses)
+            Playing.Store_Release(0);
+    }
+}
+
+unsigned ReplayDeviceManager::service()
+{
+    UInt64 ticks   = Timer::GetTicks();
+    UInt64 waitMks = Timer::MksPerSecond;
+
+    for (UPInt i = 0; i < OpenDevices.GetSize(); i++)
+        waitMks = Alg::Min(waitMks, OpenDevices[i]->OnTicks(ticks));
+
+    for (int i = 0; IsPlaying(); i++)
+    {
+        if (i == MaxSamplesPerService)
+            return 0;
+
+        if (PlaySpeedup > 0.0f)
+        {
+            double ahead = PlayDue - Timer::TicksToSeconds(Timer::GetTicks());
+            if (ahead > 0.0)
+            {
+                waitMks = Alg::Min(waitMks, (UInt64)(ahead * Timer::MksPerSecond));
+                break;
+            }
+        }
+
+        playSample();
+    }
+
+    // Rounded up; a report goes out up to a millisecond late, as from a busy host.
+    return (unsigned)((waitMks + Timer::MksPerMs - 1) / Timer::MksPerMs);
+}
+
+bool ReplayDeviceManager::getSensorDesc(unsigned index, HIDDeviceDesc* desc) const
+{
+    if (index >= NumSensors)
+        return false;
+
+    char path[32], serial[32];
+    OVR_sprintf(path, sizeof(path), "replay:sensor%u", index);
+    OVR_sprintf(serial, sizeof(serial), "REPLAY%04u", index);
+
+    desc->VendorId      = Replay_VendorId;
+    desc->ProductId     = Replay_ProductId;
+    desc->VersionNumber = 0;
+    desc->Usage         = 0;
+    desc->UsagePage     = 0;
+    desc->Path          = path;
+    desc->Manufacturer  = "Oculus VR, Inc.";
+    desc->Product       = "Tracker DK (replay)";
+    desc->SerialNumber  = serial;
+    return true;
+}
+
+void ReplayDeviceManager::addDevice(ReplayHIDDevice* device)
+{
+    OpenDevices.PushBack(device);
+}
+
+void ReplayDeviceManager::removeDevice(ReplayHIDDevice* device)
+{
+    for (UPInt i = 0; i < OpenDevices.GetSize(); i++)
+    {
+        if (OpenDevices[i] == device)
+        {
+            OpenDevices.RemoveAt(i);
+            return;
+        }
+    }
+}
+
+
+//-------------------------------------------------------------------------------------
+// ***** ReplayDeviceManagerThread
+
+ReplayDeviceManagerThread::ReplayDeviceManagerThread(ReplayDeviceManager* manager)
+    : Thread(ThreadStackSize), pManager(manager)
+{
+}
+
+int ReplayDeviceManagerThread::Run()
+{
+    ThreadCommand::PopBuffer command;
+
+    SetThreadName("OVR::ReplayDeviceManagerThread");
+
+    while (!IsExiting())
+    {
+        // PopCommand resets the event on an empty queue.
+        if (PopCommand(&command))
+        {
+            command.Execute();
+            continue;
+        }
+
+        unsigned waitMs = pManager ? pManager->service() : OVR_WAIT_INFINITE;
+        if (waitMs)
+            CommandEvent.Wait(waitMs);
+    }
+
+    return 0;
+}
+
+
+}} // namespace OVR::Util
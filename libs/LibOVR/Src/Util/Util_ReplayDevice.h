@@ -0,0 +1,145 @@
+/************************************************************************************
+
+Filename    :   Util_ReplayDevice.h
+Content     :   A DeviceManager whose sensors play back a capture through the same
+                HID report path as the headset's sensor.
+Created     :   October 19, 2026
+
+Copyright   :   Copyright 2013 Oculus VR, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Oculus license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+*************************************************************************************/
+
+#ifndef OVR_Util_ReplayDevice_h
+#define OVR_Util_ReplayDevice_h
+
+#include "../OVR_DeviceImpl.h"
+#include "../OVR_SensorImpl.h"
+#include "../Kernel/OVR_Threads.h"
+#include "../Kernel/OVR_Atomic.h"
+
+#include "Util_SensorCapture.h"
+
+namespace OVR { namespace Util {
+
+class ReplayHIDDevice;
+class ReplayDeviceManagerThread;
+
+
+//-------------------------------------------------------------------------------------
+// ***** ReplayDeviceManager
+
+// ReplayDeviceManager stands in for the platform DeviceManager, with numSensors Oculus
+// sensors attached that all play the same capture. Each sample is encoded into the tracker
+// report the sensor would send and handed to the SensorDevice as read from the HID device,
+// on the manager thread, so that decoding, dispatch threads, handlers and statistics run
+// as they do with the headset. Values are rounded to the report's 10^-4 units, and a
+// sample whose TimeDelta spans n milliseconds goes out as a report of n samples. With
+// sensorCoordinates false, the sensors act as old firmware that only reports in HMD
+// coordinates, which SensorDevice then converts.
+//
+// Sensors are enumerated and created as from any DeviceManager; Play starts the capture.
+
+class ReplayDeviceManager : public DeviceManagerImpl
+{
+    friend class ReplayHIDDevice;
+    friend class ReplayHIDDeviceManager;
+    friend class ReplayDeviceManagerThread;
+public:
+    // The capture has to outlive the manager.
+    static ReplayDeviceManager* Create(const SensorReplay& capture, unsigned numSensors,
+                                       bool sensorCoordinates = true);
+
+    ReplayDeviceManager(const SensorReplay& capture, unsigned numSensors, bool sensorCoordinates);
+    ~ReplayDeviceManager();
+
+    virtual bool Initialize(DeviceBase* parent);
+    virtual void Shutdown();
+
+    virtual ThreadCommandQueue* GetThreadQueue();
+    virtual Thread*             GetThread();
+
+    virtual DeviceEnumerator<> EnumerateDevicesEx(const DeviceEnumerationArgs& args);
+
+    virtual bool GetDeviceInfo(DeviceInfo* info) const;
+
+    // Plays the capture passes times over to every sensor created by then, at speedup
+    // times the recorded rate, or as fast as the manager thread can for speedup 0.
+    // Returns once playback has started.
+    bool        Play(float speedup, unsigned passes = 1);
+    void        Stop();
+    bool        IsPlaying() const               { return Playing.Load_Acquire() != 0; }
+
+    // Reports handed to each sensor since Play, and when Play started them.
+    UInt32      GetNumReportsPlayed() const     { return NumReportsPlayed.Load_Acquire(); }
+    UInt64      GetPlayStartTicks() const       { return PlayStartTicks; }
+
+private:
+    // Called on the manager thread.
+    bool        play(float speedup, unsigned passes);
+    Void        stop();
+    void        playSample();
+    // Plays what is due and runs the sensors' keep-alive; returns how many milliseconds
+    // the thread can wait before the next call.
+    unsigned    service();
+
+    bool        getSensorDesc(unsigned index, HIDDeviceDesc* desc) const;
+    void        addDevice(ReplayHIDDevice* device);
+    void        removeDevice(ReplayHIDDevice* device);
+
+    enum
+    {
+        // Samples played in one go when behind, so that commands still get through.
+        MaxSamplesPerService = 16
+    };
+
+    const SensorReplay&             Capture;
+    unsigned                        NumSensors;
+    bool                            SensorCoordinates;
+    SensorDeviceFactory             SensorFactory;
+    Ptr<ReplayDeviceManagerThread>  pThread;
+
+    // Only touched on the manager thread, apart from the atomics.
+    ArrayPOD<ReplayHIDDevice*>      OpenDevices;
+    float                           PlaySpeedup;
+    unsigned                        PlayPasses;
+    unsigned                        PlayPass;
+    UInt32                          PlayIndex;
+    double                          PlayDue;
+    UInt64                          PlayStartTicks;
+    AtomicInt<UInt32>               Playing;
+    AtomicInt<UInt32>               NumReportsPlayed;
+};
+
+
+//-------------------------------------------------------------------------------------
+// ***** ReplayDeviceManagerThread
+
+// Runs commands for the devices and plays the reports; there is no platform HID layer to
+// wait on, only the command queue and the time of the next report.
+
+class ReplayDeviceManagerThread : public Thread, public ThreadCommandQueue
+{
+    friend class ReplayDeviceManager;
+    enum { ThreadStackSize = 32 * 1024 };
+public:
+    ReplayDeviceManagerThread(ReplayDeviceManager* manager);
+
+    virtual int Run();
+
+    virtual void OnPushNonEmpty_Locked() { CommandEvent.SetEvent(); }
+    virtual void OnPopEmpty_Locked()     { CommandEvent.ResetEvent(); }
+
+private:
+    // Cleared by the manager's Shutdown, which runs on this thread.
+    ReplayDeviceManager* pManager;
+    Event                CommandEvent;
+};
+
+
+}} // namespace OVR::Util
+
+#endif // OVR_Util_ReplayDevice_h
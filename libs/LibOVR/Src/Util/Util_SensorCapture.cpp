@@ -0,0 +1,531 @@
+/************************************************************************************
+
+Filename    :   Util_SensorCapture.cpp
+Content     :   Recording of sensor samples to a file and playing them back
+                through SensorFusion, for working without the headset.
+Created     :   October 19, 2026
+
+Copyright   :   Copyright 2013 Oculus VR, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Oculus license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+*************************************************************************************/
+
+#include "Util_SensorCapture.h"
+#include "Util_ReplayDevice.h"
+
+#include "../Kernel/OVR_Log.h"
+#include "../Kernel/OVR_Timer.h"
+#include "../Kernel/OVR_Threads.h"
+
+namespace OVR { namespace Util {
+
+//-------------------------------------------------------------------------------------
+// ***** SensorCapture
+
+SensorCapture::SensorCapture()
+  : Handler(getThis()), NumSamples(0)
+{
+}
+
+SensorCapture::~SensorCapture()
+{
+    Stop();
+}
+
+bool SensorCapture::Start(SensorDevice* sensor, const char* path)
+{
+    Stop();
+
+    if (!sensor)
+        return false;
+
+    if (!CaptureFile.Open(path, File::Open_Write | File::Open_Create | File::Open_Truncate | File::Open_Buffered))
+    {
+        LogError("SensorCapture - can't open '%s' for writing", path);
+        return false;
+    }
+
+    SensorCaptureHeader header;
+    header.Magic      = SensorCapture_Magic;
+    header.Version    = SensorCapture_Version;
+    header.SampleSize = sizeof(SensorCaptureSample);
+    CaptureFile.Write((const UByte*)&header, sizeof(header));
+
+    NumSamples = 0;
+    if (sensor->GetMessageHandler())
+        sensor->AddMessageHandler(&Handler);
+    else
+        sensor->SetMessageHandler(&Handler);
+    return true;
+}
+
+void SensorCapture::Stop()
+{
+    // Once the handler is off the device no more samples come in on its thread.
+    Handler.RemoveHandlerFromDevices();
+    CaptureFile.Close();
+}
+
+void SensorCapture::writeSample(const MessageBodyFrame& msg)
+{
+    SensorCaptureSample sample;
+    sample.Acceleration[0]  = msg.Acceleration.x;
+    sample.Acceleration[1]  = msg.Acceleration.y;
+    sample.Acceleration[2]  = msg.Acceleration.z;
+    sample.RotationRate[0]  = msg.RotationRate.x;
+    sample.RotationRate[1]  = msg.RotationRate.y;
+    sample.RotationRate[2]  = msg.RotationRate.z;
+    sample.MagneticField[0] = msg.MagneticField.x;
+    sample.MagneticField[1] = msg.MagneticField.y;
+    sample.MagneticField[2] = msg.MagneticField.z;
+    sample.Temperature      = msg.Temperature;
+    sample.TimeDelta        = msg.TimeDelta;
+
+    if (CaptureFile.Write((const UByte*)&sample, sizeof(sample)) == sizeof(sample))
+        NumSamples++;
+}
+
+SensorCapture::BodyFrameHandler::~BodyFrameHandler()
+{
+    RemoveHandlerFromDevices();
+}
+
+void SensorCapture::BodyFrameHandler::OnMessage(const Message& msg)
+{
+    if (msg.Type == Message_BodyFrame)
+        pCapture->writeSample(static_cast<const MessageBodyFrame&>(msg));
+}
+
+bool SensorCapture::BodyFrameHandler::SupportsMessageType(MessageType type) const
+{
+    return (type == Message_BodyFrame);
+}
+
+
+//-------------------------------------------------------------------------------------
+// ***** SensorReplay
+
+SensorReplay::SensorReplay()
+  : StopRequested(0)
+{
+}
+
+bool SensorReplay::Open(const char* path)
+{
+    Samples.Clear();
+
+    SysFile file;
+    if (!file.Open(path, File::Open_Read | File::Open_Buffered))
+    {
+        LogError("SensorReplay - can't open '%s'", path);
+        return false;
+    }
+
+    SensorCaptureHeader header;
+    if (file.Read((UByte*)&header, sizeof(header)) != sizeof(header) ||
+        header.Magic != SensorCapture_Magic || header.Version != SensorCapture_Version ||
+        header.SampleSize != sizeof(SensorCaptureSample))
+    {
+        LogError("SensorReplay - '%s' is not a sensor capture", path);
+        return false;
+    }
+
+    SensorCaptureSample sample;
+    while (file.Read((UByte*)&sample, sizeof(sample)) == sizeof(sample))
+        Samples.PushBack(sample);
+
+    return true;
+}
+
+UInt32 SensorReplay::Play(SensorFusion* fusion, MessageHandler* listener, bool realTime, bool loop)
+{
+    if (!fusion || Samples.GetSize() == 0)
+        return 0;
+
+    StopRequested = 0;
+
+    MessageBodyFrame msg(0);
+    UInt32           numPlayed = 0;
+    double           due       = Timer::TicksToSeconds(Timer::GetTicks());
+
+    do
+    {
+        for (UPInt i = 0; i < Samples.GetSize() && !StopRequested; i++)
+        {
+            ToMessage(Samples[i], &msg);
+
+            // Sleep off what is ahead of the clock; when behind, catch up without sleeping.
+            if (realTime)
+            {
+                due += msg.TimeDelta;
+                double ahead = due - Timer::TicksToSeconds(Timer::GetTicks());
+                if (ahead > 0.001)
+                    Thread::MSleep((unsigned)(ahead * 1000.0));
+            }
+
+            fusion->OnMessage(msg);
+            if (listener)
+                listener->OnMessage(msg);
+            numPlayed++;
+        }
+    } while (loop && !StopRequested);
+
+    return numPlayed;
+}
+
+bool SensorReplay::CompareIntegrators(IntegratorReport* reports, unsigned passes) const
+{
+    if (Samples.GetSize() == 0 || passes == 0)
+        return false;
+
+    const int        referenceSteps = 16;
+    UPInt            numSamples     = Samples.GetSize();
+    MessageBodyFrame msg(0);
+
+    // For timing the step alone, the samples converted up front.
+    Array<Vector3f>  angVels;
+    ArrayPOD<float>  deltas;
+    angVels.Resize(numSamples);
+    deltas.Resize(numSamples);
+    for (UPInt s = 0; s < numSamples; s++)
+    {
+        ToMessage(Samples[s], &msg);
+        angVels[s] = msg.RotationRate;
+        deltas[s]  = msg.TimeDelta;
+    }
+
+    for (int i = 0; i < SensorFusion::Integrator_Count; i++)
+    {
+        SensorFusion::GyroIntegrator integrator = (SensorFusion::GyroIntegrator)i;
+        IntegratorReport&            report     = reports[i];
+
+        // Drift against the reference, side by side.
+        Quatf    q;
+        Quatd    reference;
+        Vector3f lastAngVel;
+        report.MaxDrift = 0;
+
+        for (UPInt s = 0; s < numSamples; s++)
+        {
+            ToMessage(Samples[s], &msg);
+            if (s == 0)
+                lastAngVel = msg.RotationRate;
+
+            q = SensorFusion::IntegrateGyro(integrator, q, msg.RotationRate, lastAngVel, msg.TimeDelta);
+
+            for (int step = 0; step < referenceSteps; step++)
+            {
+                double   t      = (step + 0.5) / referenceSteps;
+                Vector3d angVel = Vector3d(lastAngVel.x, lastAngVel.y, lastAngVel.z) * (1.0 - t) +
+                                  Vector3d(msg.RotationRate.x, msg.RotationRate.y, msg.RotationRate.z) * t;
+                double   length = angVel.Length();
+                if (length > 0.0)
+                {
+                    double   halfAngle = length * msg.TimeDelta / referenceSteps * 0.5;
+                    Vector3d v         = angVel * (sin(halfAngle) / length);
+                    reference = reference * Quatd(v.x, v.y, v.z, cos(halfAngle));
+                }
+            }
+            reference.Normalize();
+            lastAngVel = msg.RotationRate;
+
+            // Angle of the rotation between the two.
+            Quatd  qd(q.x, q.y, q.z, q.w);
+            double dot   = fabs(qd.x * reference.x + qd.y * reference.y + qd.z * reference.z + qd.w * reference.w) /
+                           qd.Length();
+            float  drift = (float)(2.0 * acos(Alg::Min(dot, 1.0)));
+
+            if (drift > report.MaxDrift)
+                report.MaxDrift = drift;
+            report.FinalDrift = drift;
+        }
+
+        UInt64 start = Timer::GetTicks();
+        for (unsigned pass = 0; pass < passes; pass++)
+        {
+            q = Quatf();
+            for (UPInt s = 0; s < numSamples; s++)
+                q = SensorFusion::IntegrateGyro(integrator, q, angVels[s], angVels[s ? s - 1 : 0], deltas[s]);
+        }
+        UInt64 elapsed = Timer::GetTicks() - start;
+
+        report.NsPerSample = Timer::TicksToSeconds(elapsed) * 1e9 / ((double)numSamples * passes);
+    }
+
+    return true;
+}
+
+bool SensorReplay::CompareTiltEstimators(TiltReport* reports, unsigned passes) const
+{
+    if (Samples.GetSize() == 0 || passes == 0)
+        return false;
+
+    // Still enough for the accelerometer to read gravity alone, well inside the fusion's
+    // own thresholds.
+    const float stillGravityEpsilon = 0.2f;
+    const float stillAngVelEpsilon  = 0.05f;
+
+    UPInt            numSamples = Samples.GetSize();
+    MessageBodyFrame msg(0);
+
+    for (int e = 0; e < SensorFusion::Estimator_Count; e++)
+    {
+        SensorFusion::CorrectionEstimator estimator = (SensorFusion::CorrectionEstimator)e;
+        TiltReport& report = reports[e];
+
+        // Cost, without the getters in the way.
+        UInt64 start = Timer::GetTicks();
+        for (unsigned pass = 0; pass < passes; pass++)
+        {
+            SensorFusion fusion;
+            fusion.SetCorrectionEstimator(estimator);
+            for (UPInt s = 0; s < numSamples; s++)
+            {
+                ToMessage(Samples[s], &msg);
+                fusion.OnMessage(msg);
+            }
+        }
+        report.NsPerSample = Timer::TicksToSeconds(Timer::GetTicks() - start) * 1e9 /
+                             ((double)numSamples * passes);
+
+        SensorFusion fusion;
+        double       errorSum  = 0;
+        UPInt        numStill  = 0;
+        fusion.SetCorrectionEstimator(estimator);
+        report.ErrorMax   = 0;
+        report.FinalError = 0;
+
+        for (UPInt s = 0; s < numSamples; s++)
+        {
+            ToMessage(Samples[s], &msg);
+            fusion.OnMessage(msg);
+
+            float accelLength = msg.Acceleration.Length();
+            if ((fabs(accelLength - 9.81f) < stillGravityEpsilon) &&
+                (msg.RotationRate.Length() < stillAngVelEpsilon))
+            {
+                Vector3f up    = fusion.GetOrientation().Rotate(msg.Acceleration) / accelLength;
+                float    error = acos(Alg::Clamp(up.y, -1.0f, 1.0f));
+                errorSum         += error;
+                report.ErrorMax   = Alg::Max(report.ErrorMax, error);
+                report.FinalError = error;
+                numStill++;
+            }
+        }
+        report.ErrorMean = numStill ? (float)(errorSum / numStill) : 0.0f;
+    }
+
+    return true;
+}
+
+// Angle of the rotation from a to b. Taken from the vector part of the difference: the
+// acos of a dot product that close to 1 can't tell apart angles under a milliradian.
+static float angleBetween(const Quatf& a, const Quatf& b)
+{
+    Quatf d = a.Inverted() * b;
+    return 2.0f * atan2(sqrt(d.x * d.x + d.y * d.y + d.z * d.z), fabs(d.w));
+}
+
+bool SensorReplay::ComparePredictors(SensorPredictor** predictors, unsigned numPredictors,
+                                     const float* horizons, unsigned numHorizons,
+                                     PredictorReport* reports) const
+{
+    if (Samples.GetSize() == 0 || numHorizons > PredictorReport_MaxHorizons)
+        return false;
+
+    UPInt            numSamples = Samples.GetSize();
+    MessageBodyFrame msg(0);
+
+    // What actually happened.
+    SensorFusion     fusion;
+    Array<Quatf>     orientations;
+    ArrayPOD<double> times;
+    double           time = 0;
+    orientations.Resize(numSamples);
+    times.Resize(numSamples);
+    for (UPInt s = 0; s < numSamples; s++)
+    {
+        ToMessage(Samples[s], &msg);
+        fusion.OnMessage(msg);
+        time           += msg.TimeDelta;
+        orientations[s] = fusion.GetOrientation();
+        times[s]        = time;
+    }
+
+    for (unsigned p = 0; p < numPredictors; p++)
+    {
+        SensorPredictor* predictor = predictors[p];
+        PredictorReport& report    = reports[p];
+        SensorFilter     history(20);
+        PredictorInput   input;
+        Quatf            predicted;
+
+        input.AngVelHistory = &history;
+
+        // Cost first, on its own.
+        predictor->Reset();
+        UInt64 start = Timer::GetTicks();
+        for (UPInt s = 0; s < numSamples; s++)
+        {
+            ToMessage(Samples[s], &msg);
+            history.AddElement(msg.RotationRate);
+            input.Orientation = orientations[s];
+            input.AngVel      = msg.RotationRate;
+            input.DeltaT      = msg.TimeDelta;
+            predictor->Update(input);
+            predicted = predictor->Predict(orientations[s], numHorizons ? horizons[0] : 0.0f);
+        }
+        report.NsPerSample = Timer::TicksToSeconds(Timer::GetTicks() - start) * 1e9 / (double)numSamples;
+
+        // Then the errors; future[h] is the first sample at or past the horizon.
+        Array<float> errors[PredictorReport_MaxHorizons];
+        UPInt        future[PredictorReport_MaxHorizons] = { 0 };
+
+        predictor->Reset();
+        history = SensorFilter(20);
+        for (UPInt s = 0; s < numSamples; s++)
+        {
+            ToMessage(Samples[s], &msg);
+            history.AddElement(msg.RotationRate);
+            input.Orientation = orientations[s];
+            input.AngVel      = msg.RotationRate;
+            input.DeltaT      = msg.TimeDelta;
+            predictor->Update(input);
+
+            for (unsigned h = 0; h < numHorizons; h++)
+            {
+                while (future[h] < numSamples && times[future[h]] < times[s] + horizons[h])
+                    future[h]++;
+                if (future[h] == numSamples)
+                    continue;
+
+                predicted = predictor->Predict(orientations[s], horizons[h]);
+                errors[h].PushBack(angleBetween(predicted, orientations[future[h]]));
+            }
+        }
+
+        for (unsigned h = 0; h < numHorizons; h++)
+        {
+            Array<float>& e    = errors[h];
+            UPInt         last = e.GetSize() ? e.GetSize() - 1 : 0;
+            Alg::QuickSort(e);
+
+            report.Median[h] = e.GetSize() ? e[last / 2] : 0.0f;
+            report.P95[h]    = e.GetSize() ? e[(UPInt)(last * 0.95)] : 0.0f;
+            report.P99[h]    = e.GetSize() ? e[(UPInt)(last * 0.99)] : 0.0f;
+            report.Max[h]    = e.GetSize() ? e[last] : 0.0f;
+        }
+    }
+
+    return true;
+}
+
+bool SensorReplay::LoadTest(unsigned numDevices, float speedup, ReplayLoadReport* reports,
+                            unsigned passes) const
+{
+    if (Samples.GetSize() == 0 || numDevices == 0 || speedup <= 0.0f || passes == 0)
+        return false;
+
+    Ptr<ReplayDeviceManager> manager = *ReplayDeviceManager::Create(*this, numDevices);
+    if (!manager)
+        return false;
+
+    // The manager thread reads for all sensors; each one's dispatch and fusion threads go
+    // on the CPUs after the first, in turn.
+    int                             numCPUs = Thread::GetCPUCount();
+    bool                            started = true;
+    Array<Ptr<SensorDevice> >       sensors;
+    Array<SensorFusion*>            fusions;
+    DeviceEnumerator<SensorDevice>  devices = manager->EnumerateDevices<SensorDevice>();
+
+    for (unsigned d = 0; d < numDevices && started; d++, devices.Next())
+    {
+        Ptr<SensorDevice> sensor = *devices.CreateDevice();
+        started = sensor && sensor->SetDispatchThreadEnabled(true, (int)((2 * d + 1) % numCPUs));
+        if (!started)
+        {
+            OVR_DEBUG_LOG(("SensorReplay::LoadTest - can't open replayed sensor %u", d));
+            break;
+        }
+
+        SensorFusion* fusion = new SensorFusion(sensor);
+        sensors.PushBack(sensor);
+        fusions.PushBack(fusion);
+        started = fusion->SetFusionThreadEnabled(true, (int)((2 * d + 2) % numCPUs));
+    }
+
+    if (started)
+        started = manager->Play(speedup, passes);
+
+    // A device is done once everything has been played and its dispatch and fusion threads
+    // have taken the last of it.
+    ArrayPOD<UInt64> endTicks;
+    UPInt            numDone = 0;
+    endTicks.Resize(fusions.GetSize());
+    for (UPInt d = 0; d < endTicks.GetSize(); d++)
+        endTicks[d] = 0;
+
+    while (started && numDone < fusions.GetSize())
+    {
+        Thread::MSleep(1);
+        if (manager->IsPlaying())
+            continue;
+
+        UInt32 numPlayed = manager->GetNumReportsPlayed();
+        for (UPInt d = 0; d < fusions.GetSize(); d++)
+        {
+            SensorStatistics  sensorStats;
+            sensors[d]->GetStatistics(&sensorStats);
+            FusionThreadStats fusionStats = fusions[d]->GetFusionThreadStats();
+
+            if (endTicks[d] == 0 &&
+                sensorStats.PacketsReceived + sensorStats.ReportsDropped >= numPlayed &&
+                fusionStats.NumSamples + fusionStats.NumDropped >= sensorStats.SamplesDelivered)
+            {
+                endTicks[d] = Timer::GetTicks();
+                numDone++;
+            }
+        }
+    }
+
+    for (UPInt d = 0; d < fusions.GetSize() && started; d++)
+    {
+        SensorStatistics  sensorStats;
+        sensors[d]->GetStatistics(&sensorStats);
+        FusionThreadStats fusionStats = fusions[d]->GetFusionThreadStats();
+        ReplayLoadReport& report      = reports[d];
+        double            seconds     = Timer::TicksToSeconds(endTicks[d] - manager->GetPlayStartTicks());
+
+        report.NumSamples        = sensorStats.SamplesDelivered;
+        report.NumDropped        = fusionStats.NumDropped;
+        report.NumReportsDropped = sensorStats.ReportsDropped;
+        report.SamplesPerSecond  = (seconds > 0.0) ? fusionStats.NumSamples / seconds : 0.0;
+        report.LatencyMean       = fusionStats.LatencyMean;
+        report.LatencyMax        = fusionStats.LatencyMax;
+    }
+
+    // Sensors are closed on the manager thread once released, after the fusions let go.
+    manager->Stop();
+    for (UPInt d = 0; d < fusions.GetSize(); d++)
+    {
+        fusions[d]->SetFusionThreadEnabled(false);
+        delete fusions[d];
+    }
+
+    return started;
+}
+
+void SensorReplay::ToMessage(const SensorCaptureSample& sample, MessageBodyFrame* msg)
+{
+    msg->Acceleration  = Vector3f(sample.Acceleration[0],  sample.Acceleration[1],  sample.Acceleration[2]);
+    msg->RotationRate  = Vector3f(sample.RotationRate[0],  sample.RotationRate[1],  sample.RotationRate[2]);
+    msg->MagneticField = Vector3f(sample.MagneticField[0], sample.MagneticField[1], sample.MagneticField[2]);
+    msg->Temperature   = sample.Temperature;
+    msg->TimeDelta     = sample.TimeDelta;
+}
+
+
+}} // namespace OVR::Util
@@ -0,0 +1,212 @@
+/************************************************************************************
+
+PublicHeader:   OVR.h
+Filename    :   Util_SensorCapture.h
+Content     :   Recording of sensor samples to a file and playing them back
+                through SensorFusion, for working without the headset.
+Created     :   October 19, 2026
+
+Copyright   :   Copyright 2013 Oculus VR, Inc. All Rights reserved.
+
+Use of this software is subject to the terms of the Oculus license
+agreement provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+*************************************************************************************/
+
+#ifndef OVR_Util_SensorCapture_h
+#define OVR_Util_SensorCapture_h
+
+#include "../OVR_Device.h"
+#include "../OVR_SensorFusion.h"
+
+#include "../Kernel/OVR_Array.h"
+#include "../Kernel/OVR_SysFile.h"
+
+namespace OVR { namespace Util {
+
+
+//-------------------------------------------------------------------------------------
+// ***** SensorCaptureSample
+
+// One BodyFrame as it is stored in a capture file; the file is a SensorCaptureHeader
+// followed by these, in the byte order of the machine that recorded it.
+struct SensorCaptureSample
+{
+    float   Acceleration[3];
+    float   RotationRate[3];
+    float   MagneticField[3];
+    float   Temperature;
+    float   TimeDelta;
+};
+
+struct SensorCaptureHeader
+{
+    UInt32  Magic;      // SensorCapture_Magic
+    UInt32  Version;
+    UInt32  SampleSize; // sizeof(SensorCaptureSample) when it was written
+};
+
+enum
+{
+    SensorCapture_Magic   = 0x4352564F, // "OVRC"
+    SensorCapture_Version = 1
+};
+
+
+//-------------------------------------------------------------------------------------
+// ***** SensorCapture
+
+// SensorCapture writes every BodyFrame of a sensor to a file. It is added to the sensor
+// next to any other handler, a SensorFusion for instance, and records the raw samples;
+// fusion is redone when the capture is played back. Samples are written from the device
+// thread through a buffered file.
+
+class SensorCapture : public NewOverrideBase
+{
+public:
+    SensorCapture();
+    ~SensorCapture();
+
+    // Starts recording sensor into path, replacing what was there.
+    bool        Start(SensorDevice* sensor, const char* path);
+    void        Stop();
+
+    bool        IsRecording() const { return Handler.IsHandlerInstalled(); }
+    UInt32      GetNumSamples() const { return NumSamples; }
+
+private:
+    SensorCapture* getThis()  { return this; }
+
+    void writeSample(const MessageBodyFrame& msg);
+
+    class BodyFrameHandler : public MessageHandler
+    {
+        SensorCapture* pCapture;
+    public:
+        BodyFrameHandler(SensorCapture* capture) : pCapture(capture) { }
+        ~BodyFrameHandler();
+
+        virtual void OnMessage(const Message& msg);
+        virtual bool SupportsMessageType(MessageType type) const;
+    };
+
+    BodyFrameHandler  Handler;
+    SysFile           CaptureFile;
+    UInt32            NumSamples;
+};
+
+
+//-------------------------------------------------------------------------------------
+// ***** SensorReplay
+
+// What SensorReplay::CompareIntegrators found for one of SensorFusion's integrators.
+struct IntegratorReport
+{
+    double  NsPerSample;    // The integration step alone, averaged over all passes.
+    float   MaxDrift;       // Largest angle in radians between its orientation and the reference.
+    float   FinalDrift;     // The same at the end of the capture.
+};
+
+// What SensorReplay::CompareTiltEstimators found for one of SensorFusion's estimators.
+// Errors are angles in radians between the fused up direction and the accelerometer,
+// over the samples where the headset is close to still.
+struct TiltReport
+{
+    double  NsPerSample;    // The whole fusion step.
+    float   ErrorMean;
+    float   ErrorMax;
+    float   FinalError;     // At the last still sample.
+};
+
+enum
+{
+    PredictorReport_MaxHorizons = 4
+};
+
+// What SensorReplay::ComparePredictors found for one predictor. Errors are angles in
+// radians between the prediction and the orientation once that time had come, one
+// entry per horizon.
+struct PredictorReport
+{
+    float   Median[PredictorReport_MaxHorizons];
+    float   P95[PredictorReport_MaxHorizons];
+    float   P99[PredictorReport_MaxHorizons];
+    float   Max[PredictorReport_MaxHorizons];
+    double  NsPerSample;    // Update and one Predict.
+};
+
+// What SensorReplay::LoadTest found for one of the replayed devices.
+struct ReplayLoadReport
+{
+    UInt32  NumSamples;         // Samples the sensor delivered to its fusion.
+    UInt32  NumDropped;         // Of those, thrown away with the fusion thread's queue full.
+    UInt32  NumReportsDropped;  // Reports thrown away with the sensor's dispatch queue full.
+    double  SamplesPerSecond;   // Integrated, from the start until the fusion had caught up.
+    float   LatencyMean;        // Seconds from queueing a sample to it being integrated.
+    float   LatencyMax;
+};
+
+// SensorReplay plays a capture back into a SensorFusion, in place of the device. In real
+// time it sleeps for each sample's TimeDelta, so that whoever waits on the fusion sees the
+// same pacing as with the headset. A listener, if given, gets each message after the fusion
+// has integrated it, the way SensorFusion's delegate handler does with a real sensor; with
+// the fusion thread enabled, after it was queued for the thread.
+
+class SensorReplay : public NewOverrideBase
+{
+public:
+    SensorReplay();
+
+    // Loads the whole capture.
+    bool        Open(const char* path);
+    UInt32      GetNumSamples() const { return (UInt32)Samples.GetSize(); }
+    const SensorCaptureSample& GetSample(UInt32 i) const { return Samples[i]; }
+
+    // Blocks until the capture is done (looping it if asked) or Stop is called from
+    // another thread. Returns the number of samples played.
+    UInt32      Play(SensorFusion* fusion, MessageHandler* listener = 0,
+                     bool realTime = true, bool loop = false);
+    void        Stop() { StopRequested = 1; }
+
+    static void ToMessage(const SensorCaptureSample& sample, MessageBodyFrame* msg);
+
+    // Integrates the gyro samples of the capture with each of SensorFusion's integrators
+    // and with a double precision reference, which takes 16 exact steps per sample along
+    // the rate interpolated between samples. Gravity and yaw correction are left out, so
+    // the drift is the integrator's own. reports takes SensorFusion::Integrator_Count
+    // entries; timing is taken over the given number of passes through the capture.
+    bool        CompareIntegrators(IntegratorReport* reports, unsigned passes = 20) const;
+
+    // Plays the capture through a SensorFusion with each of its correction estimators and
+    // compares the pitch and roll they leave. reports takes SensorFusion::Estimator_Count
+    // entries; timing is taken over the given number of passes through the capture.
+    bool        CompareTiltEstimators(TiltReport* reports, unsigned passes = 5) const;
+
+    // Plays the capture through a SensorFusion for the orientation over time, and through
+    // each of the predictors the way the fusion drives its own. Each prediction, for up to
+    // PredictorReport_MaxHorizons horizons in seconds, is compared with the fused orientation
+    // when that time came. reports takes numPredictors entries.
+    bool        ComparePredictors(SensorPredictor** predictors, unsigned numPredictors,
+                                  const float* horizons, unsigned numHorizons,
+                                  PredictorReport* reports) const;
+
+    // Plays the capture to numDevices sensors of a ReplayDeviceManager at once, at speedup
+    // times the recorded rate, each sensor with its dispatch thread and a SensorFusion with
+    // its fusion thread, spread over the CPUs. Reports go through the SensorDevice code the
+    // headset uses, from the HID report on. A device keeps up when nothing is dropped and
+    // the latency stays well under the sample period; past what its threads can take,
+    // SamplesPerSecond is how much it integrates. With CPUs to spare, the reports shouldn't
+    // change with numDevices. reports takes numDevices entries.
+    bool        LoadTest(unsigned numDevices, float speedup, ReplayLoadReport* reports,
+                         unsigned passes = 1) const;
+
+private:
+    ArrayPOD<SensorCaptureSample> Samples;
+    volatile int                  StopRequested;
+};
+
+
+}} // namespace OVR::Util
+
+#endif // OVR_Util_SensorCapture_h
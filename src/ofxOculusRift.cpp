@@ -10,101 +10,802 @@
 
 // ---------------------------------------------------------------------------------------------------------------------------------------------------
 //
-ofxOculusRift::ofxOculusRift()
+ofxOculusRiftDevices::ofxOculusRiftDevices()
+{
+	InfoLoaded = false;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftDevices::open()
+{
+	pManager = *DeviceManager::Create();
+	
+	pHMD = *pManager->EnumerateDevices<HMDDevice>().CreateDevice();
+	
+	if (pHMD)
+	{
+		InfoLoaded = pHMD->GetDeviceInfo(&Info);
+		pSensor = *pHMD->GetSensor();
+	}
+	else
+	{
+		pSensor = *pManager->EnumerateDevices<SensorDevice>().CreateDevice();
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftDevices::clear()
+{
+	pSensor.Clear();
+	pHMD.Clear();
+	pManager.Clear();
+	InfoLoaded = false;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+ofxOculusRiftDeviceThread::ofxOculusRiftDeviceThread()
+{
+	done.Store_Release( 0 );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftDeviceThread::threadedFunction()
+{
+	devices.open();
+	
+	done.Store_Release( 1 );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+bool ofxOculusRiftDeviceThread::isDone()
+{
+	return done.Load_Acquire() != 0;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+ofxOculusRiftFramePose::ofxOculusRiftFramePose()
+{
+	sampleTime = 0.0;
+	predictedTime = 0.0;
+	captureTime = 0.0;
+	frameNum = -1;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftFramePose::set( const SensorState& _state, double _captureTime, int _frameNum )
+{
+	orientation		= ofQuaternion( _state.Predicted.x, _state.Predicted.y, _state.Predicted.z, _state.Predicted.w );
+	viewOrientation	= orientation.inverse();
+	orientation.get( orientationMat );
+	viewOrientation.get( viewOrientationMat );
+	
+	acceleration.set( _state.Acceleration.x, _state.Acceleration.y, _state.Acceleration.z );
+	angularVelocity.set( _state.AngularVelocity.x, _state.AngularVelocity.y, _state.AngularVelocity.z );
+	
+	sampleTime		= _state.SampleTime;
+	predictedTime	= _state.SampleTime + _state.PredictionDelta;
+	captureTime		= _captureTime;
+	frameNum		= _frameNum;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+ofxOculusRiftPoseSlot::ofxOculusRiftPoseSlot()
+{
+	back = 0;
+	middle.Store_Release( 1 );
+	front = 2;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftPoseSlot::write( const ofxOculusRiftFramePose& _pose )
 {
+	buffers[back] = _pose;
+	back = middle.Exchange_Sync( back | FreshBit ) & 3;
+}
 
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+bool ofxOculusRiftPoseSlot::read( ofxOculusRiftFramePose& _pose )
+{
+	if( !(middle.Load_Acquire() & FreshBit) )
+	{
+		return false;
+	}
+	
+	front = middle.Exchange_Sync( front ) & 3;
+	_pose = buffers[front];
+	
+	return true;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+ofxOculusRiftUpdateThread::ofxOculusRiftUpdateThread()
+{
+	rift = NULL;
+	frameDelta = 0.0f;
+	busy = false;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftUpdateThread::start( ofxOculusRift* _rift )
+{
+	rift = _rift;
+	busy = false;
+	startEvent.ResetEvent();
+	doneEvent.ResetEvent();
+	
+	startThread( false, false );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftUpdateThread::stop()
+{
+	if( !isThreadRunning() )
+	{
+		return;
+	}
+	
+	waitForFrame();
+	
+	stopThread();
+	startEvent.SetEvent();
+	waitForThread( false );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftUpdateThread::beginFrame( int _frameNum, float _frameDelta )
+{
+	frameNum.Store_Release( _frameNum );
+	frameDelta = _frameDelta;
+	busy = true;
+	
+	doneEvent.ResetEvent();
+	startEvent.SetEvent();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftUpdateThread::waitForFrame()
+{
+	if( !busy )
+	{
+		return;
+	}
+	
+	doneEvent.Wait();
+	busy = false;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftUpdateThread::threadedFunction()
+{
+	while( isThreadRunning() )
+	{
+		startEvent.Wait();
+		startEvent.ResetEvent();
+		
+		if( !isThreadRunning() )
+		{
+			break;
+		}
+		
+		rift->updatePipelinedFrame( frameNum.Load_Acquire(), frameDelta );
+		
+		doneEvent.SetEvent();
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+ofxOculusRiftPredictionStats::ofxOculusRiftPredictionStats()
+{
+	predictionDelta = 0.0f;
+	
+	latencyMean = 0.0f;
+	latencyMin = 0.0f;
+	latencyMax = 0.0f;
+	sampleToPoseMean = 0.0f;
+	poseToDrawMean = 0.0f;
+	numLatencySamples = 0;
+	
+	errorMean = 0.0f;
+	errorMax = 0.0f;
+	numErrorSamples = 0;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+ofxOculusRift::ofxOculusRift()
+{
+	InfoLoaded = false;
+	Info = stereoConfig.GetHMDInfo(); // defaults until the real device is found
+	
+	asyncInitPending = false;
+	needSensorReadingThisFrame = false;
+	
+	worldUnitsPerMeter = 100.0f;
+	interOcularDistance = stereoConfig.GetIPD() * worldUnitsPerMeter;
+	
+	eyeMatricesFrameNum = -1;
+	
+	farFieldDistance = 0.0f;
+	farFieldFrameNum = -1;
+	fboNumSamples = 0;
+	
+	multiResolution = false;
+	multiResBorderResolution = 0.5f;
+	currentRegion = 0;
+	
+	autoPrediction = true;
+	predictionWindowSize = 60;
+	FusionResult.SetPredictionEnabled( autoPrediction );
+	predictionStats.predictionDelta = FusionResult.GetPredictionDelta();
+	
+	swapPending = false;
+	
+	pipelined = false;
+	
+	// the swap has just returned when the update event comes round
+	ofAddListener( ofEvents().update, this, &ofxOculusRift::onUpdate );
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------------------------
 //
 ofxOculusRift::~ofxOculusRift()
 {
+	ofRemoveListener( ofEvents().update, this, &ofxOculusRift::onUpdate );
+	
 	shutdown();
 }
 
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRift::onUpdate( ofEventArgs& _args )
+{
+	// the last frame is on its way to the display, this is when it got there as far as latency goes
+	if( swapPending )
+	{
+		swapPending = false;
+		updatePredictionAfterSwap( Timer::TicksToSeconds( Timer::GetTicks() ) );
+	}
+	
+	frameScheduler.frameStart();
+	
+	if( pipelined )
+	{
+		// this frame was got ready while the last one was drawn, start on the next one. The scheduler is
+		// only ever touched from here, the worker gets the vsync period handed to it.
+		updateThread.waitForFrame();
+		updateThread.poseSlot.read( pipelinePose );
+		updateThread.beginFrame( ofGetFrameNum() + 1, frameScheduler.getVsyncPeriod() );
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRift::setPipelined( bool _pipelined )
+{
+	if( _pipelined == pipelined )
+	{
+		return;
+	}
+	
+	pipelined = _pipelined;
+	
+	if( pipelined )	{ updateThread.start( this ); }
+	else			{ updateThread.stop(); }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+bool ofxOculusRift::getPipelined()
+{
+	return pipelined;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+const ofxOculusRiftFramePose& ofxOculusRift::getPipelinePose()
+{
+	return pipelinePose;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRift::updatePipelinedFrame( int _frameNum, float _frameDelta )
+{
+	// Runs on the update thread. Of the rift it only reads the fusion state, which takes its own lock, the vsync
+	// period comes in from beginFrame as the scheduler is updated on the GL thread meanwhile. The frame goes on
+	// screen about a frame later than the one being drawn now, so turn the pose on by the angular velocity for that long.
+	SensorState state = FusionResult.GetSensorState();
+	
+	float angle = state.AngularVelocity.Length() * _frameDelta;
+	if( angle > 0.0f )
+	{
+		state.Predicted = state.Predicted * Quatf( state.AngularVelocity.Normalized(), angle );
+	}
+	state.PredictionDelta += _frameDelta;
+	
+	ofxOculusRiftUpdateArgs args;
+	args.frameNum = _frameNum;
+	args.pose.set( state, Timer::TicksToSeconds( Timer::GetTicks() ), _frameNum );
+	
+	updateThread.poseSlot.write( args.pose );
+	
+	ofNotifyEvent( pipelineUpdateEvent, args );
+}
+
 // ---------------------------------------------------------------------------------------------------------------------------------------------------
 //
 bool ofxOculusRift::init( int _width, int _height, int _fboNumSamples )
+{
+	initRendering( _width, _height, _fboNumSamples );
+	
+	return initSensor();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRift::initAsync( int _width, int _height, int _fboNumSamples )
+{
+	initRendering( _width, _height, _fboNumSamples );
+	
+	System::Init(); // stays on this thread, the device thread only does the discovery
+	
+	asyncInitPending = true;
+	deviceThread.startThread( false, false );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+bool ofxOculusRift::isInitPending()
+{
+	return asyncInitPending;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+const HMDInfo& ofxOculusRift::getHMDInfo()
+{
+	updateAsyncInit();
+	
+	return Info;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRift::initRendering( int _width, int _height, int _fboNumSamples )
 {
 	initFBO( _width, _height );
 	
-	hmdWarpShader.load("Shaders/HmdWarp");
+	fboNumSamples = _fboNumSamples;
+	
+	hmdWarpShader.load("Shaders/HmdWarp");
+	
+	ofDisableArbTex();
+
+		ofFbo::Settings tmpSettings = ofFbo::Settings();
+		tmpSettings.width			= _width/2;
+		tmpSettings.height			= _height;
+		tmpSettings.internalformat	= GL_RGB;
+		tmpSettings.textureTarget	= GL_TEXTURE_2D;
+		tmpSettings.numSamples		= _fboNumSamples;
+		tmpSettings.useDepth		= true;
+		
+		eyeFboLeft.allocate( tmpSettings );
+		eyeFboRight.allocate( tmpSettings );
+	
+	ofEnableArbTex();
+	
+	stereoConfig.SetFullViewport( Util::Render::Viewport(0, 0, _width, _height) );
+	stereoConfig.SetDistortionFitPointVP( -1.0f, 0.0f );
+	
+	setNearClip( 0.001f );
+	setFarClip( 2048.0f );
+	setFov( stereoConfig.GetYFOVDegrees() );
+
+	setInterOcularDistance( stereoConfig.GetIPD() * worldUnitsPerMeter );
+	setShaderScaleFactor( 1.0f );
+	setDoWarping( true );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRift::beginRenderSceneLeftEye( int _region )
+{
+	if( _region == 0 ) { frameTiming.beginStage( OFX_OCULUSRIFT_STAGE_SCENE_LEFT ); }
+	beginRender( true, _region );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRift::endRenderSceneLeftEye()
+{
+	endRender( getEyeFbo( true ) );
+	if( currentRegion >= getNumEyeRegions() - 1 ) { frameTiming.endStage( OFX_OCULUSRIFT_STAGE_SCENE_LEFT ); }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRift::beginRenderSceneRightEye( int _region )
+{
+	if( _region == 0 ) { frameTiming.beginStage( OFX_OCULUSRIFT_STAGE_SCENE_RIGHT ); }
+	beginRender( false, _region );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRift::endRenderSceneRightEye()
+{
+	endRender( getEyeFbo( false ) );
+	if( currentRegion >= getNumEyeRegions() - 1 ) { frameTiming.endStage( OFX_OCULUSRIFT_STAGE_SCENE_RIGHT ); }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRift::setMultiResolution( bool _multiResolution, float _borderResolution )
+{
+	multiResolution = _multiResolution;
+	multiResBorderResolution = _borderResolution;
+	eyeMatricesFrameNum = -1;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+bool ofxOculusRift::getMultiResolution()
+{
+	return multiResolution;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+int ofxOculusRift::getNumEyeRegions()
+{
+	if( !multiResolution )
+	{
+		return 1;
+	}
+	
+	updateEyeMatricesIfNeededThisFrame();
+	
+	return multiResLayout[0].getNumRegions(); // the right eye is the mirror image
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+const ofxOculusRiftMultiResLayout& ofxOculusRift::getMultiResLayout( bool _isLeftEye )
+{
+	updateEyeMatricesIfNeededThisFrame();
+	
+	return multiResLayout[ _isLeftEye ? 0 : 1 ];
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRift::updateMultiResLayout()
+{
+	const Util::Render::DistortionConfig& distortion = stereoConfig.GetDistortionConfig();
+	
+	// renderDistortedEyeNew works in texture coordinates of the whole screen, where an eye is 0.5 x 1
+	float warpAspect = 0.5f;
+	
+	for( int i = 0; i < 2; i++ )
+	{
+		multiResLayout[i].setup( distortion, distortion.Scale / shaderScaleFactor, warpAspect, i == 0,
+								 eyeFboLeft.getWidth(), eyeFboLeft.getHeight(), multiResBorderResolution );
+	}
+	
+	int packedWidth  = multiResLayout[0].getPackedWidth();
+	int packedHeight = multiResLayout[0].getPackedHeight();
+	
+	if( (int)multiResFbo[0].getWidth() == packedWidth && (int)multiResFbo[0].getHeight() == packedHeight )
+	{
+		return;
+	}
+	
+	ofDisableArbTex();
+	
+		ofFbo::Settings tmpSettings = ofFbo::Settings();
+		tmpSettings.width			= packedWidth;
+		tmpSettings.height			= packedHeight;
+		tmpSettings.internalformat	= GL_RGB;
+		tmpSettings.textureTarget	= GL_TEXTURE_2D;
+		tmpSettings.numSamples		= fboNumSamples;
+		tmpSettings.useDepth		= true;
+	
+		multiResFbo[0].allocate( tmpSettings );
+		multiResFbo[1].allocate( tmpSettings );
+	
+	ofEnableArbTex();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+ofFbo* ofxOculusRift::getEyeFbo( bool _isLeftEye )
+{
+	if( multiResolution )
+	{
+		return &multiResFbo[ _isLeftEye ? 0 : 1 ];
+	}
+	
+	return _isLeftEye ? &eyeFboLeft : &eyeFboRight;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRift::beginRenderSceneFarField()
+{
+	frameTiming.beginStage( OFX_OCULUSRIFT_STAGE_SCENE_FAR_FIELD );
+	
+	allocateFarFieldFboIfNeeded();
+	updateEyeMatricesIfNeededThisFrame();
+	
+	ofPushView();
+	
+		farFieldFbo.begin();
+		ofClear(0,0,0);
+	
+		ofSetMatrixMode(OF_MATRIX_PROJECTION);
+		ofLoadMatrix( farFieldProjectionMatrix );
+	
+		ofSetMatrixMode(OF_MATRIX_MODELVIEW);
+		ofLoadMatrix( farFieldViewMatrix );
+	
+		ofPushMatrix();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRift::endRenderSceneFarField()
+{
+	endRender( &farFieldFbo );
+	farFieldFrameNum = ofGetFrameNum();
+	
+	frameTiming.endStage( OFX_OCULUSRIFT_STAGE_SCENE_FAR_FIELD );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRift::setFarFieldDistance( float _distance )
+{
+	farFieldDistance = MAX( _distance, 0.0f );
+	eyeMatricesFrameNum = -1;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+float ofxOculusRift::getFarFieldDistance()
+{
+	return farFieldDistance;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRift::allocateFarFieldFboIfNeeded()
+{
+	// the projection centre offset changes when the HMD info comes in, so check every time
+	int width = (int)ceilf( eyeFboLeft.getWidth() * (1.0f + fabs( stereoConfig.GetProjectionCenterOffset() )) );
+	if( (int)farFieldFbo.getWidth() == width && farFieldFbo.getHeight() == eyeFboLeft.getHeight() )
+	{
+		return;
+	}
+	
+	ofDisableArbTex();
+	
+		ofFbo::Settings tmpSettings = ofFbo::Settings();
+		tmpSettings.width			= width;
+		tmpSettings.height			= eyeFboLeft.getHeight();
+		tmpSettings.internalformat	= GL_RGB;
+		tmpSettings.textureTarget	= GL_TEXTURE_2D;
+		tmpSettings.numSamples		= fboNumSamples;
+		tmpSettings.useDepth		= true;
+	
+		farFieldFbo.allocate( tmpSettings );
+	
+	ofEnableArbTex();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRift::drawFarField( bool _isLeftEye, const ofRectangle& _ndc )
+{
+	// At that distance the eye shift doesn't matter, the only thing different between the eyes is the lens centre
+	// offset in clip space. The eye sees [-1-offset,1-offset] of the far field's clip space, which was squeezed
+	// by 1+|offset| to fit both eyes in.
+	float projectionCenterOffset = stereoConfig.GetProjectionCenterOffset();
+	float offset	= _isLeftEye ? projectionCenterOffset : -projectionCenterOffset;
+	float widen		= 1.0f + fabs( projectionCenterOffset );
+	
+	float u0 = (_ndc.x				- offset + widen) / (2.0f * widen);
+	float u1 = (_ndc.x + _ndc.width - offset + widen) / (2.0f * widen);
+	float v0 = (_ndc.y				+ 1.0f) * 0.5f;
+	float v1 = (_ndc.y + _ndc.height + 1.0f) * 0.5f;
+	
+	// straight from texture to clip space, so the far field keeps the same flip as the eye we draw it into
+	ofSetMatrixMode(OF_MATRIX_PROJECTION);
+	ofLoadIdentityMatrix();
+	ofSetMatrixMode(OF_MATRIX_MODELVIEW);
+	ofLoadIdentityMatrix();
+	
+	// behind everything, and it mustn't write any depth
+	GLboolean depthTestWasEnabled = glIsEnabled( GL_DEPTH_TEST );
+	glDisable( GL_DEPTH_TEST );
+	
+	ofSetColor( 255 );
+	farFieldFbo.getTextureReference().bind();
+	
+		glBegin(GL_TRIANGLE_STRIP);
+			glTexCoord2f(u0, v0);   glVertex2f(-1.0f, -1.0f);
+			glTexCoord2f(u1, v0);   glVertex2f( 1.0f, -1.0f);
+			glTexCoord2f(u0, v1);   glVertex2f(-1.0f,  1.0f);
+			glTexCoord2f(u1, v1);   glVertex2f( 1.0f,  1.0f);
+		glEnd();
+	
+	farFieldFbo.getTextureReference().unbind();
+	
+	if( depthTestWasEnabled ) { glEnable( GL_DEPTH_TEST ); }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRift::beginRender( bool _isLeftEye, int _region )
+{
+	updateEyeMatricesIfNeededThisFrame();
+	
+	currentRegion = _region;
+	ofFbo* fbo = getEyeFbo( _isLeftEye );
+	
+	ofMatrix4x4 projection = getEyeProjectionMatrix( _isLeftEye );
+	ofRectangle ndc( -1.0f, -1.0f, 2.0f, 2.0f );
+	
+	ofPushView();
+
+		fbo->begin();
+	
+		if( _region == 0 )
+		{
+			ofClear(0,0,0); // Todo: get the proper clear color
+		}
+	
+		if( multiResolution )
+		{
+			const ofxOculusRiftMultiResLayout& layout = multiResLayout[ _isLeftEye ? 0 : 1 ];
+			const ofxOculusRiftMultiResRegion& region = layout.getRegion( _region );
+			
+			glViewport( region.viewport.x, region.viewport.y, region.viewport.w, region.viewport.h );
+			ndc = ofRectangle( region.ndc.x, region.ndc.y, region.ndc.width, region.ndc.height );
+			
+			// stretch the region's part of clip space to fill [-1,1]
+			projection = projection * ofMatrix4x4::newScaleMatrix( 2.0f / ndc.width, 2.0f / ndc.height, 1.0f ) *
+									  ofMatrix4x4::newTranslationMatrix( -(2.0f * ndc.x + ndc.width) / ndc.width, -(2.0f * ndc.y + ndc.height) / ndc.height, 0.0f );
+		}
+	
+		if( farFieldDistance > 0.0f && farFieldFrameNum == ofGetFrameNum() )
+		{
+			drawFarField( _isLeftEye, ndc );
+		}
+	
+		ofSetMatrixMode(OF_MATRIX_PROJECTION);
+		ofLoadMatrix( projection );
+	
+		ofSetMatrixMode(OF_MATRIX_MODELVIEW);
+		ofLoadMatrix( getEyeViewMatrix( _isLeftEye ) );
+	
+		ofPushMatrix();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRift::updateEyeMatricesIfNeededThisFrame()
+{
+	// capture first, a fresh pose resets eyeMatricesFrameNum and must not undo the stamp below
+	capturePoseIfNeededThisFrame();
+	
+	if( eyeMatricesFrameNum == ofGetFrameNum() )
+	{
+		return;
+	}
 	
-	ofDisableArbTex();
-
-		ofFbo::Settings tmpSettings = ofFbo::Settings();
-		tmpSettings.width			= _width/2;
-		tmpSettings.height			= _height;
-		tmpSettings.internalformat	= GL_RGB;
-		tmpSettings.textureTarget	= GL_TEXTURE_2D;
-		tmpSettings.numSamples		= _fboNumSamples;
+	eyeMatricesFrameNum = ofGetFrameNum();
+	
+	// Same as the StereoEyeParams projections, but the SDK builds them with a D3D style [0,1] depth range
+	// and a fixed near/far, so we make our own from the same YFov, aspect and lens centre offset.
+	float projectionCenterOffset = stereoConfig.GetProjectionCenterOffset();
+	
+	// with a far field the eyes stop where it starts, the two planes line up as the eyes only move sideways
+	bool useFarField = farFieldDistance > 0.0f;
+	
+	ofMatrix4x4 projCenter;
+	projCenter.makePerspectiveMatrix( stereoConfig.GetYFOVDegrees(), stereoConfig.GetAspect(), getNearClip(), useFarField ? farFieldDistance : getFarClip() );
+	
+	eyeProjectionMatrix[0] = projCenter * ofMatrix4x4::newTranslationMatrix(  projectionCenterOffset, 0, 0 );
+	eyeProjectionMatrix[1] = projCenter * ofMatrix4x4::newTranslationMatrix( -projectionCenterOffset, 0, 0 );
+	
+	// position, head orientation, eye shift and the flip for the FBO, in that order
+	headViewMatrix = ofMatrix4x4::newTranslationMatrix( getPosition() ) * framePose.viewOrientationMat;
+	
+	for( int i = 0; i < 2; i++ )
+	{
+		const Util::Render::StereoEyeParams& eyeParams = getStereoEyeParams( i == 0 );
+		float viewAdjust = eyeParams.ViewAdjust.M[0][3] * worldUnitsPerMeter;
 		
-		eyeFboLeft.allocate( tmpSettings );
-		eyeFboRight.allocate( tmpSettings );
+		eyeViewAdjustMatrix[i] = ofMatrix4x4::newTranslationMatrix( viewAdjust, 0, 0 );
+		eyeViewMatrix[i] = headViewMatrix * eyeViewAdjustMatrix[i] * ofMatrix4x4::newScaleMatrix( 1, -1, 1 );
+	}
 	
-	ofEnableArbTex();
+	// the far field is seen from between the eyes and squeezed horizontally so it covers both lens centre offsets
+	farFieldProjectionMatrix.makePerspectiveMatrix( stereoConfig.GetYFOVDegrees(), stereoConfig.GetAspect() * (1.0f + fabs( projectionCenterOffset )),
+													useFarField ? farFieldDistance : getNearClip(), getFarClip() );
+	farFieldViewMatrix = headViewMatrix * ofMatrix4x4::newScaleMatrix( 1, -1, 1 );
 	
-	setNearClip( 0.001f );
-	setFarClip( 2048.0f );
-	setFov( 90.0f );
-
-	setInterOcularDistance( -0.6f );
-	setShaderScaleFactor( 1.0f );
-	setDoWarping( true );
+	if( multiResolution )
+	{
+		updateMultiResLayout();
+	}
+}
 
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+ofMatrix4x4 ofxOculusRift::getEyeProjectionMatrix( bool _isLeftEye )
+{
+	updateEyeMatricesIfNeededThisFrame();
 	
-	return initSensor();
+	return eyeProjectionMatrix[ _isLeftEye ? 0 : 1 ];
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------------------------
 //
-void ofxOculusRift::beginRenderSceneLeftEye()
+ofMatrix4x4 ofxOculusRift::getEyeViewMatrix( bool _isLeftEye )
 {
-	beginRender( getInterOcularDistance() * -0.5f, &eyeFboLeft );
+	updateEyeMatricesIfNeededThisFrame();
+	
+	return eyeViewMatrix[ _isLeftEye ? 0 : 1 ];
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------------------------
 //
-void ofxOculusRift::endRenderSceneLeftEye()
+ofMatrix4x4 ofxOculusRift::getFarFieldProjectionMatrix()
 {
-	endRender( &eyeFboLeft );
+	updateEyeMatricesIfNeededThisFrame();
+	
+	return farFieldProjectionMatrix;
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------------------------
 //
-void ofxOculusRift::beginRenderSceneRightEye()
+ofMatrix4x4 ofxOculusRift::getFarFieldViewMatrix()
 {
-	beginRender( getInterOcularDistance() * 0.5f, &eyeFboRight );	
+	updateEyeMatricesIfNeededThisFrame();
+	
+	return farFieldViewMatrix;
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------------------------
 //
-void ofxOculusRift::endRenderSceneRightEye()
+const Util::Render::StereoEyeParams& ofxOculusRift::getStereoEyeParams( bool _isLeftEye )
 {
-	endRender( &eyeFboRight );
+	return stereoConfig.GetEyeRenderParams( _isLeftEye ? Util::Render::StereoEye_Left : Util::Render::StereoEye_Right );
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------------------------
 //
-void ofxOculusRift::beginRender( float _interOcularShift, ofFbo* _fbo  )
+Util::Render::StereoConfig& ofxOculusRift::getStereoConfig()
 {
-	ofPushView();
-
-		_fbo->begin();
-		ofClear(0,0,0); // Todo: get the proper clear color
-	
-		setupScreenPerspective( _interOcularShift, ofGetWidth(), ofGetHeight(), ofGetOrientation(), false, getFov(), getNearClip(), getFarClip()  );
-	
-		ofSetMatrixMode(OF_MATRIX_MODELVIEW);
-		ofLoadIdentityMatrix();
-	
-		ofPushMatrix();
-	
-			// flip for FBO
-			ofScale(1,-1,1);
-	
-			ofMultMatrix( getHeadsetViewOrientationMat() );
-			ofTranslate( getPosition() );
+	return stereoConfig;
 }
 
 
@@ -124,19 +825,26 @@ void ofxOculusRift::draw( ofVec2f pos, ofVec2f size )
 {
 	// Todo: rewrite this
 	
+	frameTiming.beginStage( OFX_OCULUSRIFT_STAGE_COMPOSITE );
 	
 	ofPushView();
 	
-		// draw into the new fbo we have made
-		ofSetColor( 255 );
-		glBindFramebuffer(GL_FRAMEBUFFER, framebufferID);
-			ofClear(0,0,0);
-			eyeFboLeft.draw( 0.0f, 0.0f );
-			eyeFboRight.draw( eyeFboLeft.getWidth(), 0.0f );
-	
-			// is this being drawn correctly?
+		// draw into the new fbo we have made, with multi-resolution the warp reads the eyes directly
+		if( !multiResolution )
+		{
+			ofSetColor( 255 );
+			glBindFramebuffer(GL_FRAMEBUFFER, framebufferID);
+				ofClear(0,0,0);
+				eyeFboLeft.draw( 0.0f, 0.0f );
+				eyeFboRight.draw( eyeFboLeft.getWidth(), 0.0f );
+		
+				// is this being drawn correctly?
+		
+			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		}
 	
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		frameTiming.endStage( OFX_OCULUSRIFT_STAGE_COMPOSITE );
+		frameTiming.beginStage( OFX_OCULUSRIFT_STAGE_WARP );
 		
 		ofSetMatrixMode(OF_MATRIX_PROJECTION);
 		ofLoadIdentityMatrix();
@@ -170,29 +878,225 @@ void ofxOculusRift::draw( ofVec2f pos, ofVec2f size )
 	if( !doWarping )
 	{
 		ofSetColor(255);
-		eyeFboLeft.draw( 0.0f, 0.0f );
-		eyeFboRight.draw( eyeFboLeft.getWidth(), 0.0f );
+		getEyeFbo( true )->draw( 0.0f, 0.0f );
+		getEyeFbo( false )->draw( getEyeFbo( true )->getWidth(), 0.0f );
+	}
+	
+	frameTiming.endStage( OFX_OCULUSRIFT_STAGE_WARP );
+	frameTiming.beginStage( OFX_OCULUSRIFT_STAGE_SWAP );
+	
+	// wait for the GPU when scheduling, otherwise the render cost is only the CPU side of it
+	if( frameScheduler.getEnabled() )
+	{
+		glFinish();
+	}
+	frameScheduler.renderEnd();
+	
+	// measured once the swap has returned, in onUpdate; no pose this frame, or no sensor data yet, and there is nothing to measure
+	swapPose = framePose;
+	swapPending = (framePose.frameNum == ofGetFrameNum() && framePose.sampleTime > 0.0);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRift::addOverlay( ofxOculusRiftOverlay* _overlay )
+{
+	if( find( overlays.begin(), overlays.end(), _overlay ) != overlays.end() )
+	{
+		return;
+	}
+	
+	if( (int)overlays.size() >= MaxOverlays )
+	{
+		ofLogWarning() << "ofxOculusRift: only the first " << MaxOverlays << " enabled overlays get drawn";
+	}
+	
+	overlays.push_back( _overlay );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRift::removeOverlay( ofxOculusRiftOverlay* _overlay )
+{
+	vector<ofxOculusRiftOverlay*>::iterator it = find( overlays.begin(), overlays.end(), _overlay );
+	if( it != overlays.end() )
+	{
+		overlays.erase( it );
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+ofxOculusRiftFrameTiming& ofxOculusRift::getFrameTiming()
+{
+	return frameTiming;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+ofxOculusRiftFrameScheduler& ofxOculusRift::getFrameScheduler()
+{
+	return frameScheduler;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRift::updatePredictionAfterSwap( double _swapTime )
+{
+	float latency = _swapTime - swapPose.sampleTime;
+	
+	if( latency < 0.0f || latency > 0.25f )
+	{
+		return; // a stall or a sensor that has gone quiet, this would only throw the mean off
 	}
 	
-	needSensorReadingThisFrame = true;
+	latencyHistory.push_back( latency );
+	sampleToPoseHistory.push_back( swapPose.captureTime - swapPose.sampleTime );
+	while( (int)latencyHistory.size() > predictionWindowSize ) { latencyHistory.pop_front(); sampleToPoseHistory.pop_front(); }
+	
+	float latencySum = 0.0f;
+	float sampleToPoseSum = 0.0f;
+	predictionStats.latencyMin = latencyHistory.front();
+	predictionStats.latencyMax = latencyHistory.front();
+	for( unsigned int i = 0; i < latencyHistory.size(); i++ )
+	{
+		latencySum += latencyHistory[i];
+		sampleToPoseSum += sampleToPoseHistory[i];
+		predictionStats.latencyMin = MIN( predictionStats.latencyMin, latencyHistory[i] );
+		predictionStats.latencyMax = MAX( predictionStats.latencyMax, latencyHistory[i] );
+	}
+	
+	predictionStats.numLatencySamples = latencyHistory.size();
+	predictionStats.latencyMean = latencySum / latencyHistory.size();
+	predictionStats.sampleToPoseMean = sampleToPoseSum / latencyHistory.size();
+	predictionStats.poseToDrawMean = predictionStats.latencyMean - predictionStats.sampleToPoseMean;
+	
+	if( autoPrediction )
+	{
+		FusionResult.SetPrediction( ofClamp( predictionStats.latencyMean, 0.0f, 0.1f ) );
+	}
+	predictionStats.predictionDelta = FusionResult.IsPredictionEnabled() ? FusionResult.GetPredictionDelta() : 0.0f;
+	
+	// what we rendered last frame, checked once the sensor has caught up with the time it was displayed
+	PendingPrediction pending;
+	pending.displayTime = _swapTime;
+	pending.orientation = Quatf( swapPose.orientation.x(), swapPose.orientation.y(), swapPose.orientation.z(), swapPose.orientation.w() );
+	pendingPredictions.push_back( pending );
+	while( (int)pendingPredictions.size() > predictionWindowSize ) { pendingPredictions.pop_front(); }
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------------------------
 //
-void ofxOculusRift::readSensorIfNeededThisFrame()
+void ofxOculusRift::resolvePendingPredictions( const SensorState& _state )
 {
-	if( needSensorReadingThisFrame )
+	bool gotNewErrors = false;
+	
+	while( !pendingPredictions.empty() && pendingPredictions.front().displayTime <= _state.SampleTime )
 	{
-		Vector3f tmpAcc = FusionResult.GetAcceleration();
-		acc.set( ofVec3f(tmpAcc.x, tmpAcc.y, tmpAcc.z) );
+		// the sample is a little later than the display time, take the rotation since then back out
+		float lateBy = _state.SampleTime - pendingPredictions.front().displayTime;
+		float angVelLength = _state.AngularVelocity.Length();
+		
+		Quatf actual = _state.Orientation;
+		if( angVelLength > 0.0f )
+		{
+			actual = actual * Quatf( _state.AngularVelocity, -angVelLength * lateBy );
+		}
 		
-		Quatf quaternion = FusionResult.GetOrientation();
-		setOrientation( ofQuaternion(quaternion.x, quaternion.y, quaternion.z, quaternion.w) ); // sets the orientation quat in ofNode
+		Quatf difference = pendingPredictions.front().orientation.Conj() * actual;
+		float errorDegrees = ofRadToDeg( 2.0f * acosf( MIN( fabsf( difference.w ), 1.0f ) ) );
+		
+		predictionErrorHistory.push_back( errorDegrees );
+		while( (int)predictionErrorHistory.size() > predictionWindowSize ) { predictionErrorHistory.pop_front(); }
+		
+		pendingPredictions.pop_front();
+		gotNewErrors = true;
+	}
+	
+	if( gotNewErrors )
+	{
+		float errorSum = 0.0f;
+		predictionStats.errorMax = 0.0f;
+		for( unsigned int i = 0; i < predictionErrorHistory.size(); i++ )
+		{
+			errorSum += predictionErrorHistory[i];
+			predictionStats.errorMax = MAX( predictionStats.errorMax, predictionErrorHistory[i] );
+		}
 		
-		needSensorReadingThisFrame = false;
+		predictionStats.numErrorSamples = predictionErrorHistory.size();
+		predictionStats.errorMean = errorSum / predictionErrorHistory.size();
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRift::setAutoPrediction( bool _autoPrediction )
+{
+	autoPrediction = _autoPrediction;
+	FusionResult.SetPredictionEnabled( autoPrediction );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+bool ofxOculusRift::getAutoPrediction()
+{
+	return autoPrediction;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRift::setPredictionWindowSize( int _numFrames )
+{
+	predictionWindowSize = MAX( _numFrames, 1 );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+const ofxOculusRiftPredictionStats& ofxOculusRift::getPredictionStats()
+{
+	return predictionStats;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRift::capturePose()
+{
+	updateAsyncInit();
+	
+	// the first pose of the frame is read as late as we can still render in time
+	frameScheduler.waitForRenderStart();
+	
+	SensorState state = FusionResult.GetSensorState();
+	
+	framePose.set( state, Timer::TicksToSeconds( Timer::GetTicks() ), ofGetFrameNum() );
+	
+	resolvePendingPredictions( state );
+	
+	setOrientation( framePose.orientation ); // keep the orientation in ofNode in step
+	
+	needSensorReadingThisFrame = false;
+	eyeMatricesFrameNum = -1;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRift::capturePoseIfNeededThisFrame()
+{
+	if( needSensorReadingThisFrame || framePose.frameNum != ofGetFrameNum() )
+	{
+		capturePose();
 	}
 }
 
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+const ofxOculusRiftFramePose& ofxOculusRift::getFramePose()
+{
+	capturePoseIfNeededThisFrame();
+	
+	return framePose;
+}
+
 // ---------------------------------------------------------------------------------------------------------------------------------------------------
 //
 void ofxOculusRift::setNeedSensorReadingThisFrame( bool _needSensorReading )
@@ -200,45 +1104,60 @@ void ofxOculusRift::setNeedSensorReadingThisFrame( bool _needSensorReading )
 	needSensorReadingThisFrame = _needSensorReading;
 }
 
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+SensorFusion& ofxOculusRift::getSensorFusion()
+{
+	return FusionResult;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+DeviceManager* ofxOculusRift::getDeviceManager()
+{
+	return pManager;
+}
+
 // ---------------------------------------------------------------------------------------------------------------------------------------------------
 //
 ofQuaternion ofxOculusRift::getHeadsetOrientationQuat()
 {
-	readSensorIfNeededThisFrame();
-	
-	return ofNode::getOrientationQuat();
+	return getFramePose().orientation;
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------------------------
 //
 ofQuaternion ofxOculusRift::getHeadsetViewOrientationQuat()
 {
-	return getHeadsetOrientationQuat().inverse();
+	return getFramePose().viewOrientation;
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------------------------
 //
 ofMatrix4x4 ofxOculusRift::getHeadsetOrientationMat()
 {
-	ofMatrix4x4 tmpMat;
-	getHeadsetOrientationQuat().get( tmpMat );
-	return tmpMat;
+	return getFramePose().orientationMat;
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------------------------
 //
 ofMatrix4x4 ofxOculusRift::getHeadsetViewOrientationMat()
 {
-	ofMatrix4x4 tmpMat;
-	getHeadsetViewOrientationQuat().get( tmpMat );
-	return tmpMat;
+	return getFramePose().viewOrientationMat;
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------------------------
 //
 ofVec3f	ofxOculusRift::getAcceleration()
 {
-	return acc;
+	return getFramePose().acceleration;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+ofVec3f	ofxOculusRift::getAngularVelocity()
+{
+	return getFramePose().angularVelocity;
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------------------------
@@ -246,6 +1165,7 @@ ofVec3f	ofxOculusRift::getAcceleration()
 void ofxOculusRift::setInterOcularDistance( float _iod )
 {
 	interOcularDistance = _iod;
+	stereoConfig.SetIPD( interOcularDistance / worldUnitsPerMeter );
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------------------------
@@ -255,6 +1175,21 @@ float ofxOculusRift::getInterOcularDistance()
 	return interOcularDistance;
 }
 
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRift::setWorldUnitsPerMeter( float _unitsPerMeter )
+{
+	worldUnitsPerMeter = _unitsPerMeter;
+	setInterOcularDistance( stereoConfig.GetIPD() * worldUnitsPerMeter );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+float ofxOculusRift::getWorldUnitsPerMeter()
+{
+	return worldUnitsPerMeter;
+}
+
 // ---------------------------------------------------------------------------------------------------------------------------------------------------
 //
 void ofxOculusRift::setShaderScaleFactor( float _scale )
@@ -266,7 +1201,7 @@ void ofxOculusRift::setShaderScaleFactor( float _scale )
 //
 float ofxOculusRift::getShaderScaleFactor()
 {
-	getShaderScaleFactor();
+	return shaderScaleFactor;
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------------------------
@@ -288,16 +1223,64 @@ void ofxOculusRift::renderDistortedEyeNew( bool _isLeftEye, float _x, float _y,
 {
 	float as = _w/_h;
 	
-	float DistortionXCenterOffset = -0.25f;
-	if ( _isLeftEye ) { DistortionXCenterOffset = 0.25f; }
+	const Util::Render::DistortionConfig& distortion = stereoConfig.GetDistortionConfig();
+	
+	// the right lens centre is mirrored
+	float DistortionXCenterOffset = distortion.XCenterOffset;
+	if ( !_isLeftEye ) { DistortionXCenterOffset = -distortion.XCenterOffset; }
+	
+	float scaleFactor = (1.0f / distortion.Scale) * shaderScaleFactor;
 	
 	hmdWarpShader.begin();
 	
 	hmdWarpShader.setUniform2f("LensCenter", _x + (_w + DistortionXCenterOffset * 0.5f)*0.5f, _y + _h*0.5f );
 	hmdWarpShader.setUniform2f("ScreenCenter", _x + _w*0.5f, _y + _h*0.5f );
-	hmdWarpShader.setUniform2f("Scale", (_w/2.0f) * shaderScaleFactor, (_h/2.0f) * shaderScaleFactor * as );
+	hmdWarpShader.setUniform2f("Scale", (_w/2.0f) * scaleFactor, (_h/2.0f) * scaleFactor * as );
 	hmdWarpShader.setUniform2f("ScaleIn", (2.0f/_w), (2.0f/_h) / as );
-	hmdWarpShader.setUniform4f("HmdWarpParam", K0, K1, K2, K3 );
+	hmdWarpShader.setUniform4f("HmdWarpParam", distortion.K[0], distortion.K[1], distortion.K[2], distortion.K[3] );
+	hmdWarpShader.setUniform1i("tex", 0 );
+	
+	// The packed eye goes in place of the composited screen, the shader finds the regions from the splits
+	int eyeIndex = _isLeftEye ? 0 : 1;
+	hmdWarpShader.setUniform1i("MultiRes", multiResolution ? 1 : 0 );
+	if( multiResolution )
+	{
+		ofxOculusRiftMultiResSplit eyeSplit = multiResLayout[eyeIndex].getEyeSplit();
+		ofxOculusRiftMultiResSplit packedSplit = multiResLayout[eyeIndex].getPackedSplit();
+		hmdWarpShader.setUniform4f("MultiResEyeSplit", eyeSplit.x0, eyeSplit.x1, eyeSplit.y0, eyeSplit.y1 );
+		hmdWarpShader.setUniform4f("MultiResPackedSplit", packedSplit.x0, packedSplit.x1, packedSplit.y0, packedSplit.y1 );
+		
+		glActiveTexture( GL_TEXTURE0 );
+		glBindTexture( GL_TEXTURE_2D, multiResFbo[eyeIndex].getTextureReference().getTextureData().textureID );
+	}
+	
+	// The overlays are looked up straight from their own textures, mapped from where the eye sees them. No flip
+	// here, the warp output has the right way up already.
+	int numOverlays = 0;
+	for( unsigned int i = 0; i < overlays.size() && numOverlays < MaxOverlays; i++ )
+	{
+		if( !overlays[i]->getEnabled() )
+		{
+			continue;
+		}
+		
+		ofMatrix4x4 viewProjection = eyeViewAdjustMatrix[eyeIndex] * eyeProjectionMatrix[eyeIndex];
+		if( !overlays[i]->getHeadLocked() )
+		{
+			viewProjection = headViewMatrix * viewProjection;
+		}
+		
+		float overlayMap[9];
+		overlays[i]->getEyeMapping( viewProjection, overlayMap );
+		
+		string prefix = "Overlay" + ofToString( numOverlays );
+		glUniformMatrix3fv( hmdWarpShader.getUniformLocation( (prefix + "Map").c_str() ), 1, GL_FALSE, overlayMap );
+		hmdWarpShader.setUniformTexture( (prefix + "Tex").c_str(), overlays[i]->getTextureReference(), numOverlays + 1 );
+		hmdWarpShader.setUniform1f( (prefix + "Alpha").c_str(), overlays[i]->getAlpha() );
+		
+		numOverlays++;
+	}
+	hmdWarpShader.setUniform1i("NumOverlays", numOverlays );
 	
 	if( _isLeftEye )
 	{
@@ -328,18 +1311,47 @@ bool ofxOculusRift::initSensor()
 {
 	System::Init();
 	
-	pManager = *DeviceManager::Create();
-	
-	pHMD = *pManager->EnumerateDevices<HMDDevice>().CreateDevice();
+	ofxOculusRiftDevices tmpDevices;
+	tmpDevices.open();
 	
-	if (pHMD)
+	return applyDevices( tmpDevices );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRift::updateAsyncInit()
+{
+	if( !asyncInitPending || !deviceThread.isDone() )
 	{
-		InfoLoaded = pHMD->GetDeviceInfo(&Info);
-		pSensor = *pHMD->GetSensor();
+		return;
 	}
-	else
+	
+	deviceThread.waitForThread( false );
+	asyncInitPending = false;
+	
+	bool sensorFound = applyDevices( deviceThread.devices );
+	deviceThread.devices.clear();
+	
+	ofNotifyEvent( deviceInitEvent, sensorFound, this );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+bool ofxOculusRift::applyDevices( ofxOculusRiftDevices& _devices )
+{
+	pManager = _devices.pManager;
+	pHMD = _devices.pHMD;
+	pSensor = _devices.pSensor;
+	
+	if (_devices.InfoLoaded)
 	{
-		pSensor = *pManager->EnumerateDevices<SensorDevice>().CreateDevice();
+		Info = _devices.Info;
+		InfoLoaded = true;
+		stereoConfig.SetHMDInfo( Info );
+		
+		setFov( stereoConfig.GetYFOVDegrees() );
+		setInterOcularDistance( Info.InterpupillaryDistance * worldUnitsPerMeter );
+		eyeMatricesFrameNum = -1;
 	}
 	
 	if (pSensor)
@@ -390,111 +1402,34 @@ bool ofxOculusRift::initSensor()
 //
 void ofxOculusRift::clearSensor()
 {
+	if( asyncInitPending )
+	{
+		deviceThread.waitForThread( false ); // can't pull the system out from under the discovery
+		deviceThread.devices.clear();
+		asyncInitPending = false;
+	}
+	
+	FusionResult.AttachToSensor( NULL );
+	
 	pSensor.Clear();
+	pHMD.Clear();
 	pManager.Clear();
 	
-	System::Destroy();
+	if( System::IsInitialized() )
+	{
+		System::Destroy();
+	}
 }
 
 // ---------------------------------------------------------------------------------------------------------------------------------------------------
 //
 void ofxOculusRift::shutdown()
 {
-	clearSensor();
-}
-
-// ---------------------------------------------------------------------------------------------------------------------------------------------------
-//
-void ofxOculusRift::setupScreenPerspective(float _interOcularDistance, float width, float height, ofOrientation orientation, bool vFlip, float fov, float nearDist, float farDist)
-{
-	if(width == 0) width = ofGetWidth();
-	if(height == 0) height = ofGetHeight();
-	
-	float viewW = ofGetViewportWidth();
-	float viewH = ofGetViewportHeight();
-	
-	float eyeX = viewW / 2;
-	float eyeY = viewH / 2;
-	float halfFov = PI * fov / 360;
-	float theTan = tanf(halfFov);
-	float dist = eyeY / theTan;
-	float aspect = (float) viewW / viewH;
-	
-	if(nearDist == 0) nearDist = dist / 10.0f;
-	if(farDist == 0) farDist = dist * 10.0f;
-	
-	ofSetMatrixMode(OF_MATRIX_PROJECTION);
-	ofLoadIdentityMatrix();
-	
-	ofTranslate( ofPoint(_interOcularDistance,0,0) );
-	
-	ofMatrix4x4 persp;
-	persp.makePerspectiveMatrix(fov, aspect, nearDist, farDist);
-	ofMultMatrix( persp );
-	//gluPerspective(fov, aspect, nearDist, farDist);
-	
-	
-	ofSetMatrixMode(OF_MATRIX_MODELVIEW);
-	ofLoadIdentityMatrix();
-	
-	ofMatrix4x4 lookAt;
-	lookAt.makeLookAtViewMatrix( ofVec3f(eyeX, eyeY, dist),  ofVec3f(eyeX, eyeY, 0),  ofVec3f(0, 1, 0) );
-	ofLoadMatrix( lookAt );
-	
-	//note - theo checked this on iPhone and Desktop for both vFlip = false and true
-	if(ofDoesHWOrientation()){
-		if(vFlip){
-			ofScale(1, -1, 1);
-			ofTranslate(0, -height, 0);
-		}
-	}else{
-		if( orientation == OF_ORIENTATION_UNKNOWN ) orientation = ofGetOrientation();
-		switch(orientation) {
-			case OF_ORIENTATION_180:
-				ofRotate(-180, 0, 0, 1);
-				if(vFlip){
-					ofScale(1, -1, 1);
-					ofTranslate(-width, 0, 0);
-				}else{
-					ofTranslate(-width, -height, 0);
-				}
-				
-				break;
-				
-			case OF_ORIENTATION_90_RIGHT:
-				ofRotate(-90, 0, 0, 1);
-				if(vFlip){
-					ofScale(-1, 1, 1);
-				}else{
-					ofScale(-1, -1, 1);
-					ofTranslate(0, -height, 0);
-				}
-				break;
-				
-			case OF_ORIENTATION_90_LEFT:
-				ofRotate(90, 0, 0, 1);
-				if(vFlip){
-					ofScale(-1, 1, 1);
-					ofTranslate(-width, -height, 0);
-				}else{
-					ofScale(-1, -1, 1);
-					ofTranslate(-width, 0, 0);
-				}
-				break;
-				
-			case OF_ORIENTATION_DEFAULT:
-			default:
-				if(vFlip){
-					ofScale(1, -1, 1);
-					ofTranslate(0, -height, 0);
-				}
-				break;
-		}
-	}
+	setPipelined( false );
 	
+	clearSensor();
 }
 
-
 //--------------------------------------------------------------
 void ofxOculusRift::initFBO(int screenWidth, int screenHeight)
 {
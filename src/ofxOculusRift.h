@@ -14,16 +14,161 @@
 using namespace OVR;
 #include <iostream>
 
+#include "ofxOculusRiftFrameTiming.h"
+#include "ofxOculusRiftOverlay.h"
+#include "ofxOculusRiftMultiRes.h"
+#include "ofxOculusRiftFrameScheduler.h"
+
 //#define STD_GRAV 9.81 // What SHOULD work with Rift, but off by 1000
 #define STD_GRAV 0.00981  // This gives nice 1.00G on Z with Rift face down !!!
 
 #define DTR = 0.0174532925f
 
 
-static float K0 = 1.0f;
-static float K1 = 0.22f;
-static float K2 = 0.24f;
-static float K3 = 0.0f;
+// Devices found by one round of discovery, opened either on the calling thread (init)
+// or on a background thread (initAsync).
+class ofxOculusRiftDevices
+{
+	public:
+	
+		ofxOculusRiftDevices();
+	
+		void				open();
+		void				clear();
+	
+		Ptr<DeviceManager>	pManager;
+		Ptr<HMDDevice>		pHMD;
+		Ptr<SensorDevice>	pSensor;
+		HMDInfo				Info;
+		bool				InfoLoaded;
+};
+
+// Runs the device discovery for initAsync, the HID round-trips can take a good while.
+class ofxOculusRiftDeviceThread : public ofThread
+{
+	public:
+	
+		ofxOculusRiftDeviceThread();
+	
+		void				threadedFunction();
+		bool				isDone();
+	
+		ofxOculusRiftDevices devices; // only touch this once isDone() returns true
+	
+	private:
+	
+		AtomicInt<int>		done; // released after devices is filled in, so no mutex needed
+};
+
+
+// The headset pose for one frame, captured once and then used by both eyes and all the getters.
+class ofxOculusRiftFramePose
+{
+	public:
+	
+		ofxOculusRiftFramePose();
+	
+		void				set( const SensorState& _state, double _captureTime, int _frameNum );
+	
+		ofQuaternion		orientation;		// predicted if prediction is enabled on the SensorFusion
+		ofQuaternion		viewOrientation;	// the inverse, to make a view from the headset
+		ofMatrix4x4			orientationMat;
+		ofMatrix4x4			viewOrientationMat;
+	
+		ofVec3f				acceleration;		// m/s^2
+		ofVec3f				angularVelocity;	// rad/s
+	
+		double				sampleTime;			// OVR Timer::GetTicks() in seconds when the sensor sample was integrated, 0 before the first one
+		double				predictedTime;		// the time the orientation is predicted for
+		double				captureTime;		// when the pose was read, same clock
+	
+		int					frameNum;			// ofGetFrameNum() when captured, -1 if never
+};
+
+
+// Hands poses from one thread to another without either of them waiting, a triple buffer. One writer, one reader.
+class ofxOculusRiftPoseSlot
+{
+	public:
+	
+		ofxOculusRiftPoseSlot();
+	
+		void				write( const ofxOculusRiftFramePose& _pose );
+		bool				read( ofxOculusRiftFramePose& _pose );	// false if nothing new was written since the last read
+	
+	private:
+	
+		enum { FreshBit = 4 };
+	
+		ofxOculusRiftFramePose buffers[3];
+		AtomicInt<UInt32>	middle;		// the buffer in between the two, with FreshBit set when the writer just left it there
+		int					back;		// only the writer touches this one
+		int					front;		// and the reader this one
+};
+
+
+// What the pipelined update gets, on the update thread
+class ofxOculusRiftUpdateArgs : public ofEventArgs
+{
+	public:
+	
+		int					frameNum;	// the frame to get ready, one ahead of the one being drawn
+		ofxOculusRiftFramePose pose;	// an early pose for that frame, the one it is drawn with is read later
+};
+
+
+class ofxOculusRift;
+
+// Runs pipelineUpdateEvent for the next frame while the GL thread draws this one
+class ofxOculusRiftUpdateThread : public ofThread
+{
+	public:
+	
+		ofxOculusRiftUpdateThread();
+	
+		void				start( ofxOculusRift* _rift );
+		void				stop();
+	
+		void				beginFrame( int _frameNum, float _frameDelta );	// GL thread, start getting a frame ready
+		void				waitForFrame();									// GL thread, blocks until that is done
+	
+		void				threadedFunction();
+	
+		ofxOculusRiftPoseSlot poseSlot;
+	
+	private:
+	
+		ofxOculusRift*		rift;
+		Event				startEvent;
+		Event				doneEvent;
+		AtomicInt<int>		frameNum;
+		float				frameDelta;		// handed over through startEvent, so the worker never reads the scheduler
+		bool				busy;
+};
+
+
+// What the automatic prediction is doing, latencies are measured from the sensor sample to the return of the
+// buffer swap, as seen in the next update event, so the wait for vsync is in them. Errors compare the orientation
+// we rendered with the one measured later for the time it ended up on screen.
+class ofxOculusRiftPredictionStats
+{
+	public:
+	
+		ofxOculusRiftPredictionStats();
+	
+		float				predictionDelta;	// seconds
+	
+		float				latencyMean;		// seconds, over the window
+		float				latencyMin;
+		float				latencyMax;
+		float				sampleToPoseMean;	// the part of latencyMean before the pose was read
+		float				poseToDrawMean;		// and the part after, through draw and the swap
+		int					numLatencySamples;
+	
+		float				errorMean;			// degrees, over the window
+		float				errorMax;
+		int					numErrorSamples;
+};
 
 
 class ofxOculusRift : public ofCamera
@@ -35,14 +180,48 @@ class ofxOculusRift : public ofCamera
 	
 		bool				init( int _width, int _height, int _fboNumSamples = 0 );
 	
-		void				beginRenderSceneLeftEye();
+		// Returns straight away and opens the devices on a background thread. Until they are found we render
+		// with the default DK1 HMDInfo, deviceInitEvent is notified from the main thread once the switch is made,
+		// the argument tells whether a sensor was found.
+		void				initAsync( int _width, int _height, int _fboNumSamples = 0 );
+		bool				isInitPending();
+	
+		ofEvent<bool>		deviceInitEvent;
+	
+		const HMDInfo&		getHMDInfo();
+	
+		// With multi-resolution on, render each eye once per region, getNumEyeRegions() times, otherwise just the once
+		void				beginRenderSceneLeftEye( int _region = 0 );
 		void				endRenderSceneLeftEye();
 	
-		void				beginRenderSceneRightEye();
+		void				beginRenderSceneRightEye( int _region = 0 );
 		void				endRenderSceneRightEye();
+	
+		// Renders the edges of the eyes at a lower resolution, the warp squeezes them anyway. The eye is split in a
+		// full resolution centre and a border at _borderResolution of that, where the split is depends on the lens.
+		// The warp reads straight from the packed regions, without warping you see them as they are.
+		void				setMultiResolution( bool _multiResolution, float _borderResolution = 0.5f );
+		bool				getMultiResolution();
+		int					getNumEyeRegions();
+		const ofxOculusRiftMultiResLayout& getMultiResLayout( bool _isLeftEye );
+	
+		// Splits the scene at a distance in world units. Anything further away is rendered once from the centre of
+		// the head between begin/endRenderSceneFarField, before the eyes, and both eyes then only render what is
+		// closer on top of it. Past a few meters the eyes see the same image anyway. 0 (the default) turns it off,
+		// when it is on the eyes' far clip is the split distance, so don't leave out the far field pass.
+		void				setFarFieldDistance( float _distance );
+		float				getFarFieldDistance();
+	
+		void				beginRenderSceneFarField();
+		void				endRenderSceneFarField();
 
 		void				draw( ofVec2f pos, ofVec2f size );
 	
+		// Reads the sensor once and keeps the result for the rest of the frame. Call this where you want the
+		// pose to be taken, otherwise it happens the first time anything below (or rendering an eye) needs it.
+		void				capturePose();
+		const ofxOculusRiftFramePose& getFramePose();
+	
 		//ofQuaternion		getOrientationQuat() const; //
 
 		ofQuaternion		getHeadsetOrientationQuat(); // this is confusing, but I'm trying to read the sensor
@@ -56,11 +235,63 @@ class ofxOculusRift : public ofCamera
 		ofMatrix4x4			getHeadsetViewOrientationMat();
 	
 		ofVec3f				getAcceleration();
+		ofVec3f				getAngularVelocity();
 		
-		void				setNeedSensorReadingThisFrame( bool _needSensorReading );
+		void				setNeedSensorReadingThisFrame( bool _needSensorReading ); // true makes the next access capture the pose again
+	
+		// For threads that want the sensor at their own rate, they can block in WaitForSample with a SensorSubscriber
+		SensorFusion&		getSensorFusion();
+		// The thread reading the headset; on a loaded machine pin it to a core and give it real-time scheduling
+		// with SetThreadScheduling, the fusion thread likewise with SensorFusion::SetFusionThreadScheduling
+		DeviceManager*		getDeviceManager();
+	
+		// On by default, keeps setting the SensorFusion prediction to the latency measured over the last frames
+		void				setAutoPrediction( bool _autoPrediction );
+		bool				getAutoPrediction();
+		void				setPredictionWindowSize( int _numFrames );
+		const ofxOculusRiftPredictionStats& getPredictionStats();
+	
+		// Overlays are composited in the warp pass, the warp shader has room for MaxOverlays of them.
+		// We don't own them, remove them before they go away.
+		void				addOverlay( ofxOculusRiftOverlay* _overlay );
+		void				removeOverlay( ofxOculusRiftOverlay* _overlay );
 	
+		enum { MaxOverlays = 2 };
+	
+		// Per stage CPU/GPU times of the last frames, cheap enough to leave on. Export with saveCsv or saveChromeTrace.
+		ofxOculusRiftFrameTiming& getFrameTiming();
+	
+		// Off by default. When enabled, and with vertical sync on, reading the pose is held back until there is just
+		// enough time left to render before the next vsync. Frames start on the update event.
+		ofxOculusRiftFrameScheduler& getFrameScheduler();
+	
+		// Pipelined mode runs pipelineUpdateEvent for frame N+1 on a worker thread while this one draws frame N, put
+		// your update and culling in there and keep what it makes double buffered. It gets an early pose predicted
+		// for when that frame is on screen. The pose the frame is actually drawn with is read again just before
+		// rendering, so leave a little margin when culling. getPipelinePose() is the early one, on the GL thread.
+		void				setPipelined( bool _pipelined );
+		bool				getPipelined();
+		const ofxOculusRiftFramePose& getPipelinePose();
+	
+		ofEvent<ofxOculusRiftUpdateArgs> pipelineUpdateEvent;
+	
+		// The eye separation in world units, defaults to the HMD's IPD scaled by the world units per meter
 		void				setInterOcularDistance( float _iod );
 		float				getInterOcularDistance();
+	
+		void				setWorldUnitsPerMeter( float _unitsPerMeter );
+		float				getWorldUnitsPerMeter();
+	
+		// The eye matrices are worked out once per frame from the StereoConfig, the projection includes
+		// the lens centre offset. Handy if you want to do your own culling.
+		ofMatrix4x4			getEyeProjectionMatrix( bool _isLeftEye );
+		ofMatrix4x4			getEyeViewMatrix( bool _isLeftEye );
+	
+		ofMatrix4x4			getFarFieldProjectionMatrix();
+		ofMatrix4x4			getFarFieldViewMatrix();
+	
+		const Util::Render::StereoEyeParams& getStereoEyeParams( bool _isLeftEye );
+		Util::Render::StereoConfig& getStereoConfig();
 		
 		void				setShaderScaleFactor( float _scale );
 		float				getShaderScaleFactor();
@@ -72,20 +303,34 @@ class ofxOculusRift : public ofCamera
 		
 	private:
 	
+		friend class ofxOculusRiftUpdateThread;
+	
+		void				initRendering( int _width, int _height, int _fboNumSamples );
+	
+		void				onUpdate( ofEventArgs& _args );
+	
 		bool				initSensor();
+		bool				applyDevices( ofxOculusRiftDevices& _devices );
+		void				updateAsyncInit();
 		void				clearSensor();
 	
-		void				beginRender( float interOcularShift, ofFbo* _fbo  );
+		void				beginRender( bool _isLeftEye, int _region );
 		void				endRender( ofFbo* _fbo );
+		ofFbo*				getEyeFbo( bool _isLeftEye );
+	
+		void				allocateFarFieldFboIfNeeded();
+		void				drawFarField( bool _isLeftEye, const ofRectangle& _ndc );
+	
+		void				updateMultiResLayout();
 	
-		void				readSensorIfNeededThisFrame();
+		void				capturePoseIfNeededThisFrame();
 	
-		void				setupScreenPerspective(float _interOcularDistance,
-													float width, float height,
-													ofOrientation orientation,
-													bool vFlip,
-													float fov,
-													float nearDist, float farDist );
+		void				updatePipelinedFrame( int _frameNum, float _frameDelta );	// on the update thread
+	
+		void				updatePredictionAfterSwap( double _swapTime );
+		void				resolvePendingPredictions( const SensorState& _state );
+	
+		void				updateEyeMatricesIfNeededThisFrame();
 	
 		void				renderDistortedEyeNew( bool _isLeftEye, float x, float y, float w, float h );
 	
@@ -97,13 +342,59 @@ class ofxOculusRift : public ofCamera
 
 	
 		float				interOcularDistance;
+		float				worldUnitsPerMeter;
+	
+		int					eyeMatricesFrameNum;
+		ofMatrix4x4			eyeProjectionMatrix[2]; // left, right
+		ofMatrix4x4			eyeViewMatrix[2];
+		ofMatrix4x4			eyeViewAdjustMatrix[2];
+		ofMatrix4x4			headViewMatrix;
+	
+		float				farFieldDistance;
+		int					farFieldFrameNum;
+		ofMatrix4x4			farFieldProjectionMatrix;
+		ofMatrix4x4			farFieldViewMatrix;
+	
+		vector<ofxOculusRiftOverlay*> overlays;
 	
 		ofFbo				eyeFboLeft;  // Todo: draw straight into a full sized FBO
 		ofFbo				eyeFboRight;
+		ofFbo				farFieldFbo; // a bit wider than an eye, to cover both lens centre offsets
+		int					fboNumSamples;
+	
+		bool				multiResolution;
+		float				multiResBorderResolution;
+		ofxOculusRiftMultiResLayout multiResLayout[2];
+		ofFbo				multiResFbo[2];
+		int					currentRegion;
 	
 		bool				needSensorReadingThisFrame;
 	
-		ofVec3f				acc;
+		ofxOculusRiftFramePose framePose;
+	
+		struct PendingPrediction
+		{
+			double			displayTime;
+			Quatf			orientation;
+		};
+	
+		ofxOculusRiftFramePose swapPose;		// what was drawn, until its swap has returned
+		bool				swapPending;
+	
+		bool				autoPrediction;
+		int					predictionWindowSize;
+		deque<float>		latencyHistory;
+		deque<float>		sampleToPoseHistory;
+		deque<float>		predictionErrorHistory;
+		deque<PendingPrediction> pendingPredictions;
+		ofxOculusRiftPredictionStats predictionStats;
+	
+		ofxOculusRiftFrameTiming frameTiming;
+		ofxOculusRiftFrameScheduler frameScheduler;
+	
+		bool				pipelined;
+		ofxOculusRiftUpdateThread updateThread;
+		ofxOculusRiftFramePose pipelinePose;
 	
 		// Todo: re-write to use an ofFbo, either re-write shader to do texture rect coordinates or init a gl_texture_2d that is npot
 		GLuint				colorTextureID;
@@ -117,4 +408,9 @@ class ofxOculusRift : public ofCamera
 		HMDInfo				Info;
 		bool				InfoLoaded;
 	
+		Util::Render::StereoConfig stereoConfig;
+	
+		ofxOculusRiftDeviceThread deviceThread;
+		bool				asyncInitPending;
+	
 };
@@ -0,0 +1,176 @@
+//
+//  ofxOculusRiftFrameRecorder.cpp
+//  OculusRiftRendering
+//
+//
+//
+
+#include "ofxOculusRiftFrameRecorder.h"
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+ofxOculusRiftFrameRecord::ofxOculusRiftFrameRecord()
+{
+	clear();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftFrameRecord::clear()
+{
+	serial = 0;
+	frameNum = -1;
+	
+	for( int i = 0; i < OFX_OCULUSRIFT_NUM_STAGES; i++ )
+	{
+		cpuBegin[i] = 0;
+		cpuEnd[i] = 0;
+		gpuBegin[i] = -1.0f;
+		gpuEnd[i] = -1.0f;
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+ofxOculusRiftFrameRecorder::ofxOculusRiftFrameRecorder()
+{
+	haveCurrent = false;
+	
+	numPublished = 0;
+	for( int i = 0; i < NumRecords; i++ )
+	{
+		slots[i].sequence = 0;
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftFrameRecorder::startFrame( int _frameNum )
+{
+	if( haveCurrent )
+	{
+		// the swap stage runs until the next frame starts
+		if( current.cpuBegin[OFX_OCULUSRIFT_STAGE_SWAP] > 0 && current.cpuEnd[OFX_OCULUSRIFT_STAGE_SWAP] == 0 )
+		{
+			current.cpuEnd[OFX_OCULUSRIFT_STAGE_SWAP] = Timer::GetProfileTicks();
+		}
+		
+		writeSlot( current );
+		numPublished.Store_Release( current.serial + 1 );
+	}
+	
+	current.clear();
+	current.frameNum = _frameNum;
+	current.serial = numPublished;
+	haveCurrent = true;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftFrameRecorder::beginStage( ofxOculusRiftFrameStage _stage )
+{
+	if( haveCurrent )
+	{
+		current.cpuBegin[_stage] = Timer::GetProfileTicks();
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftFrameRecorder::endStage( ofxOculusRiftFrameStage _stage )
+{
+	if( haveCurrent )
+	{
+		current.cpuEnd[_stage] = Timer::GetProfileTicks();
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftFrameRecorder::discardFrame()
+{
+	haveCurrent = false;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftFrameRecorder::rewrite( const ofxOculusRiftFrameRecord& _record )
+{
+	writeSlot( _record );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftFrameRecorder::writeSlot( const ofxOculusRiftFrameRecord& _record )
+{
+	Slot& slot = slots[ _record.serial % NumRecords ];
+	
+	UInt32 sequence = slot.sequence;
+	slot.sequence.Exchange_Sync( sequence + 1 ); // odd, the full barrier keeps the record writes after it
+	slot.record = _record;
+	slot.sequence.Store_Release( sequence + 2 );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+bool ofxOculusRiftFrameRecorder::read( UInt32 _serial, ofxOculusRiftFrameRecord& _record )
+{
+	Slot& slot = slots[ _serial % NumRecords ];
+	
+	for( int tries = 0; tries < MaxReadTries; tries++ )
+	{
+		UInt32 sequenceBefore = slot.sequence.Load_Acquire();
+		if( sequenceBefore & 1 )
+		{
+			continue; // being written
+		}
+		
+		_record = slot.record;
+		
+		// adding 0 is just a full barrier, so the copy above can't be moved past the check
+		UInt32 sequenceAfter = slot.sequence.ExchangeAdd_Sync( 0 );
+		if( sequenceBefore == sequenceAfter )
+		{
+			return _record.serial == _serial && _record.frameNum >= 0; // the ring may have moved on
+		}
+	}
+	
+	return false;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+int ofxOculusRiftFrameRecorder::getRecords( std::vector<ofxOculusRiftFrameRecord>& _records )
+{
+	_records.clear();
+	
+	UInt32 published = numPublished.Load_Acquire();
+	UInt32 first = published > NumRecords ? published - NumRecords : 0;
+	
+	ofxOculusRiftFrameRecord record;
+	for( UInt32 serial = first; serial < published; serial++ )
+	{
+		if( read( serial, record ) )
+		{
+			_records.push_back( record );
+		}
+	}
+	
+	return _records.size();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+const char* ofxOculusRiftFrameRecorder::getStageName( int _stage )
+{
+	switch( _stage )
+	{
+		case OFX_OCULUSRIFT_STAGE_SCENE_FAR_FIELD: return "SceneFarField";
+		case OFX_OCULUSRIFT_STAGE_SCENE_LEFT:	return "SceneLeft";
+		case OFX_OCULUSRIFT_STAGE_SCENE_RIGHT:	return "SceneRight";
+		case OFX_OCULUSRIFT_STAGE_COMPOSITE:	return "Composite";
+		case OFX_OCULUSRIFT_STAGE_WARP:			return "Warp";
+		case OFX_OCULUSRIFT_STAGE_SWAP:			return "Swap";
+		default:								return "Unknown";
+	}
+}
@@ -0,0 +1,101 @@
+//
+//  ofxOculusRiftFrameRecorder.h
+//  OculusRiftRendering
+//
+//
+//
+
+#pragma once
+
+#include <vector>
+
+#include "OVR.h"
+using namespace OVR;
+
+enum ofxOculusRiftFrameStage
+{
+	OFX_OCULUSRIFT_STAGE_SCENE_FAR_FIELD = 0,	// only there when the far field is rendered
+	OFX_OCULUSRIFT_STAGE_SCENE_LEFT,
+	OFX_OCULUSRIFT_STAGE_SCENE_RIGHT,
+	OFX_OCULUSRIFT_STAGE_COMPOSITE,
+	OFX_OCULUSRIFT_STAGE_WARP,
+	OFX_OCULUSRIFT_STAGE_SWAP,			// from the end of draw() to the start of the next frame, so it includes the rest of the app's draw
+	OFX_OCULUSRIFT_NUM_STAGES
+};
+
+
+// Where one frame's time went. CPU times are Timer::GetProfileTicks microseconds, GPU times are in microseconds
+// from the first GPU timestamp of the frame, as the GPU clock has nothing to do with the CPU one.
+class ofxOculusRiftFrameRecord
+{
+	public:
+	
+		ofxOculusRiftFrameRecord();
+	
+		void				clear();
+	
+		bool				hasStage( int _stage ) const		{ return cpuEnd[_stage] >= cpuBegin[_stage] && cpuBegin[_stage] > 0; }
+		bool				hasGpuStage( int _stage ) const		{ return gpuEnd[_stage] >= gpuBegin[_stage] && gpuBegin[_stage] >= 0.0f; }
+	
+		UInt32				serial;			// how many frames were recorded before this one
+		int					frameNum;
+	
+		UInt64				cpuBegin[OFX_OCULUSRIFT_NUM_STAGES];
+		UInt64				cpuEnd[OFX_OCULUSRIFT_NUM_STAGES];
+	
+		float				gpuBegin[OFX_OCULUSRIFT_NUM_STAGES]; // -1 until the queries come back, and for the swap
+		float				gpuEnd[OFX_OCULUSRIFT_NUM_STAGES];
+};
+
+
+// The CPU side of ofxOculusRiftFrameTiming, without GL: timestamps the stages of each frame into a fixed ring
+// of records. Only one thread writes, anyone can read at any time: every slot has a sequence number that is odd
+// while it is being written, readers copy the record and try again if the number moved underneath them.
+// Recording a stage is one profile tick read.
+class ofxOculusRiftFrameRecorder
+{
+	public:
+	
+		ofxOculusRiftFrameRecorder();
+	
+		// Writer thread only. startFrame publishes the frame being recorded, ending its swap stage if that
+		// is still open, and starts on the next one; stages are only recorded between the two.
+		void				startFrame( int _frameNum );
+		void				beginStage( ofxOculusRiftFrameStage _stage );
+		void				endStage( ofxOculusRiftFrameStage _stage );
+		void				discardFrame();		// a half recorded frame would only confuse the export
+	
+		bool				isRecording() const				{ return haveCurrent; }
+		int					getFrameNum() const				{ return haveCurrent ? current.frameNum : -1; }
+		UInt32				getSerial() const				{ return current.serial; }
+	
+		// Writer thread only, puts a published record back with what was found out about it later
+		void				rewrite( const ofxOculusRiftFrameRecord& _record );
+	
+		// Any thread. read fails once the ring has moved past the record, or if the writer keeps it busy.
+		bool				read( UInt32 _serial, ofxOculusRiftFrameRecord& _record );
+		UInt32				getNumPublished()				{ return numPublished.Load_Acquire(); }
+	
+		// Any thread. Fills in the recorded frames, oldest first, and returns how many there are.
+		int					getRecords( std::vector<ofxOculusRiftFrameRecord>& _records );
+	
+		static const char*	getStageName( int _stage );
+	
+		enum { NumRecords = 512, MaxReadTries = 100 };
+	
+	private:
+	
+		struct Slot
+		{
+			AtomicInt<UInt32>	sequence;
+			ofxOculusRiftFrameRecord record;
+		};
+	
+		void				writeSlot( const ofxOculusRiftFrameRecord& _record );
+	
+		Slot				slots[NumRecords];
+		AtomicInt<UInt32>	numPublished;
+	
+		ofxOculusRiftFrameRecord current;	// being recorded, published by the next startFrame
+		bool				haveCurrent;
+};
@@ -0,0 +1,254 @@
+//
+//  ofxOculusRiftFrameScheduler.cpp
+//  OculusRiftRendering
+//
+//
+//
+
+#include "ofxOculusRiftFrameScheduler.h"
+
+#include <vector>
+#include <algorithm>
+#include <math.h>
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+double ofxOculusRiftClock::getSeconds()
+{
+	return Timer::TicksToSeconds( Timer::GetTicks() );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftClock::sleepUntil( double _seconds )
+{
+	// the OS only sleeps to a millisecond or two, so sleep most of the way and spin for the rest
+	double remaining = _seconds - getSeconds();
+	if( remaining > 0.003 )
+	{
+		Thread::MSleep( (unsigned)((remaining - 0.002) * 1000.0) );
+	}
+	
+	while( getSeconds() < _seconds ) {}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+ofxOculusRiftFrameScheduler::ofxOculusRiftFrameScheduler()
+{
+	enabled = false;
+	clock = &defaultClock;
+	
+	vsyncPeriod = 1.0f / 60.0f;
+	lastVsync = -1.0;
+	lastFrameStart = -1.0;
+	safetyMargin = 0.002f;
+	renderCostPercentile = 0.9f;
+	historySize = 60;
+	
+	predictedRenderCost = 0.0f;
+	
+	waitedThisFrame = false;
+	renderStartTime = -1.0;
+	targetVsync = 0.0;
+	lastWait = 0.0f;
+	numMissedVsyncs = 0;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftFrameScheduler::setEnabled( bool _enabled )
+{
+	enabled = _enabled;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+bool ofxOculusRiftFrameScheduler::getEnabled()
+{
+	return enabled;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftFrameScheduler::setClock( ofxOculusRiftClock* _clock )
+{
+	clock = (_clock != NULL) ? _clock : &defaultClock;
+	
+	// times from the old clock mean nothing on the new one
+	lastVsync = -1.0;
+	lastFrameStart = -1.0;
+	renderStartTime = -1.0;
+	frameIntervalHistory.clear();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftFrameScheduler::setRefreshRate( float _hz )
+{
+	vsyncPeriod = 1.0f / Alg::Max( _hz, 1.0f );
+	frameIntervalHistory.clear();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftFrameScheduler::setSafetyMargin( float _seconds )
+{
+	safetyMargin = Alg::Max( _seconds, 0.0f );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftFrameScheduler::setRenderCostPercentile( float _percentile )
+{
+	renderCostPercentile = Alg::Clamp( _percentile, 0.0f, 1.0f );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftFrameScheduler::setHistorySize( int _numFrames )
+{
+	historySize = Alg::Max( _numFrames, 1 );
+	
+	while( (int)renderCostHistory.size() > historySize )	{ renderCostHistory.pop_front(); }
+	while( (int)frameIntervalHistory.size() > historySize ) { frameIntervalHistory.pop_front(); }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftFrameScheduler::frameStart()
+{
+	double now = clock->getSeconds();
+	
+	waitedThisFrame = false;
+	
+	double previousFrameStart = lastFrameStart;
+	lastFrameStart = now;
+	
+	if( lastVsync < 0.0 || previousFrameStart < 0.0 )
+	{
+		lastVsync = now;
+		return;
+	}
+	
+	// Frames that missed a vsync come in at a multiple of the period, only the ones close to a single period
+	// tell us anything about it. The period is the median of those, to keep the odd late swap out of it.
+	// Measured between the swaps themselves, against the smoothed phase an error in it would feed back into the period.
+	float interval = now - previousFrameStart;
+	if( fabs( interval - vsyncPeriod ) < vsyncPeriod * 0.25f )
+	{
+		frameIntervalHistory.push_back( interval );
+		while( (int)frameIntervalHistory.size() > historySize ) { frameIntervalHistory.pop_front(); }
+		
+		std::vector<float> sorted( frameIntervalHistory.begin(), frameIntervalHistory.end() );
+		std::sort( sorted.begin(), sorted.end() );
+		vsyncPeriod = sorted[ sorted.size() / 2 ];
+	}
+	
+	// Follow the phase slowly while we are on it, the swap returns a little after the vsync and not always by the
+	// same amount. If we are way off, start again from here.
+	double expected = lastVsync + vsyncPeriod * floor( (now - lastVsync) / vsyncPeriod + 0.5 );
+	if( fabs( now - expected ) < vsyncPeriod * 0.25 )
+	{
+		lastVsync = expected + (now - expected) * 0.1;
+	}
+	else
+	{
+		lastVsync = now;
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftFrameScheduler::waitForRenderStart()
+{
+	if( waitedThisFrame )
+	{
+		return;
+	}
+	
+	waitedThisFrame = true;
+	
+	double now = clock->getSeconds();
+	
+	if( lastVsync < 0.0 )
+	{
+		lastVsync = now; // never saw a frame start, make do
+	}
+	
+	// the first vsync we can still make with the time rendering usually takes
+	double needed = predictedRenderCost + safetyMargin;
+	targetVsync = lastVsync + vsyncPeriod * Alg::Max( ceil( (now + needed - lastVsync) / vsyncPeriod ), 1.0 );
+	
+	double start = targetVsync - needed;
+	
+	lastWait = 0.0f;
+	if( enabled && start > now )
+	{
+		clock->sleepUntil( start );
+		lastWait = start - now;
+	}
+	
+	renderStartTime = clock->getSeconds();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftFrameScheduler::renderEnd()
+{
+	if( renderStartTime < 0.0 )
+	{
+		return;
+	}
+	
+	double now = clock->getSeconds();
+	
+	if( enabled && now > targetVsync )
+	{
+		numMissedVsyncs++;
+	}
+	
+	renderCostHistory.push_back( now - renderStartTime );
+	while( (int)renderCostHistory.size() > historySize ) { renderCostHistory.pop_front(); }
+	
+	std::vector<float> sorted( renderCostHistory.begin(), renderCostHistory.end() );
+	std::sort( sorted.begin(), sorted.end() );
+	predictedRenderCost = sorted[ Alg::Min( (int)(renderCostPercentile * sorted.size()), (int)sorted.size() - 1 ) ];
+	
+	renderStartTime = -1.0;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+float ofxOculusRiftFrameScheduler::getVsyncPeriod()
+{
+	return vsyncPeriod;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+double ofxOculusRiftFrameScheduler::getNextVsync()
+{
+	return targetVsync;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+float ofxOculusRiftFrameScheduler::getPredictedRenderCost()
+{
+	return predictedRenderCost;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+float ofxOculusRiftFrameScheduler::getLastWait()
+{
+	return lastWait;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+int ofxOculusRiftFrameScheduler::getNumMissedVsyncs()
+{
+	return numMissedVsyncs;
+}
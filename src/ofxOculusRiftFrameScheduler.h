@@ -0,0 +1,84 @@
+//
+//  ofxOculusRiftFrameScheduler.h
+//  OculusRiftRendering
+//
+//
+//
+
+#pragma once
+
+#include <deque>
+
+#include "OVR.h"
+using namespace OVR;
+
+// Where the scheduler gets its time from. The default one is the OVR Timer, the same clock the sensor samples
+// are stamped with. Hand the scheduler your own to run it against simulated render times.
+class ofxOculusRiftClock
+{
+	public:
+	
+		virtual				~ofxOculusRiftClock() {}
+		
+		virtual double		getSeconds();
+		virtual void		sleepUntil( double _seconds );
+};
+
+
+// Starts rendering as late as it can get away with. Learns the vsync period and phase from when frames start
+// (the buffer swap returns on vsync), predicts the render cost from the last frames, and holds the pose
+// reading back until there is just enough time left to render and make the next vsync. Only makes sense with
+// vertical sync on, otherwise there is nothing to line up with. Plain OVR, no openFrameworks in here, so it can
+// be run on its own against a simulated clock (tests/FrameSchedulerTest.cpp).
+class ofxOculusRiftFrameScheduler
+{
+	public:
+	
+		ofxOculusRiftFrameScheduler();
+		
+		void				setEnabled( bool _enabled );
+		bool				getEnabled();
+		
+		void				setClock( ofxOculusRiftClock* _clock ); // we don't own it, NULL for the default
+		
+		void				setRefreshRate( float _hz );				// the starting guess for the vsync period, within a quarter of it
+		void				setSafetyMargin( float _seconds );			// left between the end of rendering and vsync
+		void				setRenderCostPercentile( float _percentile );	// 0.9 plans for all but the slowest 10% of frames
+		void				setHistorySize( int _numFrames );
+		
+		// Call these when the swap has returned, before the pose is read and when rendering is done.
+		// ofxOculusRift does this itself, you only need them if you drive the scheduler on its own.
+		void				frameStart();
+		void				waitForRenderStart();	// only waits the first time in a frame
+		void				renderEnd();
+		
+		float				getVsyncPeriod();
+		double				getNextVsync();			// the one the current frame is aiming for
+		float				getPredictedRenderCost();
+		float				getLastWait();			// how long the last frame was held back
+		int					getNumMissedVsyncs();	// frames that finished rendering after the vsync they were aiming for
+	
+	private:
+	
+		bool				enabled;
+		
+		ofxOculusRiftClock	defaultClock;
+		ofxOculusRiftClock*	clock;
+		
+		float				vsyncPeriod;
+		double				lastVsync;			// -1 until the first frame
+		double				lastFrameStart;
+		float				safetyMargin;
+		float				renderCostPercentile;
+		int					historySize;
+		
+		std::deque<float>	renderCostHistory;
+		std::deque<float>	frameIntervalHistory;
+		float				predictedRenderCost;
+		
+		bool				waitedThisFrame;
+		double				renderStartTime;	// -1 if nothing is being rendered
+		double				targetVsync;
+		float				lastWait;
+		int					numMissedVsyncs;
+};
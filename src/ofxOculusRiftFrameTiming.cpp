@@ -0,0 +1,340 @@
+//
+//  ofxOculusRiftFrameTiming.cpp
+//  OculusRiftRendering
+//
+//
+//
+
+#include "ofxOculusRiftFrameTiming.h"
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+ofxOculusRiftFrameTiming::ofxOculusRiftFrameTiming()
+{
+	enabled = true;
+	
+	useGpuQueries = true;
+	gpuQueriesReady = false;
+	gpuFrame = 0;
+	
+	for( int i = 0; i < NumGpuFramesInFlight; i++ )
+	{
+		gpuQuerySerial[i] = 0;
+		for( int j = 0; j < OFX_OCULUSRIFT_NUM_STAGES * 2; j++ )
+		{
+			gpuQueries[i][j] = 0;
+			gpuQueryIssued[i][j] = false;
+		}
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+ofxOculusRiftFrameTiming::~ofxOculusRiftFrameTiming()
+{
+	clearGpuQueries();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftFrameTiming::setEnabled( bool _enabled )
+{
+	enabled = _enabled;
+	
+	if( !enabled )
+	{
+		recorder.discardFrame();
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+bool ofxOculusRiftFrameTiming::getEnabled()
+{
+	return enabled;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftFrameTiming::setUseGpuQueries( bool _useGpuQueries )
+{
+	useGpuQueries = _useGpuQueries;
+	
+	if( !useGpuQueries )
+	{
+		clearGpuQueries();
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+bool ofxOculusRiftFrameTiming::getUseGpuQueries()
+{
+	return useGpuQueries;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftFrameTiming::beginStage( ofxOculusRiftFrameStage _stage )
+{
+	if( !enabled )
+	{
+		return;
+	}
+	
+	if( recorder.getFrameNum() != ofGetFrameNum() )
+	{
+		startFrame( ofGetFrameNum() );
+	}
+	
+	recorder.beginStage( _stage );
+	
+	if( gpuQueriesReady && _stage != OFX_OCULUSRIFT_STAGE_SWAP )
+	{
+		glQueryCounter( gpuQueries[gpuFrame][_stage * 2], GL_TIMESTAMP );
+		gpuQueryIssued[gpuFrame][_stage * 2] = true;
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftFrameTiming::endStage( ofxOculusRiftFrameStage _stage )
+{
+	if( !enabled || !recorder.isRecording() )
+	{
+		return;
+	}
+	
+	recorder.endStage( _stage );
+	
+	if( gpuQueriesReady && _stage != OFX_OCULUSRIFT_STAGE_SWAP )
+	{
+		glQueryCounter( gpuQueries[gpuFrame][_stage * 2 + 1], GL_TIMESTAMP );
+		gpuQueryIssued[gpuFrame][_stage * 2 + 1] = true;
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftFrameTiming::startFrame( int _frameNum )
+{
+	recorder.startFrame( _frameNum );
+	
+	if( useGpuQueries && !gpuQueriesReady )
+	{
+		initGpuQueries();
+	}
+	
+	if( gpuQueriesReady )
+	{
+		gpuFrame = (gpuFrame + 1) % NumGpuFramesInFlight;
+		collectGpuQueries( gpuFrame ); // issued NumGpuFramesInFlight frames ago, so they should be back by now
+	}
+	
+	gpuQuerySerial[gpuFrame] = recorder.getSerial();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftFrameTiming::collectGpuQueries( int _gpuFrame )
+{
+	bool anyIssued = false;
+	bool allAvailable = true;
+	
+	for( int i = 0; i < OFX_OCULUSRIFT_NUM_STAGES * 2; i++ )
+	{
+		if( gpuQueryIssued[_gpuFrame][i] )
+		{
+			anyIssued = true;
+			
+			GLint available = 0;
+			glGetQueryObjectiv( gpuQueries[_gpuFrame][i], GL_QUERY_RESULT_AVAILABLE, &available );
+			if( !available ) { allAvailable = false; }
+		}
+	}
+	
+	ofxOculusRiftFrameRecord record;
+	
+	// never wait on the GPU, if it is that far behind we lose the frame's GPU times
+	if( anyIssued && allAvailable && recorder.read( gpuQuerySerial[_gpuFrame], record ) )
+	{
+		GLuint64 timestamps[OFX_OCULUSRIFT_NUM_STAGES * 2];
+		GLuint64 frameStart = 0;
+		
+		for( int i = 0; i < OFX_OCULUSRIFT_NUM_STAGES * 2; i++ )
+		{
+			timestamps[i] = 0;
+			if( gpuQueryIssued[_gpuFrame][i] )
+			{
+				glGetQueryObjectui64v( gpuQueries[_gpuFrame][i], GL_QUERY_RESULT, &timestamps[i] );
+				if( frameStart == 0 || timestamps[i] < frameStart ) { frameStart = timestamps[i]; }
+			}
+		}
+		
+		for( int stage = 0; stage < OFX_OCULUSRIFT_NUM_STAGES; stage++ )
+		{
+			if( gpuQueryIssued[_gpuFrame][stage * 2] && gpuQueryIssued[_gpuFrame][stage * 2 + 1] )
+			{
+				record.gpuBegin[stage]	= (timestamps[stage * 2] - frameStart) / 1000.0;
+				record.gpuEnd[stage]	= (timestamps[stage * 2 + 1] - frameStart) / 1000.0;
+			}
+		}
+		
+		recorder.rewrite( record );
+	}
+	
+	for( int i = 0; i < OFX_OCULUSRIFT_NUM_STAGES * 2; i++ )
+	{
+		gpuQueryIssued[_gpuFrame][i] = false;
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+int ofxOculusRiftFrameTiming::getRecords( vector<ofxOculusRiftFrameRecord>& _records )
+{
+	return recorder.getRecords( _records );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+bool ofxOculusRiftFrameTiming::saveCsv( string _path )
+{
+	ofstream file( ofToDataPath( _path ).c_str() );
+	if( !file.is_open() )
+	{
+		ofLogError() << "ofxOculusRiftFrameTiming: could not write " << _path;
+		return false;
+	}
+	
+	vector<ofxOculusRiftFrameRecord> records;
+	getRecords( records );
+	
+	file << "frame,stage,cpu_begin_us,cpu_end_us,cpu_ms,gpu_begin_us,gpu_end_us,gpu_ms" << endl;
+	
+	for( unsigned int i = 0; i < records.size(); i++ )
+	{
+		const ofxOculusRiftFrameRecord& record = records[i];
+		for( int stage = 0; stage < OFX_OCULUSRIFT_NUM_STAGES; stage++ )
+		{
+			if( !record.hasStage( stage ) )
+			{
+				continue;
+			}
+			
+			file << record.frameNum << "," << getStageName( stage ) << ","
+				 << record.cpuBegin[stage] << "," << record.cpuEnd[stage] << ","
+				 << (record.cpuEnd[stage] - record.cpuBegin[stage]) / 1000.0 << ",";
+			
+			if( record.hasGpuStage( stage ) )
+			{
+				file << record.gpuBegin[stage] << "," << record.gpuEnd[stage] << "," << (record.gpuEnd[stage] - record.gpuBegin[stage]) / 1000.0 << endl;
+			}
+			else
+			{
+				file << ",," << endl;
+			}
+		}
+	}
+	
+	return true;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+bool ofxOculusRiftFrameTiming::saveChromeTrace( string _path )
+{
+	ofstream file( ofToDataPath( _path ).c_str() );
+	if( !file.is_open() )
+	{
+		ofLogError() << "ofxOculusRiftFrameTiming: could not write " << _path;
+		return false;
+	}
+	
+	vector<ofxOculusRiftFrameRecord> records;
+	getRecords( records );
+	
+	// load in chrome://tracing, the GPU track is lined up with the start of the CPU work of each frame
+	file << "{\"traceEvents\":[" << endl;
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}}," << endl;
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+	
+	for( unsigned int i = 0; i < records.size(); i++ )
+	{
+		const ofxOculusRiftFrameRecord& record = records[i];
+		
+		UInt64 frameStart = 0;
+		for( int stage = 0; stage < OFX_OCULUSRIFT_NUM_STAGES; stage++ )
+		{
+			if( record.hasStage( stage ) && (frameStart == 0 || record.cpuBegin[stage] < frameStart) ) { frameStart = record.cpuBegin[stage]; }
+		}
+		
+		for( int stage = 0; stage < OFX_OCULUSRIFT_NUM_STAGES; stage++ )
+		{
+			if( record.hasStage( stage ) )
+			{
+				file << "," << endl << "{\"name\":\"" << getStageName( stage ) << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":1"
+					 << ",\"ts\":" << record.cpuBegin[stage] << ",\"dur\":" << (record.cpuEnd[stage] - record.cpuBegin[stage])
+					 << ",\"args\":{\"frame\":" << record.frameNum << "}}";
+			}
+			
+			if( record.hasGpuStage( stage ) )
+			{
+				file << "," << endl << "{\"name\":\"" << getStageName( stage ) << "\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":1,\"tid\":2"
+					 << ",\"ts\":" << (frameStart + record.gpuBegin[stage]) << ",\"dur\":" << (record.gpuEnd[stage] - record.gpuBegin[stage])
+					 << ",\"args\":{\"frame\":" << record.frameNum << "}}";
+			}
+		}
+	}
+	
+	file << endl << "]}" << endl;
+	
+	return true;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+const char* ofxOculusRiftFrameTiming::getStageName( int _stage )
+{
+	return ofxOculusRiftFrameRecorder::getStageName( _stage );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftFrameTiming::initGpuQueries()
+{
+	if( !ofCheckGLExtension( "GL_ARB_timer_query" ) )
+	{
+		ofLogVerbose() << "ofxOculusRiftFrameTiming: no GL_ARB_timer_query, only timing the CPU side";
+		useGpuQueries = false;
+		return;
+	}
+	
+	for( int i = 0; i < NumGpuFramesInFlight; i++ )
+	{
+		glGenQueries( OFX_OCULUSRIFT_NUM_STAGES * 2, gpuQueries[i] );
+		for( int j = 0; j < OFX_OCULUSRIFT_NUM_STAGES * 2; j++ )
+		{
+			gpuQueryIssued[i][j] = false;
+		}
+	}
+	
+	gpuQueriesReady = true;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftFrameTiming::clearGpuQueries()
+{
+	if( !gpuQueriesReady )
+	{
+		return;
+	}
+	
+	for( int i = 0; i < NumGpuFramesInFlight; i++ )
+	{
+		glDeleteQueries( OFX_OCULUSRIFT_NUM_STAGES * 2, gpuQueries[i] );
+	}
+	
+	gpuQueriesReady = false;
+}
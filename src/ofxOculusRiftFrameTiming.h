@@ -0,0 +1,62 @@
+//
+//  ofxOculusRiftFrameTiming.h
+//  OculusRiftRendering
+//
+//
+//
+
+#pragma once
+
+#include "ofMain.h"
+
+#include "ofxOculusRiftFrameRecorder.h"
+
+// Timestamps the stages of each frame into a fixed ring of records, see ofxOculusRiftFrameRecorder. Only the
+// GL thread writes, anyone can read at any time. Recording a stage is a profile tick read and, if
+// GL_ARB_timer_query is there, a glQueryCounter.
+class ofxOculusRiftFrameTiming
+{
+	public:
+	
+		ofxOculusRiftFrameTiming();
+		~ofxOculusRiftFrameTiming();
+	
+		void				setEnabled( bool _enabled );
+		bool				getEnabled();
+	
+		void				setUseGpuQueries( bool _useGpuQueries );	// on by default where supported
+		bool				getUseGpuQueries();
+	
+		// GL thread only
+		void				beginStage( ofxOculusRiftFrameStage _stage );
+		void				endStage( ofxOculusRiftFrameStage _stage );
+	
+		// Any thread. Fills in the recorded frames, oldest first, and returns how many there are.
+		int					getRecords( vector<ofxOculusRiftFrameRecord>& _records );
+	
+		bool				saveCsv( string _path );
+		bool				saveChromeTrace( string _path );
+	
+		static const char*	getStageName( int _stage );
+	
+		enum { NumRecords = ofxOculusRiftFrameRecorder::NumRecords, NumGpuFramesInFlight = 4 };
+	
+	private:
+	
+		void				startFrame( int _frameNum );
+		void				collectGpuQueries( int _gpuFrame );
+	
+		void				initGpuQueries();
+		void				clearGpuQueries();
+	
+		bool				enabled;
+	
+		ofxOculusRiftFrameRecorder recorder;
+	
+		bool				useGpuQueries;
+		bool				gpuQueriesReady;
+		GLuint				gpuQueries[NumGpuFramesInFlight][OFX_OCULUSRIFT_NUM_STAGES * 2];
+		bool				gpuQueryIssued[NumGpuFramesInFlight][OFX_OCULUSRIFT_NUM_STAGES * 2];
+		UInt32				gpuQuerySerial[NumGpuFramesInFlight];
+		int					gpuFrame;
+};
@@ -0,0 +1,199 @@
+//
+//  ofxOculusRiftMultiRes.cpp
+//  OculusRiftRendering
+//
+//
+//
+
+#include "ofxOculusRiftMultiRes.h"
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+ofxOculusRiftMultiResLayout::ofxOculusRiftMultiResLayout()
+{
+	packedWidth = 0;
+	packedHeight = 0;
+	centreRadius = 0.0f;
+	borderResolution = 1.0f;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftMultiResLayout::setup( const Util::Render::DistortionConfig& _distortion, float _scale, float _aspect, bool _isLeftEye,
+										 int _eyeWidth, int _eyeHeight, float _borderResolution )
+{
+	borderResolution = Alg::Clamp( _borderResolution, 0.05f, 1.0f );
+	
+	// HmdWarp.frag goes from eye clip space (x,y) to distortion space (x,y/aspect) around the lens centre,
+	// distorts, and goes back with the distorted radius divided by the scale
+	float lensX = _isLeftEye ? _distortion.XCenterOffset : -_distortion.XCenterOffset;
+	float maxRadius = sqrtf( (1.0f + fabs( lensX )) * (1.0f + fabs( lensX )) + 1.0f / (_aspect * _aspect) );
+	
+	centreRadius = findCentreRadius( _distortion, borderResolution, maxRadius );
+	float sourceRadius = _distortion.DistortionFn( centreRadius ) / _scale;
+	
+	// the lens centre is off to the side, so the left and right border aren't the same width
+	float splitX[4] = { -1.0f, Alg::Clamp( lensX - sourceRadius, -1.0f, 1.0f ), Alg::Clamp( lensX + sourceRadius, -1.0f, 1.0f ), 1.0f };
+	float splitY[4] = { -1.0f, Alg::Clamp( -sourceRadius * _aspect, -1.0f, 1.0f ), Alg::Clamp( sourceRadius * _aspect, -1.0f, 1.0f ), 1.0f };
+	
+	int columnStart[4];
+	int rowStart[4];
+	columnStart[0] = 0;
+	rowStart[0] = 0;
+	
+	for( int i = 0; i < 3; i++ )
+	{
+		float resolution = (i == 1) ? 1.0f : borderResolution;
+		columnStart[i+1] = columnStart[i] + (int)((splitX[i+1] - splitX[i]) * 0.5f * _eyeWidth  * resolution + 0.5f);
+		rowStart[i+1]	 = rowStart[i]	  + (int)((splitY[i+1] - splitY[i]) * 0.5f * _eyeHeight * resolution + 0.5f);
+	}
+	
+	packedWidth	 = columnStart[3];
+	packedHeight = rowStart[3];
+	
+	// regions that come out empty are left out, when the border isn't needed at all there is just the centre
+	regions.clear();
+	for( int row = 0; row < 3; row++ )
+	{
+		for( int column = 0; column < 3; column++ )
+		{
+			ofxOculusRiftMultiResRegion region;
+			region.ndc.x		= splitX[column];
+			region.ndc.y		= splitY[row];
+			region.ndc.width	= splitX[column+1] - splitX[column];
+			region.ndc.height	= splitY[row+1] - splitY[row];
+			region.viewport		= Util::Render::Viewport( columnStart[column], rowStart[row], columnStart[column+1] - columnStart[column], rowStart[row+1] - rowStart[row] );
+			region.isCentre		= (row == 1 && column == 1);
+			
+			if( region.viewport.w > 0 && region.viewport.h > 0 )
+			{
+				regions.push_back( region );
+			}
+		}
+	}
+	
+	eyeSplit.x0		= (splitX[1] + 1.0f) * 0.5f;
+	eyeSplit.x1		= (splitX[2] + 1.0f) * 0.5f;
+	eyeSplit.y0		= (splitY[1] + 1.0f) * 0.5f;
+	eyeSplit.y1		= (splitY[2] + 1.0f) * 0.5f;
+	
+	packedSplit.x0	= columnStart[1] / (float)packedWidth;
+	packedSplit.x1	= columnStart[2] / (float)packedWidth;
+	packedSplit.y0	= rowStart[1] / (float)packedHeight;
+	packedSplit.y1	= rowStart[2] / (float)packedHeight;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+int ofxOculusRiftMultiResLayout::getNumRegions() const
+{
+	return regions.size();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+const ofxOculusRiftMultiResRegion& ofxOculusRiftMultiResLayout::getRegion( int _index ) const
+{
+	return regions.at( _index );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+int ofxOculusRiftMultiResLayout::getPackedWidth() const
+{
+	return packedWidth;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+int ofxOculusRiftMultiResLayout::getPackedHeight() const
+{
+	return packedHeight;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+ofxOculusRiftMultiResSplit ofxOculusRiftMultiResLayout::getEyeSplit() const
+{
+	return eyeSplit;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+ofxOculusRiftMultiResSplit ofxOculusRiftMultiResLayout::getPackedSplit() const
+{
+	return packedSplit;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+Vector2f ofxOculusRiftMultiResLayout::getPackedTexCoord( Vector2f _eyeTexCoord ) const
+{
+	return Vector2f( remapAxis( _eyeTexCoord.x, eyeSplit.x0, eyeSplit.x1, packedSplit.x0, packedSplit.x1 ),
+					 remapAxis( _eyeTexCoord.y, eyeSplit.y0, eyeSplit.y1, packedSplit.y0, packedSplit.y1 ) );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+float ofxOculusRiftMultiResLayout::getCentreRadius() const
+{
+	return centreRadius;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+float ofxOculusRiftMultiResLayout::getBorderResolution() const
+{
+	return borderResolution;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+float ofxOculusRiftMultiResLayout::getRequiredResolution( const Util::Render::DistortionConfig& _distortion, float _radius )
+{
+	// A display pixel at radius r reads the eye image at DistortionFn(r), so the eye image moves DistortionFn'(r)
+	// for every step on the display. Relative to the middle that is K0 / DistortionFn'(r).
+	const float* K = _distortion.K;
+	float rSq = _radius * _radius;
+	float derivative = K[0] + rSq * (3.0f * K[1] + rSq * (5.0f * K[2] + rSq * 7.0f * K[3]));
+	
+	return K[0] / derivative;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+float ofxOculusRiftMultiResLayout::findCentreRadius( const Util::Render::DistortionConfig& _distortion, float _borderResolution, float _maxRadius )
+{
+	if( getRequiredResolution( _distortion, _maxRadius ) > _borderResolution )
+	{
+		return _maxRadius; // the border would never be enough
+	}
+	
+	// the required resolution only goes down from the middle, as long as the coefficients are positive
+	float low = 0.0f;
+	float high = _maxRadius;
+	for( int i = 0; i < 32; i++ )
+	{
+		float middle = (low + high) * 0.5f;
+		if( getRequiredResolution( _distortion, middle ) > _borderResolution )	{ low = middle; }
+		else																	{ high = middle; }
+	}
+	
+	return high;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+float ofxOculusRiftMultiResLayout::remapAxis( float _t, float _split0, float _split1, float _packed0, float _packed1 )
+{
+	if( _t < _split0 )
+	{
+		return (_split0 > 0.0f) ? _t / _split0 * _packed0 : _packed0;
+	}
+	else if( _t > _split1 )
+	{
+		return (_split1 < 1.0f) ? _packed1 + (_t - _split1) / (1.0f - _split1) * (1.0f - _packed1) : _packed1;
+	}
+	
+	return _packed0 + (_t - _split0) / (_split1 - _split0) * (_packed1 - _packed0);
+}
@@ -0,0 +1,88 @@
+//
+//  ofxOculusRiftMultiRes.h
+//  OculusRiftRendering
+//
+//
+//
+
+#pragma once
+
+#include <vector>
+
+#include "OVR.h"
+using namespace OVR;
+
+// A rectangle in the eye's clip space, x,y is the lower left corner
+struct ofxOculusRiftMultiResRect
+{
+	float				x, y, width, height;
+};
+
+// Where the centre starts and ends along both axes, in texture coordinates
+struct ofxOculusRiftMultiResSplit
+{
+	float				x0, x1, y0, y1;
+};
+
+// One part of an eye in the multi-resolution layout
+class ofxOculusRiftMultiResRegion
+{
+	public:
+	
+		ofxOculusRiftMultiResRect	ndc;		// the part of the eye's clip space it covers
+		Util::Render::Viewport		viewport;	// where it is rendered in the packed texture, in pixels
+		bool						isCentre;
+};
+
+// Splits an eye in a 3x3 grid, the centre at full resolution and the border at a lower one. The barrel warp
+// squeezes the edges of the image, so past a certain radius it only needs every other pixel or so. The split is
+// worked out from the distortion function, the centre reaches as far as the warp still needs more than
+// _borderResolution of the full resolution. No GL or openFrameworks in here, the layout is just numbers on OVR
+// types, so it can be checked against DistortionFn on its own (tests/MultiResLayoutTest.cpp).
+class ofxOculusRiftMultiResLayout
+{
+	public:
+	
+		ofxOculusRiftMultiResLayout();
+		
+		// _scale is what the source radius is divided by after the distortion, DistortionConfig::Scale over the shader
+		// scale factor. _aspect is the one the warp uses to go from texture coordinates to distortion space.
+		void				setup( const Util::Render::DistortionConfig& _distortion, float _scale, float _aspect, bool _isLeftEye,
+								   int _eyeWidth, int _eyeHeight, float _borderResolution );
+		
+		int					getNumRegions() const;
+		const ofxOculusRiftMultiResRegion& getRegion( int _index ) const;
+		
+		int					getPackedWidth() const;
+		int					getPackedHeight() const;
+		
+		// Where the centre starts and ends (x0, x1, y0, y1), in texture coordinates of the full eye and of the packed
+		// texture. That is all the warp shader needs to find its way.
+		ofxOculusRiftMultiResSplit getEyeSplit() const;
+		ofxOculusRiftMultiResSplit getPackedSplit() const;
+		
+		// The same mapping as the warp shader does
+		Vector2f			getPackedTexCoord( Vector2f _eyeTexCoord ) const;
+		
+		float				getCentreRadius() const;	// in distortion space, before the warp
+		float				getBorderResolution() const;
+		
+		// How much of the full resolution the warp needs at a radius in distortion space, 1 in the middle
+		static float		getRequiredResolution( const Util::Render::DistortionConfig& _distortion, float _radius );
+	
+	private:
+	
+		static float		findCentreRadius( const Util::Render::DistortionConfig& _distortion, float _borderResolution, float _maxRadius );
+		static float		remapAxis( float _t, float _split0, float _split1, float _packed0, float _packed1 );
+		
+		std::vector<ofxOculusRiftMultiResRegion> regions;
+		
+		int					packedWidth;
+		int					packedHeight;
+		
+		ofxOculusRiftMultiResSplit eyeSplit;
+		ofxOculusRiftMultiResSplit packedSplit;
+		
+		float				centreRadius;
+		float				borderResolution;
+};
@@ -0,0 +1,168 @@
+//
+//  ofxOculusRiftOverlay.cpp
+//  OculusRiftRendering
+//
+//
+//
+
+#include "ofxOculusRiftOverlay.h"
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+ofxOculusRiftOverlay::ofxOculusRiftOverlay()
+{
+	size.set( 40.0f, 20.0f );
+	headLocked = true;
+	alpha = 1.0f;
+	enabled = true;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftOverlay::allocate( int _width, int _height, int _numSamples )
+{
+	ofDisableArbTex();
+	
+		ofFbo::Settings tmpSettings = ofFbo::Settings();
+		tmpSettings.width			= _width;
+		tmpSettings.height			= _height;
+		tmpSettings.internalformat	= GL_RGBA;
+		tmpSettings.textureTarget	= GL_TEXTURE_2D;
+		tmpSettings.numSamples		= _numSamples;
+		
+		fbo.allocate( tmpSettings );
+	
+	ofEnableArbTex();
+	
+	fbo.begin();
+		ofClear( 0, 0, 0, 0 );
+	fbo.end();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftOverlay::begin()
+{
+	fbo.begin();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftOverlay::end()
+{
+	fbo.end();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftOverlay::setSize( float _width, float _height )
+{
+	size.set( _width, _height );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+ofVec2f ofxOculusRiftOverlay::getSize()
+{
+	return size;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftOverlay::setHeadLocked( bool _headLocked )
+{
+	headLocked = _headLocked;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+bool ofxOculusRiftOverlay::getHeadLocked()
+{
+	return headLocked;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftOverlay::setAlpha( float _alpha )
+{
+	alpha = _alpha;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+float ofxOculusRiftOverlay::getAlpha()
+{
+	return alpha;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftOverlay::setEnabled( bool _enabled )
+{
+	enabled = _enabled;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+bool ofxOculusRiftOverlay::getEnabled()
+{
+	return enabled && fbo.isAllocated();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+ofTexture& ofxOculusRiftOverlay::getTextureReference()
+{
+	return fbo.getTextureReference();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+void ofxOculusRiftOverlay::getEyeMapping( const ofMatrix4x4& _viewProjection, float* _mat3 )
+{
+	// The quad is a plane, so clip space x, y and w are linear in its texture coordinates (u, v, 1),
+	// the matrix doing that is built from three corners and its inverse takes us back from the eye.
+	// The FBO texture is stored bottom up, so v = 0 is the bottom edge of the quad.
+	ofMatrix4x4 modelViewProjection = getGlobalTransformMatrix() * _viewProjection;
+	
+	ofVec4f c00 = ofVec4f( -size.x * 0.5f, -size.y * 0.5f, 0.0f, 1.0f ) * modelViewProjection;
+	ofVec4f c10 = ofVec4f(  size.x * 0.5f, -size.y * 0.5f, 0.0f, 1.0f ) * modelViewProjection;
+	ofVec4f c01 = ofVec4f( -size.x * 0.5f,  size.y * 0.5f, 0.0f, 1.0f ) * modelViewProjection;
+	
+	// rows x, y, w, columns u, v, 1
+	float a[3][3] = {	{ c10.x - c00.x, c01.x - c00.x, c00.x },
+						{ c10.y - c00.y, c01.y - c00.y, c00.y },
+						{ c10.w - c00.w, c01.w - c00.w, c00.w } };
+	
+	float det =	  a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1])
+				- a[0][1] * (a[1][0] * a[2][2] - a[1][2] * a[2][0])
+				+ a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0]);
+	
+	if( fabsf( det ) < 1e-12f )
+	{
+		// seen exactly edge on, map everything behind the eye so nothing gets drawn
+		for( int i = 0; i < 9; i++ ) { _mat3[i] = 0.0f; }
+		_mat3[8] = -1.0f;
+		return;
+	}
+	
+	float invDet = 1.0f / det;
+	float inv[3][3];
+	inv[0][0] =  (a[1][1] * a[2][2] - a[1][2] * a[2][1]) * invDet;
+	inv[0][1] = -(a[0][1] * a[2][2] - a[0][2] * a[2][1]) * invDet;
+	inv[0][2] =  (a[0][1] * a[1][2] - a[0][2] * a[1][1]) * invDet;
+	inv[1][0] = -(a[1][0] * a[2][2] - a[1][2] * a[2][0]) * invDet;
+	inv[1][1] =  (a[0][0] * a[2][2] - a[0][2] * a[2][0]) * invDet;
+	inv[1][2] = -(a[0][0] * a[1][2] - a[0][2] * a[1][0]) * invDet;
+	inv[2][0] =  (a[1][0] * a[2][1] - a[1][1] * a[2][0]) * invDet;
+	inv[2][1] = -(a[0][0] * a[2][1] - a[0][1] * a[2][0]) * invDet;
+	inv[2][2] =  (a[0][0] * a[1][1] - a[0][1] * a[1][0]) * invDet;
+	
+	for( int col = 0; col < 3; col++ )
+	{
+		for( int row = 0; row < 3; row++ )
+		{
+			_mat3[col * 3 + row] = inv[row][col];
+		}
+	}
+}
@@ -0,0 +1,52 @@
+//
+//  ofxOculusRiftOverlay.h
+//  OculusRiftRendering
+//
+//
+//
+
+#pragma once
+
+#include "ofMain.h"
+
+// A flat layer of UI, drawn into its own FBO once (or whenever it changes) and then looked up directly
+// by the distortion pass instead of being drawn into both eye scenes. Place it like any ofNode, in world
+// space, or in head space (-z in front, y up) if it is head locked. Only shows up when warping is on.
+class ofxOculusRiftOverlay : public ofNode
+{
+	public:
+	
+		ofxOculusRiftOverlay();
+	
+		void				allocate( int _width, int _height, int _numSamples = 0 );
+	
+		// Draw the UI in between these, in pixels with the usual top left origin
+		void				begin();
+		void				end();
+	
+		void				setSize( float _width, float _height );	// in world units
+		ofVec2f				getSize();
+	
+		void				setHeadLocked( bool _headLocked );
+		bool				getHeadLocked();
+	
+		void				setAlpha( float _alpha );
+		float				getAlpha();
+	
+		void				setEnabled( bool _enabled );
+		bool				getEnabled();
+	
+		ofTexture&			getTextureReference();
+	
+		// Maps the eye's normalized device coordinates to texture coordinates on the overlay, the third
+		// component being positive means the point is in front of the eye. Column major, ready for glUniformMatrix3fv.
+		void				getEyeMapping( const ofMatrix4x4& _viewProjection, float* _mat3 );
+	
+	private:
+	
+		ofFbo				fbo;
+		ofVec2f				size;
+		bool				headLocked;
+		float				alpha;
+		bool				enabled;
+};
@@ -0,0 +1,112 @@
+//
+//  FrameConversionBench.cpp
+//  ofxOculusRift tests
+//
+//  What a tracker report costs from the HID read to the handler, played through ReplayDeviceManager to one sensor
+//  without a dispatch thread: once from a sensor that reports in sensor coordinates, and once from one that
+//  reports in HMD coordinates, which SensorDevice converts on the way. Includes encoding the report, which is the
+//  same for both. Timed alone on decoded reports, the conversion is about 15 ns of a report in either frame, so
+//  the two should only differ by noise.
+//
+
+#include "TestCommon.h"
+#include "TestCapture.h"
+
+#include "Util/Util_ReplayDevice.h"
+
+static const int	NumSamples		= 1000;
+static const int	NumPasses		= 200;
+static const int	NumRuns			= 5;
+
+// Only counts, so that the handler costs next to nothing
+class FrameCounter : public MessageHandler
+{
+	public:
+	
+		FrameCounter() { numFrames = 0; }
+		
+		virtual void OnMessage( const Message& _msg )
+		{
+			if( _msg.Type == Message_BodyFrame )
+			{
+				numFrames++;
+			}
+		}
+		
+		// only the manager thread writes, read once it stopped playing
+		UInt32 numFrames;
+};
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+// The best of a few runs, the others are the machine doing something else
+static void bench( const Util::SensorReplay& _replay, bool _sensorCoordinates, const char* _name )
+{
+	Ptr<Util::ReplayDeviceManager> manager = *Util::ReplayDeviceManager::Create( _replay, 1, _sensorCoordinates );
+	Ptr<SensorDevice> sensor;
+	if( manager )
+	{
+		sensor = *manager->EnumerateDevices<SensorDevice>().CreateDevice();
+	}
+	if( !sensor )
+	{
+		printf( "  %s: can't create the sensor\n", _name );
+		return;
+	}
+	
+	FrameCounter counter;
+	sensor->SetMessageHandler( &counter );
+	
+	double best = 1e9;
+	for( int run = 0; run < NumRuns; run++ )
+	{
+		if( !manager->Play( 0.0f, NumPasses ) )
+		{
+			break;
+		}
+		while( manager->IsPlaying() )
+		{
+			Thread::MSleep( 1 );
+		}
+		
+		// the manager thread is done with the last report once it says it stopped
+		double seconds = Timer::TicksToSeconds( Timer::GetTicks() - manager->GetPlayStartTicks() );
+		best = Alg::Min( best, seconds * 1e9 / manager->GetNumReportsPlayed() );
+	}
+	
+	sensor->SetMessageHandler( NULL );
+	printf( "  %-28s %6.1f ns per report, %u frames\n", _name, best, counter.numFrames );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+int main()
+{
+	System::Init( Log::ConfigureDefaultLog( LogMask_None ) );
+	{
+		String capturePath = GetTestCapturePath( "FrameConversionBench" );
+		
+		Array<Util::SensorCaptureSample> samples;
+		for( int i = 0; i < NumSamples; i++ )
+		{
+			float t = i * 0.001f;
+			samples.PushBack( MakeTestSample( Vector3f( 0.3f * t, 1.0f - t, 0.2f ), Vector3f( 0.1f, 9.81f - t, 0.4f * t ), Vector3f( 0.3f, 0.1f * t, 0.2f ), 0.001f ) );
+		}
+		
+		Util::SensorReplay replay;
+		if( WriteTestCapture( capturePath.ToCStr(), samples ) && replay.Open( capturePath.ToCStr() ) )
+		{
+			printf( "FrameConversionBench\n" );
+			bench( replay, true, "sensor frame, no conversion" );
+			bench( replay, false, "HMD frame, converted" );
+		}
+		else
+		{
+			printf( "FrameConversionBench: can't write or open %s\n", capturePath.ToCStr() );
+		}
+		
+		unlink( capturePath.ToCStr() );
+	}
+	System::Destroy();
+	
+	return 0;
+}
@@ -0,0 +1,70 @@
+//
+//  FrameRecorderBench.cpp
+//  ofxOculusRift tests
+//
+//  What ofxOculusRiftFrameTiming adds to a frame on the CPU: a stage's begin and end, which has to stay under a
+//  microsecond, and the start of a frame, which publishes the one before into the ring.
+//
+
+#include "TestCommon.h"
+
+#include "ofxOculusRiftFrameRecorder.h"
+
+static const int	NumFrames		= 200000;
+static const int	NumRuns			= 7;
+
+// Where the results go, so that the work isn't optimized away
+static volatile UInt64 Sink = 0;
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+// The best of a few runs, the others are the machine doing something else. A frame is a start and the five
+// stages ofxOculusRift records between draws.
+static void bench( ofxOculusRiftFrameRecorder& _recorder, bool _stages, double& _best )
+{
+	_best = 1e9;
+	
+	for( int run = 0; run < NumRuns; run++ )
+	{
+		UInt64 start = Timer::GetTicks();
+		for( int i = 0; i < NumFrames; i++ )
+		{
+			_recorder.startFrame( i );
+			if( _stages )
+			{
+				for( int stage = OFX_OCULUSRIFT_STAGE_SCENE_LEFT; stage < OFX_OCULUSRIFT_NUM_STAGES; stage++ )
+				{
+					_recorder.beginStage( (ofxOculusRiftFrameStage)stage );
+					_recorder.endStage( (ofxOculusRiftFrameStage)stage );
+				}
+			}
+		}
+		_best = Alg::Min( _best, (Timer::GetTicks() - start) * 1000.0 / NumFrames );
+	}
+	Sink = _recorder.getNumPublished();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+int main()
+{
+	System::Init( Log::ConfigureDefaultLog( LogMask_None ) );
+	{
+		ofxOculusRiftFrameRecorder* recorder = new ofxOculusRiftFrameRecorder;
+		
+		double frameOnly, frameWithStages;
+		bench( *recorder, false, frameOnly );
+		bench( *recorder, true, frameWithStages );
+		
+		int numStages = OFX_OCULUSRIFT_NUM_STAGES - OFX_OCULUSRIFT_STAGE_SCENE_LEFT;
+		double stage = (frameWithStages - frameOnly) / numStages;
+		
+		printf( "FrameRecorderBench\n" );
+		printf( "  %-24s %6.1f ns\n", "startFrame", frameOnly );
+		printf( "  %-24s %6.1f ns per pair%s\n", "beginStage + endStage", stage, stage < 1000.0 ? "" : ", over the 1 us budget" );
+		
+		delete recorder;
+	}
+	System::Destroy();
+	
+	return 0;
+}
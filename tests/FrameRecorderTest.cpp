@@ -0,0 +1,172 @@
+//
+//  FrameRecorderTest.cpp
+//  ofxOculusRift tests
+//
+//  ofxOculusRiftFrameRecorder has to publish each frame when the next one starts, with its swap stage closed
+//  there, keep the last NumRecords frames, and never hand a reader a record that was half written: a writer
+//  thread rewrites one slot over and over while the reader reads it, every record the reader gets has to be one
+//  that was written whole.
+//
+
+#include "TestCommon.h"
+
+#include "ofxOculusRiftFrameRecorder.h"
+
+// Rewrites the record of serial 0 with every field following from one counter, so a torn copy shows
+class SlotWriter : public Thread
+{
+	public:
+	
+		SlotWriter( ofxOculusRiftFrameRecorder* _recorder ) : recorder( _recorder ), numWrites( 0 ) {}
+		
+		virtual int Run()
+		{
+			ofxOculusRiftFrameRecord record;
+			while( !GetExitFlag() )
+			{
+				fill( record, ++numWrites );
+				recorder->rewrite( record );
+			}
+			return 0;
+		}
+		
+		static void fill( ofxOculusRiftFrameRecord& _record, UInt32 _value )
+		{
+			_record.serial = 0;
+			_record.frameNum = _value;
+			for( int stage = 0; stage < OFX_OCULUSRIFT_NUM_STAGES; stage++ )
+			{
+				_record.cpuBegin[stage] = _value + stage;
+				_record.cpuEnd[stage] = _value + stage + 100;
+				_record.gpuBegin[stage] = (float)(_value & 0xffff);
+				_record.gpuEnd[stage] = (float)(_value & 0xffff) + 1.0f;
+			}
+		}
+		
+		ofxOculusRiftFrameRecorder* recorder;
+		UInt32				numWrites;
+};
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+static bool isWhole( const ofxOculusRiftFrameRecord& _record )
+{
+	ofxOculusRiftFrameRecord expected;
+	SlotWriter::fill( expected, _record.frameNum );
+	
+	for( int stage = 0; stage < OFX_OCULUSRIFT_NUM_STAGES; stage++ )
+	{
+		if( _record.cpuBegin[stage] != expected.cpuBegin[stage] || _record.cpuEnd[stage] != expected.cpuEnd[stage] ||
+			_record.gpuBegin[stage] != expected.gpuBegin[stage] || _record.gpuEnd[stage] != expected.gpuEnd[stage] )
+		{
+			return false;
+		}
+	}
+	return _record.serial == 0;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+static void testFrames()
+{
+	ofxOculusRiftFrameRecorder* recorder = new ofxOculusRiftFrameRecorder;
+	std::vector<ofxOculusRiftFrameRecord> records;
+	
+	// nothing is recorded outside a frame
+	recorder->beginStage( OFX_OCULUSRIFT_STAGE_WARP );
+	TestCheck( !recorder->isRecording() && recorder->getRecords( records ) == 0, "frames: recorded a stage before the first frame" );
+	
+	for( int frame = 10; frame < 13; frame++ )
+	{
+		recorder->startFrame( frame );
+		recorder->beginStage( OFX_OCULUSRIFT_STAGE_SCENE_LEFT );
+		recorder->endStage( OFX_OCULUSRIFT_STAGE_SCENE_LEFT );
+		recorder->beginStage( OFX_OCULUSRIFT_STAGE_SWAP );
+	}
+	
+	// the frame still being recorded isn't published
+	TestCheck( recorder->getRecords( records ) == 2, "frames: %d records published after 3 frames", (int)records.size() );
+	for( unsigned i = 0; i < records.size(); i++ )
+	{
+		TestCheck( records[i].serial == i && records[i].frameNum == 10 + (int)i, "frames: record %u is serial %u of frame %d", i, records[i].serial, records[i].frameNum );
+		TestCheck( records[i].hasStage( OFX_OCULUSRIFT_STAGE_SCENE_LEFT ) && !records[i].hasStage( OFX_OCULUSRIFT_STAGE_WARP ), "frames: record %u has the wrong stages", i );
+		TestCheck( records[i].hasStage( OFX_OCULUSRIFT_STAGE_SWAP ), "frames: record %u has its swap stage open", i );
+		TestCheck( !records[i].hasGpuStage( OFX_OCULUSRIFT_STAGE_SCENE_LEFT ), "frames: record %u has GPU times", i );
+	}
+	
+	// the ring keeps the last NumRecords frames
+	for( int frame = 13; frame < 13 + ofxOculusRiftFrameRecorder::NumRecords; frame++ )
+	{
+		recorder->startFrame( frame );
+	}
+	UInt32 published = recorder->getNumPublished();
+	TestCheck( recorder->getRecords( records ) == ofxOculusRiftFrameRecorder::NumRecords, "frames: %d records in a full ring", (int)records.size() );
+	TestCheck( !records.empty() && records.front().serial == published - ofxOculusRiftFrameRecorder::NumRecords, "frames: the oldest record isn't the oldest one kept" );
+	
+	ofxOculusRiftFrameRecord record;
+	TestCheck( !recorder->read( 0, record ), "frames: read a record the ring has moved past" );
+	
+	delete recorder;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+static void testTornReads()
+{
+	ofxOculusRiftFrameRecorder* recorder = new ofxOculusRiftFrameRecorder;
+	ofxOculusRiftFrameRecord record;
+	SlotWriter::fill( record, 0 );
+	recorder->rewrite( record );
+	
+	Ptr<SlotWriter> writer = *new SlotWriter( recorder );
+	if( !TestCheck( writer->Start(), "torn reads: can't start the writer" ) )
+	{
+		delete recorder;
+		return;
+	}
+	
+	int numReads = 0;
+	int numFailed = 0;
+	int numTorn = 0;
+	double start = Timer::TicksToSeconds( Timer::GetTicks() );
+	while( Timer::TicksToSeconds( Timer::GetTicks() ) - start < 0.5 )
+	{
+		if( !recorder->read( 0, record ) )
+		{
+			numFailed++;
+			continue;
+		}
+		
+		numReads++;
+		if( !isWhole( record ) )
+		{
+			numTorn++;
+		}
+	}
+	
+	writer->SetExitFlag( true );
+	while( !writer->IsFinished() )
+	{
+		Thread::MSleep( 1 );
+	}
+	
+	TestCheck( numTorn == 0, "torn reads: %d of %d records read were half written", numTorn, numReads );
+	TestCheck( numReads > 0, "torn reads: no read got through in %d tries", numFailed );
+	printf( "  %d reads, %d gave up, against %u writes\n", numReads, numFailed, writer->numWrites );
+	
+	delete recorder;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+int main()
+{
+	System::Init();
+	{
+		testFrames();
+		testTornReads();
+	}
+	System::Destroy();
+	
+	return TestResult( "FrameRecorderTest" );
+}
@@ -0,0 +1,175 @@
+//
+//  FrameSchedulerTest.cpp
+//  ofxOculusRift tests
+//
+//  Runs ofxOculusRiftFrameScheduler against a simulated clock and display: vsync at a fixed rate that the
+//  scheduler has to learn, a swap that returns a little after vsync, and render times drawn from a few
+//  distributions. Checks that it finds the period, that it keeps the missed vsyncs to about what the render
+//  cost percentile allows for, and that it actually reads the pose later than rendering straight away does.
+//
+
+#include "TestCommon.h"
+
+#include "ofxOculusRiftFrameScheduler.h"
+
+#include <math.h>
+
+// A clock that only moves when the simulation moves it, sleeping just jumps ahead
+class FakeClock : public ofxOculusRiftClock
+{
+	public:
+	
+		FakeClock() { now = 100.0; }
+		
+		double				getSeconds() { return now; }
+		void				sleepUntil( double _seconds ) { now = Alg::Max( now, _seconds ); }
+		
+		double				now;
+};
+
+// Deterministic so a failure can be reproduced
+class Random
+{
+	public:
+	
+		Random() { state = 12345; }
+		
+		float				next() { state = state * 1664525u + 1013904223u; return (state >> 8) / 16777216.0f; }
+		
+		UInt32				state;
+};
+
+enum RenderCostDistribution
+{
+	ConstantCost,		// always the same, the easy case
+	UniformCost,		// anywhere between two values
+	SpikyCost,			// mostly cheap, one frame in twenty much slower
+	TightCost			// close to the whole period
+};
+
+struct SimulationResult
+{
+	float				vsyncPeriod;
+	float				missedRatio;
+	float				meanLatency;		// from reading the pose to the vsync that shows it
+	float				predictedRenderCost;
+};
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+static float getRenderCost( RenderCostDistribution _distribution, Random& _random )
+{
+	switch( _distribution )
+	{
+		case ConstantCost:	return 0.005f;
+		case UniformCost:	return 0.003f + 0.005f * _random.next();
+		case SpikyCost:		return (_random.next() < 0.05f) ? 0.010f : 0.004f;
+		case TightCost:		return 0.0100f + 0.0005f * _random.next();
+	}
+	
+	return 0.0f;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+static SimulationResult simulate( RenderCostDistribution _distribution, bool _enabled, float _nominalRate, float _refreshRate, int _numFrames )
+{
+	FakeClock clock;
+	Random random;
+	
+	ofxOculusRiftFrameScheduler scheduler;
+	scheduler.setClock( &clock );
+	scheduler.setEnabled( _enabled );
+	scheduler.setRefreshRate( _nominalRate ); // panels don't run at exactly what they claim, it has to find the real rate
+	scheduler.setRenderCostPercentile( 0.9f );
+	scheduler.setSafetyMargin( 0.001f );
+	
+	double period = 1.0 / _refreshRate;
+	double firstVsync = clock.now;
+	
+	int warmup = 120;
+	int missed = 0;
+	double latencySum = 0.0;
+	
+	for( int frame = 0; frame < _numFrames; frame++ )
+	{
+		// the swap returned, a bit after the vsync and not always by the same amount
+		scheduler.frameStart();
+		
+		clock.now += 0.0005 * random.next(); // update() and friends
+		
+		scheduler.waitForRenderStart();
+		double poseTime = clock.now;
+		double target = scheduler.getNextVsync();
+		
+		clock.now += getRenderCost( _distribution, random );
+		scheduler.renderEnd();
+		
+		// the swap blocks until the next vsync after rendering is done
+		double vsync = firstVsync + period * ceil( (clock.now - firstVsync) / period );
+		
+		if( frame >= warmup )
+		{
+			// without the scheduler there is no target, a frame is missed when it runs over the period it started in
+			if( _enabled ? (vsync > target + period * 0.5) : (clock.now - poseTime > period) )
+			{
+				missed++;
+			}
+			latencySum += vsync - poseTime;
+		}
+		
+		clock.now = vsync + 0.0002 + 0.0003 * random.next();
+	}
+	
+	SimulationResult result;
+	result.vsyncPeriod = scheduler.getVsyncPeriod();
+	result.missedRatio = missed / (float)(_numFrames - warmup);
+	result.meanLatency = latencySum / (_numFrames - warmup);
+	result.predictedRenderCost = scheduler.getPredictedRenderCost();
+	return result;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+int main()
+{
+	const char* names[] = { "constant", "uniform", "spiky", "tight" };
+	float nominalRates[] = { 60.0f, 75.0f };
+	float refreshRates[] = { 59.7f, 75.4f };
+	
+	for( int r = 0; r < 2; r++ )
+	{
+		for( int d = ConstantCost; d <= TightCost; d++ )
+		{
+			RenderCostDistribution distribution = (RenderCostDistribution)d;
+			float period = 1.0f / refreshRates[r];
+			
+			SimulationResult scheduled = simulate( distribution, true,  nominalRates[r], refreshRates[r], 2000 );
+			SimulationResult immediate = simulate( distribution, false, nominalRates[r], refreshRates[r], 2000 );
+			
+			printf( "  %4.1f Hz %-9s period %.3f ms, predicted cost %.2f ms, missed %4.1f%%, latency %5.2f ms (%5.2f ms without)\n",
+					refreshRates[r], names[d], scheduled.vsyncPeriod * 1000.0f, scheduled.predictedRenderCost * 1000.0f,
+					scheduled.missedRatio * 100.0f, scheduled.meanLatency * 1000.0f, immediate.meanLatency * 1000.0f );
+			
+			TestCheck( fabs( scheduled.vsyncPeriod - period ) < period * 0.01f, "%.1f Hz %s: learned a period of %f s instead of %f s",
+					   refreshRates[r], names[d], scheduled.vsyncPeriod, period );
+			
+			// planning for the 90th percentile lets through about the slowest 10%, anything that misses the target
+			// vsync less often than that plus a little is fine. With one cost there is nothing to miss.
+			float allowedMisses = (distribution == ConstantCost) ? 0.0f : 0.12f;
+			TestCheck( scheduled.missedRatio <= allowedMisses, "%.1f Hz %s: missed %.1f%% of vsyncs", refreshRates[r], names[d], scheduled.missedRatio * 100.0f );
+			
+			// the point of the exercise, the pose is read closer to when it is shown
+			TestCheck( scheduled.meanLatency < immediate.meanLatency, "%.1f Hz %s: latency %f s isn't below %f s without scheduling",
+					   refreshRates[r], names[d], scheduled.meanLatency, immediate.meanLatency );
+			
+			// and not much earlier than the planned render cost and margin call for, when the cost is predictable
+			if( distribution == ConstantCost )
+			{
+				TestCheck( scheduled.meanLatency < 0.005f + 0.001f + 0.001f, "%.1f Hz %s: latency %f s for a 5 ms render", refreshRates[r], names[d], scheduled.meanLatency );
+			}
+		}
+	}
+	
+	return TestResult( "FrameSchedulerTest" );
+}
@@ -0,0 +1,155 @@
+//
+//  FusionSweepTest.cpp
+//  ofxOculusRift tests
+//
+//  FusionSweep has to give the same scores however many threads share the runs, down to the last bit, and every
+//  run has to be done once: a small grid over a few captures on 1, 2 and 7 threads. When the first thread's share
+//  is all long captures and the second's all short ones, the second has to steal from the first.
+//
+
+#include "TestCommon.h"
+#include "TestCapture.h"
+
+#include "Util/Util_FusionSweep.h"
+
+#include <math.h>
+
+static const int	NumCaptures		= 4;
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+// Head turns with still moments in between, for the tilt correction to work on and the prediction to miss
+static bool writeCapture( const char* _path, int _numSamples, float _phase )
+{
+	Array<Util::SensorCaptureSample> samples;
+	for( int i = 0; i < _numSamples; i++ )
+	{
+		float t = i * 0.001f;
+		float turn = sinf( 2.0f * t + _phase );
+		Vector3f rate = fabsf( turn ) > 0.5f ? Vector3f( 0.4f, 1.5f, -0.3f ) * turn : Vector3f( 0.0f, 0.0f, 0.0f );
+		samples.PushBack( MakeTestSample( rate, Vector3f( 0.05f, 9.81f, -0.1f ), Vector3f( 0.3f, 0.0f, 0.2f ), 0.001f ) );
+	}
+	
+	return WriteTestCapture( _path, samples );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+// Everything but the timing
+static bool isSameScore( const Util::FusionSweepScore& _a, const Util::FusionSweepScore& _b )
+{
+	return memcmp( &_a.TiltErrorMean, &_b.TiltErrorMean, sizeof( float ) ) == 0 && memcmp( &_a.TiltErrorMax, &_b.TiltErrorMax, sizeof( float ) ) == 0 &&
+		   memcmp( &_a.Jitter, &_b.Jitter, sizeof( float ) ) == 0 && memcmp( &_a.PredictionErrorRms, &_b.PredictionErrorRms, sizeof( float ) ) == 0 &&
+		   memcmp( &_a.PredictionErrorMax, &_b.PredictionErrorMax, sizeof( float ) ) == 0 && _a.NumSamples == _b.NumSamples;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+static void testThreads( String* _paths, UInt32 _numSamples )
+{
+	Util::FusionSweepGrid grid;
+	grid.AccelGain.PushBack( 0.02f );
+	grid.AccelGain.PushBack( 0.1f );
+	grid.TiltPeriod.PushBack( 20 );
+	grid.TiltPeriod.PushBack( 50 );
+	grid.PredictionDelta.PushBack( 0.02f );
+	grid.PredictionDelta.PushBack( 0.04f );
+	
+	Array<Util::FusionSweepScore> reference;
+	static const int threadCounts[] = { 1, 2, 7 };
+	for( int t = 0; t < 3; t++ )
+	{
+		Util::FusionSweep sweep;
+		for( int c = 0; c < NumCaptures; c++ )
+		{
+			sweep.AddCapture( _paths[c].ToCStr() );
+		}
+		sweep.AddGrid( grid );
+		
+		if( !TestCheck( sweep.GetNumConfigs() == 8 && sweep.Run( threadCounts[t] ), "%d threads: didn't run %u configurations", threadCounts[t], (unsigned)sweep.GetNumConfigs() ) )
+		{
+			continue;
+		}
+		
+		for( UPInt c = 0; c < sweep.GetNumConfigs(); c++ )
+		{
+			const Util::FusionSweepScore& score = sweep.GetScore( c );
+			
+			// every run of the configuration counted its capture's samples
+			TestCheck( score.NumSamples == _numSamples, "%d threads: configuration %u went over %u samples for %u", threadCounts[t], (unsigned)c, score.NumSamples, _numSamples );
+			if( t == 0 )
+			{
+				TestCheck( score.TiltErrorMean > 0.0f && score.Jitter > 0.0f, "configuration %u: scores are zero, the captures don't test much", (unsigned)c );
+				reference.PushBack( score );
+			}
+			else
+			{
+				TestCheck( isSameScore( score, reference[c] ), "%d threads: configuration %u doesn't score what it does on one", threadCounts[t], (unsigned)c );
+			}
+		}
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+// With one configuration runs go in capture order, so the first thread starts on the long ones
+static void testStealing( const char* _longPath, const char* _shortPath )
+{
+	Util::FusionSweep sweep;
+	for( int i = 0; i < 3; i++ )
+	{
+		sweep.AddCapture( _longPath );
+	}
+	for( int i = 0; i < 3; i++ )
+	{
+		sweep.AddCapture( _shortPath );
+	}
+	sweep.AddConfig( Util::FusionSweepParams() );
+	
+	if( TestCheck( sweep.Run( 2 ), "stealing: didn't run" ) )
+	{
+		TestCheck( sweep.GetNumSteals() > 0, "stealing: the second thread didn't take any of the first one's runs" );
+		
+		Util::FusionSweep single;
+		single.AddCapture( _longPath );
+		single.AddConfig( Util::FusionSweepParams() );
+		TestCheck( single.Run( 1 ) && sweep.GetScore( 0 ).NumSamples == 3 * single.GetScore( 0 ).NumSamples + 3 * 500, "stealing: runs went missing or were done twice" );
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+int main()
+{
+	System::Init();
+	{
+		String paths[NumCaptures];
+		UInt32 numSamples = 0;
+		bool written = true;
+		for( int c = 0; c < NumCaptures; c++ )
+		{
+			char name[64];
+			sprintf( name, "FusionSweepTest%d", c );
+			paths[c] = GetTestCapturePath( name );
+			written = written && writeCapture( paths[c].ToCStr(), 1000 + 700 * c, c * 0.9f );
+			numSamples += 1000 + 700 * c;
+		}
+		
+		String longPath = GetTestCapturePath( "FusionSweepTestLong" );
+		String shortPath = GetTestCapturePath( "FusionSweepTestShort" );
+		written = written && writeCapture( longPath.ToCStr(), 20000, 0.0f ) && writeCapture( shortPath.ToCStr(), 500, 0.0f );
+		
+		if( TestCheck( written, "can't write the captures" ) )
+		{
+			testThreads( paths, numSamples );
+			testStealing( longPath.ToCStr(), shortPath.ToCStr() );
+		}
+		
+		for( int c = 0; c < NumCaptures; c++ )
+		{
+			unlink( paths[c].ToCStr() );
+		}
+		unlink( longPath.ToCStr() );
+		unlink( shortPath.ToCStr() );
+	}
+	System::Destroy();
+	
+	return TestResult( "FusionSweepTest" );
+}
@@ -0,0 +1,57 @@
+//
+//  IntegratorBench.cpp
+//  ofxOculusRift tests
+//
+//  SensorReplay::CompareIntegrators over ten seconds of a headset turning back and forth about all three axes:
+//  what a step of each of SensorFusion's gyro integrators costs, and how far it drifts from the double precision
+//  reference.
+//
+
+#include "TestCommon.h"
+#include "TestCapture.h"
+
+#include <math.h>
+
+static const int	NumSamples		= 10000;
+static const int	NumPasses		= 50;
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+int main()
+{
+	System::Init( Log::ConfigureDefaultLog( LogMask_None ) );
+	{
+		String capturePath = GetTestCapturePath( "IntegratorBench" );
+		
+		// up to a few rad/s, about what a quick head turn reaches
+		Array<Util::SensorCaptureSample> samples;
+		for( int i = 0; i < NumSamples; i++ )
+		{
+			float t = i * 0.001f;
+			samples.PushBack( MakeTestSample( Vector3f( 2.0f * sinf( 3.1f * t ), 3.0f * sinf( 1.3f * t + 0.5f ), 0.7f * sinf( 5.3f * t ) ),
+											  Vector3f( 0.0f, 9.81f, 0.0f ), Vector3f( 0.3f, 0.0f, 0.2f ), 0.001f ) );
+		}
+		
+		Util::SensorReplay replay;
+		Util::IntegratorReport reports[SensorFusion::Integrator_Count];
+		if( WriteTestCapture( capturePath.ToCStr(), samples ) && replay.Open( capturePath.ToCStr() ) && replay.CompareIntegrators( reports, NumPasses ) )
+		{
+			static const char* names[SensorFusion::Integrator_Count] = { "axis-angle", "midpoint", "exp map" };
+			
+			printf( "IntegratorBench\n" );
+			for( int i = 0; i < SensorFusion::Integrator_Count; i++ )
+			{
+				printf( "  %-12s %6.1f ns per sample, drift max %.2e rad, final %.2e rad\n", names[i], reports[i].NsPerSample, reports[i].MaxDrift, reports[i].FinalDrift );
+			}
+		}
+		else
+		{
+			printf( "IntegratorBench: can't write, open or replay %s\n", capturePath.ToCStr() );
+		}
+		
+		unlink( capturePath.ToCStr() );
+	}
+	System::Destroy();
+	
+	return 0;
+}
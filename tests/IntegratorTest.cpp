@@ -0,0 +1,74 @@
+//
+//  IntegratorTest.cpp
+//  ofxOculusRift tests
+//
+//  SensorReplay::CompareIntegrators against its double precision reference. At a constant rate every integrator
+//  is exact but for rounding, so none may drift. With the rate ramping up, rotating by the current rate each
+//  sample falls behind by half the rate's change every step: Integrator_Midpoint, which takes the mean of the
+//  last two, has to stay with the reference, far under Integrator_AxisAngle. Integrator_ExpMap steps by the
+//  current rate as well, so it has to end up where Integrator_AxisAngle does.
+//
+
+#include "TestCommon.h"
+#include "TestCapture.h"
+
+#include <math.h>
+
+static const int	NumSamples		= 10000;	// 10 s at 1 kHz
+static const float	RoundingDrift	= 1e-4f;	// what float rounding builds up to over the capture
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+// _ramp scales the rate from 0 at the start to the full rate at 1 s, and on at the same pace
+static bool compare( const char* _name, const Vector3f& _rotationRate, bool _ramp, Util::IntegratorReport* _reports )
+{
+	String capturePath = GetTestCapturePath( _name );
+	
+	Array<Util::SensorCaptureSample> samples;
+	for( int i = 0; i < NumSamples; i++ )
+	{
+		float scale = _ramp ? i * 0.001f : 1.0f;
+		samples.PushBack( MakeTestSample( _rotationRate * scale, Vector3f( 0.0f, 9.81f, 0.0f ), Vector3f( 0.3f, 0.0f, 0.2f ), 0.001f ) );
+	}
+	
+	Util::SensorReplay replay;
+	bool ok = TestCheck( WriteTestCapture( capturePath.ToCStr(), samples ) && replay.Open( capturePath.ToCStr() ), "%s: can't write or open %s", _name, capturePath.ToCStr() ) &&
+			  TestCheck( replay.CompareIntegrators( _reports, 1 ), "%s: didn't compare", _name );
+	
+	unlink( capturePath.ToCStr() );
+	return ok;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+int main()
+{
+	System::Init();
+	{
+		static const char* names[SensorFusion::Integrator_Count] = { "axis-angle", "midpoint", "exp map" };
+		Util::IntegratorReport reports[SensorFusion::Integrator_Count];
+		
+		if( compare( "IntegratorTestConstant", Vector3f( 1.0f, 0.5f, -0.25f ), false, reports ) )
+		{
+			for( int i = 0; i < SensorFusion::Integrator_Count; i++ )
+			{
+				TestCheck( reports[i].MaxDrift < RoundingDrift, "constant rate: %s drifted %g rad", names[i], reports[i].MaxDrift );
+			}
+		}
+		
+		if( compare( "IntegratorTestRamp", Vector3f( 1.0f, 0.5f, -0.25f ), true, reports ) )
+		{
+			const Util::IntegratorReport& axisAngle	= reports[SensorFusion::Integrator_AxisAngle];
+			const Util::IntegratorReport& midpoint	= reports[SensorFusion::Integrator_Midpoint];
+			const Util::IntegratorReport& expMap	= reports[SensorFusion::Integrator_ExpMap];
+			
+			TestCheck( axisAngle.FinalDrift > 10.0f * RoundingDrift, "ramp: axis-angle only drifted %g rad, the capture doesn't tell them apart", axisAngle.FinalDrift );
+			TestCheck( midpoint.MaxDrift < RoundingDrift && midpoint.MaxDrift < axisAngle.MaxDrift * 0.1f,
+					   "ramp: midpoint drifted %g rad, axis-angle %g rad", midpoint.MaxDrift, axisAngle.MaxDrift );
+			TestCheck( fabsf( expMap.FinalDrift - axisAngle.FinalDrift ) < RoundingDrift,
+					   "ramp: exp map drifted %g rad, axis-angle %g rad", expMap.FinalDrift, axisAngle.FinalDrift );
+		}
+	}
+	System::Destroy();
+	
+	return TestResult( "IntegratorTest" );
+}
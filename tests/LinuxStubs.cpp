@@ -0,0 +1,17 @@
+//
+//  LinuxStubs.cpp
+//  ofxOculusRift tests
+//
+//  LibOVR only has Win32 and OSX backends. The platform HMD code normally provides this hook for the sensor
+//  factory, here there is no display to find so it does nothing.
+//
+
+#include "OVR_SensorImpl.h"
+
+namespace OVR {
+
+void SensorDeviceImpl::EnumerateHMDFromSensorDisplayInfo( const SensorDisplayInfoImpl&, DeviceFactory::EnumerateVisitor& )
+{
+}
+
+} // OVR
@@ -0,0 +1,187 @@
+//
+//  MagCalibrationTest.cpp
+//  ofxOculusRift tests
+//
+//  MagFit has to recover the center and radii of noisy readings on a sphere and on an axis aligned ellipsoid,
+//  also from only a cap of directions, and refuse readings that all lie in one plane. Streaming calibration
+//  through a SensorFusion has to set the calibration once it has enough readings, and when the center moves,
+//  replace it and drop the mag reference that was taken under the old one.
+//
+
+#include "TestCommon.h"
+
+#include "OVR.h"
+#include "Util/Util_MagCalibration.h"
+using namespace OVR;
+
+#include <math.h>
+
+static const Vector3f	Center( 0.21f, -0.34f, 0.12f );
+static const Vector3f	Radii( 0.52f, 0.47f, 0.58f );
+static const float		Noise			= 0.005f;
+
+// Deterministic so a failure can be reproduced
+static UInt32 RandomState = 3;
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+static float getUniform()
+{
+	RandomState = RandomState * 1664525u + 1013904223u;
+	return ((RandomState >> 8) + 0.5f) / 16777216.0f;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+// Box-Muller
+static float getGaussian()
+{
+	return sqrtf( -2.0f * logf( getUniform() ) ) * cosf( 2.0f * Math<float>::Pi * getUniform() );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+// A noisy reading on the ellipsoid, optionally only from the directions within about 70 degrees of +y
+static Vector3f getReading( const Vector3f& _center, const Vector3f& _radii, bool _cap )
+{
+	Vector3f dir;
+	do
+	{
+		dir = Vector3f( getGaussian(), getGaussian(), getGaussian() );
+	}
+	while( dir.LengthSq() < 1e-6f || (_cap && dir.y < 0.35f * dir.Length()) );
+	dir.Normalize();
+	
+	return Vector3f( _center.x + _radii.x * dir.x + Noise * getGaussian(),
+					 _center.y + _radii.y * dir.y + Noise * getGaussian(),
+					 _center.z + _radii.z * dir.z + Noise * getGaussian() );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+static void testFit( bool _ellipsoid, bool _cap )
+{
+	const char* name = _ellipsoid ? (_cap ? "ellipsoid cap" : "ellipsoid") : (_cap ? "sphere cap" : "sphere");
+	Vector3f radii = _ellipsoid ? Radii : Vector3f( 0.5f, 0.5f, 0.5f );
+	
+	Util::MagFit fit;
+	for( int i = 0; i < 2000; i++ )
+	{
+		fit.AddSample( getReading( Center, radii, _cap ) );
+	}
+	
+	// the sphere model can't fit an ellipsoid, only the ellipsoid model is checked on those
+	for( int model = _ellipsoid ? Util::MagFit::Model_Ellipsoid : Util::MagFit::Model_Sphere; model <= Util::MagFit::Model_Ellipsoid; model++ )
+	{
+		const char* modelName = (model == Util::MagFit::Model_Sphere) ? "sphere" : "ellipsoid";
+		
+		Util::MagFit::Result result;
+		if( !TestCheck( fit.Solve( (Util::MagFit::Model)model, &result ), "%s data, %s model: no fit", name, modelName ) )
+		{
+			continue;
+		}
+		
+		// a cap leaves more freedom along its axis
+		float centerTolerance = _cap ? 0.02f : 0.005f;
+		TestCheck( (result.Center - Center).Length() < centerTolerance, "%s data, %s model: center off by %f", name, modelName, (result.Center - Center).Length() );
+		TestCheck( fabsf( result.Radii.x - radii.x ) < 2.0f * centerTolerance &&
+				   fabsf( result.Radii.y - radii.y ) < 2.0f * centerTolerance &&
+				   fabsf( result.Radii.z - radii.z ) < 2.0f * centerTolerance,
+				   "%s data, %s model: radii %f %f %f instead of %f %f %f", name, modelName, result.Radii.x, result.Radii.y, result.Radii.z, radii.x, radii.y, radii.z );
+		TestCheck( result.Residual < 3.0f * Noise, "%s data, %s model: residual %f", name, modelName, result.Residual );
+		TestCheck( result.NumSamples == 2000, "%s data, %s model: fit of %u samples", name, modelName, result.NumSamples );
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+static void testPlanar()
+{
+	Util::MagFit fit;
+	for( int i = 0; i < 500; i++ )
+	{
+		float angle = i * 0.1f;
+		fit.AddSample( Vector3f( Center.x + 0.5f * cosf( angle ), Center.y + 0.5f * sinf( angle ), Center.z ) );
+	}
+	
+	Util::MagFit::Result result;
+	TestCheck( !fit.Solve( Util::MagFit::Model_Sphere, &result ), "planar data: the sphere model found a fit" );
+	TestCheck( !fit.Solve( Util::MagFit::Model_Ellipsoid, &result ), "planar data: the ellipsoid model found a fit" );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+// Feeds the fusion the way a sensor would when nothing is attached: integration, then its delegate
+static void feedReadings( SensorFusion& _fusion, const Vector3f& _center, int _count )
+{
+	MessageBodyFrame frame( NULL );
+	frame.Acceleration = Vector3f( 0.0f, 9.81f, 0.0f );
+	frame.TimeDelta = 0.001f;
+	
+	for( int i = 0; i < _count; i++ )
+	{
+		frame.MagneticField = getReading( _center, Vector3f( 0.5f, 0.5f, 0.5f ), false );
+		_fusion.OnMessage( frame );
+		if( _fusion.GetDelegateMessageHandler() )
+		{
+			_fusion.GetDelegateMessageHandler()->OnMessage( frame );
+		}
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+static void testStreaming()
+{
+	SensorFusion fusion;
+	Util::MagCalibration calibration;
+	
+	// a loose residual, so that a fit over readings from before and after the move still counts
+	calibration.SetStreamThresholds( 0.02f, 100, 0.5f, 0.01f );
+	calibration.BeginStreamingCalibration( fusion );
+	
+	feedReadings( fusion, Center, 50 );
+	TestCheck( calibration.UpdateStreamingCalibration( fusion ) == Util::MagCalibration::Mag_StreamCalibrating, "streaming: calibrated from too few readings" );
+	TestCheck( !fusion.HasMagCalibration(), "streaming: the fusion has a calibration from too few readings" );
+	
+	feedReadings( fusion, Center, 450 );
+	TestCheck( calibration.UpdateStreamingCalibration( fusion ) == Util::MagCalibration::Mag_Calibrated, "streaming: not calibrated after 500 readings" );
+	TestCheck( fusion.HasMagCalibration(), "streaming: the fusion has no calibration after 500 readings" );
+	TestCheck( (calibration.GetMagCenter() - Center).Length() < 0.01f, "streaming: center off by %f", (calibration.GetMagCenter() - Center).Length() );
+	
+	// HasMagReference never turns true in this LibOVR, IsMagReady is what arms yaw correction
+	fusion.SetMagReference();
+	TestCheck( fusion.IsMagReady(), "streaming: not ready for yaw correction after setting the reference" );
+	
+	// more readings about the same center move it by less than the limit, the reference stays
+	feedReadings( fusion, Center, 500 );
+	calibration.UpdateStreamingCalibration( fusion );
+	TestCheck( fusion.IsMagReady(), "streaming: the mag reference went without the center moving" );
+	
+	// the field offset changes, say something magnetic was put on the headset
+	Vector3f movedCenter = Center + Vector3f( 0.1f, 0.0f, -0.05f );
+	feedReadings( fusion, movedCenter, 3000 );
+	Vector3f oldCenter = calibration.GetMagCenter();
+	calibration.UpdateStreamingCalibration( fusion );
+	TestCheck( (calibration.GetMagCenter() - oldCenter).Length() > 0.01f, "streaming: the center didn't follow the move" );
+	TestCheck( !fusion.IsMagReady(), "streaming: yaw correction still armed with the reference from the old calibration" );
+	TestCheck( fusion.HasMagCalibration(), "streaming: the fusion lost its calibration" );
+	
+	calibration.EndStreamingCalibration( fusion );
+	TestCheck( fusion.GetDelegateMessageHandler() == NULL, "streaming: the delegate handler wasn't given back" );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+int main()
+{
+	System::Init();
+	{
+		testFit( false, false );
+		testFit( false, true );
+		testFit( true, false );
+		testFit( true, true );
+		testPlanar();
+		testStreaming();
+	}
+	System::Destroy();
+	
+	return TestResult( "MagCalibrationTest" );
+}
@@ -0,0 +1,160 @@
+//
+//  MultiResLayoutTest.cpp
+//  ofxOculusRift tests
+//
+//  Checks ofxOculusRiftMultiResLayout against DistortionFn: the required resolution is the inverse slope of the
+//  warp, the centre ends where that drops to the border resolution, and everywhere along the axes through the
+//  lens centre the packed texture has at least as many pixels as the warp reads there.
+//
+
+#include "TestCommon.h"
+
+#include "ofxOculusRiftMultiRes.h"
+
+#include <math.h>
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+static float getSlope( const Util::Render::DistortionConfig& _distortion, float _radius )
+{
+	const float h = 1e-3f;
+	return (_distortion.DistortionFn( _radius + h ) - _distortion.DistortionFn( fabs( _radius - h ) ) * (_radius >= h ? 1.0f : -1.0f)) / (2.0f * h);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+// The display radius whose pixel reads the eye image at _sourceRadius, DistortionFn grows monotonically for the DK1 coefficients
+static float getDisplayRadius( const Util::Render::DistortionConfig& _distortion, float _scale, float _sourceRadius )
+{
+	float low = 0.0f;
+	float high = 8.0f;
+	for( int i = 0; i < 48; i++ )
+	{
+		float middle = (low + high) * 0.5f;
+		if( _distortion.DistortionFn( middle ) / _scale < _sourceRadius )	{ low = middle; }
+		else																{ high = middle; }
+	}
+	
+	return (low + high) * 0.5f;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+// Walks one axis of the eye texture in pixel steps and compares the packed pixel density with what the warp needs
+static void checkAxisDensity( const ofxOculusRiftMultiResLayout& _layout, const Util::Render::DistortionConfig& _distortion, float _scale,
+							  bool _horizontal, float _lensCentre, float _axisToDistortion, int _eyeSize, int _packedSize, const char* _label )
+{
+	ofxOculusRiftMultiResSplit eyeSplit = _layout.getEyeSplit();
+	float split0 = _horizontal ? eyeSplit.x0 : eyeSplit.y0;
+	float split1 = _horizontal ? eyeSplit.x1 : eyeSplit.y1;
+	
+	float step = 1.0f / _eyeSize;
+	float worst = 1e6f;
+	
+	for( int i = 1; i < _eyeSize - 1; i++ )
+	{
+		float t = (i + 0.5f) * step;
+		
+		// the mapping has a kink at the splits, the slope is only defined away from them
+		if( fabs( t - split0 ) < 2.0f * step || fabs( t - split1 ) < 2.0f * step )
+		{
+			continue;
+		}
+		
+		Vector2f before	= _layout.getPackedTexCoord( _horizontal ? Vector2f( t - step, 0.5f ) : Vector2f( 0.5f, t - step ) );
+		Vector2f after	= _layout.getPackedTexCoord( _horizontal ? Vector2f( t + step, 0.5f ) : Vector2f( 0.5f, t + step ) );
+		float packedStep = _horizontal ? (after.x - before.x) : (after.y - before.y);
+		float density = packedStep * _packedSize / 2.0f;
+		
+		float sourceRadius = fabs( (2.0f * t - 1.0f) - _lensCentre ) * _axisToDistortion;
+		float displayRadius = getDisplayRadius( _distortion, _scale, sourceRadius );
+		float required = _distortion.K[0] / getSlope( _distortion, displayRadius );
+		
+		worst = Alg::Min( worst, density / required );
+	}
+	
+	// a pixel of rounding in each region's size is allowed for
+	float tolerance = 1.0f - 3.0f / _packedSize;
+	TestCheck( worst >= tolerance, "%s: packed density only %.3f of what the warp reads", _label, worst );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+static void checkLayout( const Util::Render::DistortionConfig& _distortion, float _scale, float _aspect, bool _isLeftEye,
+						 int _eyeWidth, int _eyeHeight, float _borderResolution )
+{
+	char label[128];
+	sprintf( label, "%s eye, border %.2f", _isLeftEye ? "left" : "right", _borderResolution );
+	
+	ofxOculusRiftMultiResLayout layout;
+	layout.setup( _distortion, _scale, _aspect, _isLeftEye, _eyeWidth, _eyeHeight, _borderResolution );
+	
+	float lensX = _isLeftEye ? _distortion.XCenterOffset : -_distortion.XCenterOffset;
+	float maxRadius = sqrtf( (1.0f + fabs( lensX )) * (1.0f + fabs( lensX )) + 1.0f / (_aspect * _aspect) );
+	
+	// the analytic derivative matches the slope of DistortionFn
+	for( float r = 0.0f; r <= maxRadius; r += 0.05f )
+	{
+		float expected = _distortion.K[0] / getSlope( _distortion, r );
+		float actual = ofxOculusRiftMultiResLayout::getRequiredResolution( _distortion, r );
+		TestCheck( fabs( actual - expected ) < 1e-3f * expected, "%s: required resolution at r=%.2f is %f, DistortionFn slope gives %f", label, r, actual, expected );
+	}
+	
+	// the centre ends where the border resolution is just enough
+	float centreRadius = layout.getCentreRadius();
+	if( centreRadius < maxRadius && _borderResolution < 1.0f )
+	{
+		float required = ofxOculusRiftMultiResLayout::getRequiredResolution( _distortion, centreRadius );
+		TestCheck( fabs( required - layout.getBorderResolution() ) < 1e-3f, "%s: resolution at the centre edge is %f", label, required );
+	}
+	
+	// and the split is that radius pushed through DistortionFn into the eye's clip space
+	float sourceRadius = _distortion.DistortionFn( centreRadius ) / _scale;
+	ofxOculusRiftMultiResSplit eyeSplit = layout.getEyeSplit();
+	float expectedX0 = (Alg::Clamp( lensX - sourceRadius, -1.0f, 1.0f ) + 1.0f) * 0.5f;
+	float expectedX1 = (Alg::Clamp( lensX + sourceRadius, -1.0f, 1.0f ) + 1.0f) * 0.5f;
+	float expectedY1 = (Alg::Clamp( sourceRadius * _aspect, -1.0f, 1.0f ) + 1.0f) * 0.5f;
+	TestCheck( fabs( eyeSplit.x0 - expectedX0 ) < 1e-5f && fabs( eyeSplit.x1 - expectedX1 ) < 1e-5f && fabs( eyeSplit.y1 - expectedY1 ) < 1e-5f,
+			   "%s: split (%f %f %f) doesn't follow DistortionFn (%f %f %f)", label, eyeSplit.x0, eyeSplit.x1, eyeSplit.y1, expectedX0, expectedX1, expectedY1 );
+	
+	// the regions tile the packed texture and the corners map onto its corners
+	int area = 0;
+	for( int i = 0; i < layout.getNumRegions(); i++ )
+	{
+		const ofxOculusRiftMultiResRegion& region = layout.getRegion( i );
+		area += region.viewport.w * region.viewport.h;
+		TestCheck( region.viewport.x >= 0 && region.viewport.y >= 0 && region.viewport.x + region.viewport.w <= layout.getPackedWidth() &&
+				   region.viewport.y + region.viewport.h <= layout.getPackedHeight(), "%s: region %d is outside the packed texture", label, i );
+	}
+	TestCheck( area == layout.getPackedWidth() * layout.getPackedHeight(), "%s: regions cover %d of %d pixels", label, area, layout.getPackedWidth() * layout.getPackedHeight() );
+	
+	Vector2f lowCorner = layout.getPackedTexCoord( Vector2f( 0.0f, 0.0f ) );
+	Vector2f highCorner = layout.getPackedTexCoord( Vector2f( 1.0f, 1.0f ) );
+	TestCheck( fabs( lowCorner.x ) < 1e-5f && fabs( lowCorner.y ) < 1e-5f && fabs( highCorner.x - 1.0f ) < 1e-5f && fabs( highCorner.y - 1.0f ) < 1e-5f,
+			   "%s: corners map to (%f %f) and (%f %f)", label, lowCorner.x, lowCorner.y, highCorner.x, highCorner.y );
+	
+	checkAxisDensity( layout, _distortion, _scale, true,  lensX, 1.0f,			_eyeWidth,	layout.getPackedWidth(),  label );
+	checkAxisDensity( layout, _distortion, _scale, false, 0.0f,  1.0f / _aspect,	_eyeHeight, layout.getPackedHeight(), label );
+	
+	printf( "  %-26s centre radius %.3f, packed %dx%d of %dx%d\n", label, centreRadius, layout.getPackedWidth(), layout.getPackedHeight(), _eyeWidth, _eyeHeight );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+int main()
+{
+	// the DK1 defaults, set up the way ofxOculusRift::updateMultiResLayout does
+	Util::Render::StereoConfig stereoConfig;
+	stereoConfig.SetStereoMode( Util::Render::Stereo_LeftRight_Multipass );
+	
+	const Util::Render::DistortionConfig& distortion = stereoConfig.GetDistortionConfig();
+	float shaderScaleFactor = 1.0f;
+	float warpAspect = 0.5f;
+	
+	float borderResolutions[] = { 0.25f, 0.5f, 0.75f, 1.0f };
+	for( int i = 0; i < 4; i++ )
+	{
+		checkLayout( distortion, distortion.Scale / shaderScaleFactor, warpAspect, true,  640, 800, borderResolutions[i] );
+		checkLayout( distortion, distortion.Scale / shaderScaleFactor, warpAspect, false, 640, 800, borderResolutions[i] );
+	}
+	
+	return TestResult( "MultiResLayoutTest" );
+}
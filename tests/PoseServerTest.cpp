@@ -0,0 +1,161 @@
+//
+//  PoseServerTest.cpp
+//  ofxOculusRift tests
+//
+//  A pose server and a client on one machine, in two processes. The server plays a capture through SensorReplay
+//  in real time and publishes each sample, a forked client reads the pose and the sample history from the
+//  shared memory meanwhile. The capture turns at a constant rate with gravity and yaw correction off, so the
+//  angle of every pose follows from its SampleIndex, which catches torn or out of order reads.
+//
+
+#include "TestCommon.h"
+#include "TestCapture.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+
+static const int	NumSamples		= 500;
+static const float	TimeDelta		= 0.002f;
+static const float	RotationRate	= 2.0f;		// rad/s about y, under half a turn over the capture
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+static float getAngle( const Quatf& _q )
+{
+	return 2.0f * acosf( Alg::Min( fabsf( _q.w ), 1.0f ) );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+// In the forked process, the exit code is the number of failed checks
+static int runClient( const char* _name )
+{
+	Util::PoseClient client;
+	
+	double start = Timer::TicksToSeconds( Timer::GetTicks() );
+	while( !client.Open( _name ) )
+	{
+		if( Timer::TicksToSeconds( Timer::GetTicks() ) - start > 5.0 )
+		{
+			TestCheck( false, "client: the server's segment never showed up" );
+			return TestFailures;
+		}
+		Thread::MSleep( 1 );
+	}
+	
+	UInt32 lastIndex = 0;
+	int numReads = 0;
+	int numChanges = 0;
+	float worstAngleError = 0.0f;
+	
+	Util::SharedSample history[Util::PoseServer_HistorySize];
+	int numHistoryReads = 0;
+	
+	while( lastIndex < (UInt32)NumSamples && Timer::TicksToSeconds( Timer::GetTicks() ) - start < 10.0 )
+	{
+		Util::SharedPose pose;
+		if( !client.ReadPose( &pose ) )
+		{
+			continue;
+		}
+		numReads++;
+		
+		TestCheck( pose.SampleIndex >= lastIndex, "client: pose went back from sample %u to %u", lastIndex, pose.SampleIndex );
+		if( pose.SampleIndex != lastIndex ) { numChanges++; }
+		lastIndex = pose.SampleIndex;
+		
+		// the integrators differ in how much of the first step they count, anything between the two ends is right
+		float angle = getAngle( pose.Orientation );
+		float low = RotationRate * TimeDelta * (pose.SampleIndex - 1.0f);
+		float high = RotationRate * TimeDelta * pose.SampleIndex;
+		float error = (angle < low) ? (low - angle) : ((angle > high) ? (angle - high) : 0.0f);
+		worstAngleError = Alg::Max( worstAngleError, error );
+		
+		TestCheck( fabsf( pose.Orientation.x ) < 1e-4f && fabsf( pose.Orientation.z ) < 1e-4f,
+				   "client: sample %u turned off the y axis (%f %f %f %f)", pose.SampleIndex, pose.Orientation.x, pose.Orientation.y, pose.Orientation.z, pose.Orientation.w );
+		
+		// every so often the history too, it has to be consecutive samples of the capture
+		if( numReads % 64 == 0 )
+		{
+			unsigned count = client.ReadHistory( history, Util::PoseServer_HistorySize );
+			for( unsigned i = 0; i < count; i++ )
+			{
+				if( i > 0 )
+				{
+					TestCheck( history[i].SampleIndex == history[i-1].SampleIndex + 1, "client: history skips from %u to %u", history[i-1].SampleIndex, history[i].SampleIndex );
+				}
+				TestCheck( history[i].RotationRate.y == RotationRate && history[i].TimeDelta == TimeDelta, "client: history sample %u isn't the captured one", history[i].SampleIndex );
+			}
+			numHistoryReads++;
+		}
+		
+		Thread::MSleep( 0 );
+	}
+	
+	TestCheck( lastIndex == (UInt32)NumSamples, "client: last pose read was sample %u of %d", lastIndex, NumSamples );
+	TestCheck( worstAngleError < 1e-3f, "client: pose angle off by up to %f rad for its sample index", worstAngleError );
+	TestCheck( numChanges > NumSamples / 10, "client: only saw %d of %d poses, it should keep up with real time", numChanges, NumSamples );
+	
+	printf( "  client read %d poses, %d different, %d history reads\n", numReads, numChanges, numHistoryReads );
+	
+	return TestFailures;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+int main()
+{
+	char name[64];
+	sprintf( name, "/ovr_pose_test_%d", (int)getpid() );
+	
+	System::Init();
+	{
+		String capturePath = GetTestCapturePath( "PoseServerTest" );
+		
+		Array<Util::SensorCaptureSample> samples;
+		for( int i = 0; i < NumSamples; i++ )
+		{
+			samples.PushBack( MakeTestSample( Vector3f( 0.0f, RotationRate, 0.0f ), Vector3f( 0.0f, 9.81f, 0.0f ), Vector3f( 0.3f, 0.0f, 0.2f ), TimeDelta ) );
+		}
+		
+		// the client gets its own copy of everything, LibOVR was set up but hasn't started any threads yet
+		pid_t clientPid = WriteTestCapture( capturePath.ToCStr(), samples ) ? fork() : -1;
+		if( clientPid == 0 )
+		{
+			int failures = runClient( name );
+			fflush( stdout );
+			_exit( Alg::Min( failures, 100 ) );
+		}
+		
+		if( TestCheck( clientPid > 0, "can't write %s or start the client", capturePath.ToCStr() ) )
+		{
+			SensorFusion fusion;
+			fusion.SetGravityEnabled( false );
+			fusion.SetYawCorrectionEnabled( false );
+			fusion.SetPredictionEnabled( false );
+			
+			Util::PoseServer server;
+			TestCheck( server.Open( name ), "server: can't open %s", name );
+			server.SetFusion( &fusion );
+			
+			// SensorReplay feeds the fusion by hand, which doesn't call its delegate, so the server listens too
+			Util::SensorReplay replay;
+			TestCheck( replay.Open( capturePath.ToCStr() ), "server: can't open the capture" );
+			
+			UInt32 numPlayed = replay.Play( &fusion, server.GetMessageHandler(), true );
+			TestCheck( numPlayed == (UInt32)NumSamples, "server: played %u of %d samples", numPlayed, NumSamples );
+			
+			int status = 0;
+			waitpid( clientPid, &status, 0 );
+			TestCheck( WIFEXITED( status ) && WEXITSTATUS( status ) == 0, "the client failed (status %x), see above", status );
+			
+			server.SetFusion( NULL );
+			server.Close();
+		}
+		
+		unlink( capturePath.ToCStr() );
+	}
+	System::Destroy();
+	
+	return TestResult( "PoseServerTest" );
+}
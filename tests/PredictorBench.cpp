@@ -0,0 +1,80 @@
+//
+//  PredictorBench.cpp
+//  ofxOculusRift tests
+//
+//  SensorReplay::ComparePredictors over twenty seconds of a headset turning back and forth, with gyro noise: how
+//  far each predictor is off at the horizons a frame is rendered ahead, and what it costs per sample.
+//
+
+#include "TestCommon.h"
+#include "TestCapture.h"
+
+#include <math.h>
+
+static const int	NumSamples		= 20000;
+static const int	NumHorizons		= 4;
+static const float	Horizons[NumHorizons] = { 0.01f, 0.02f, 0.04f, 0.06f };
+
+// Deterministic, so that runs compare
+static UInt32 RandomState = 11;
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+static float getRandom( float _range )
+{
+	RandomState = RandomState * 1664525u + 1013904223u;
+	return _range * (((RandomState >> 8) + 0.5f) / 8388608.0f - 1.0f);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+int main()
+{
+	System::Init( Log::ConfigureDefaultLog( LogMask_None ) );
+	{
+		String capturePath = GetTestCapturePath( "PredictorBench" );
+		
+		// head turns of up to a few rad/s that start and stop, and about the noise of the DK1 gyro
+		Array<Util::SensorCaptureSample> samples;
+		for( int i = 0; i < NumSamples; i++ )
+		{
+			float t = i * 0.001f;
+			Vector3f rate( 0.8f * sinf( 2.1f * t ), 3.0f * sinf( 1.3f * t ) * sinf( 0.4f * t ), 0.5f * sinf( 3.7f * t + 1.0f ) );
+			Vector3f noise( getRandom( 0.03f ), getRandom( 0.03f ), getRandom( 0.03f ) );
+			samples.PushBack( MakeTestSample( rate + noise, Vector3f( 0.0f, 9.81f, 0.0f ), Vector3f( 0.3f, 0.0f, 0.2f ), 0.001f ) );
+		}
+		
+		ConstantVelocityPredictor constantVelocity;
+		ConstantAccelerationPredictor constantAcceleration;
+		KalmanPredictor kalman;
+		SensorPredictor* predictors[] = { &constantVelocity, &constantAcceleration, &kalman };
+		const char* names[] = { "constant velocity", "constant acceleration", "Kalman" };
+		const int numPredictors = sizeof( predictors ) / sizeof( predictors[0] );
+		
+		Util::SensorReplay replay;
+		Util::PredictorReport reports[numPredictors];
+		if( WriteTestCapture( capturePath.ToCStr(), samples ) && replay.Open( capturePath.ToCStr() ) &&
+			replay.ComparePredictors( predictors, numPredictors, Horizons, NumHorizons, reports ) )
+		{
+			printf( "PredictorBench, errors in mrad: median / 95%% / 99%% / max\n" );
+			for( int p = 0; p < numPredictors; p++ )
+			{
+				printf( "  %s, %.1f ns per sample\n", names[p], reports[p].NsPerSample );
+				for( int h = 0; h < NumHorizons; h++ )
+				{
+					printf( "    %3.0f ms   %7.3f %7.3f %7.3f %7.3f\n", Horizons[h] * 1000.0f,
+							reports[p].Median[h] * 1000.0f, reports[p].P95[h] * 1000.0f, reports[p].P99[h] * 1000.0f, reports[p].Max[h] * 1000.0f );
+				}
+			}
+		}
+		else
+		{
+			printf( "PredictorBench: can't write, open or replay %s\n", capturePath.ToCStr() );
+		}
+		
+		unlink( capturePath.ToCStr() );
+	}
+	System::Destroy();
+	
+	return 0;
+}
@@ -0,0 +1,84 @@
+//
+//  PredictorTest.cpp
+//  ofxOculusRift tests
+//
+//  SensorReplay::ComparePredictors on made up captures. With the headset speeding up at a constant angular
+//  acceleration, ConstantAccelerationPredictor has to beat ConstantVelocityPredictor at every horizon, and so has
+//  KalmanPredictor, which models the same. At a constant rate the Kalman filter has nothing to follow but its own
+//  start, so its predictions have to stay on the fused orientation.
+//
+
+#include "TestCommon.h"
+#include "TestCapture.h"
+
+static const int	NumSamples		= 3000;
+static const int	NumHorizons		= 4;
+static const float	Horizons[NumHorizons] = { 0.01f, 0.02f, 0.04f, 0.06f };
+
+enum { ConstantVelocity, ConstantAcceleration, Kalman, NumPredictors };
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+// The headset turns about a tilted axis at _rate rad/s plus _acceleration rad/s^2 from the start
+static bool compare( const char* _name, float _rate, float _acceleration, Util::PredictorReport* _reports )
+{
+	String capturePath = GetTestCapturePath( _name );
+	
+	Vector3f axis = Vector3f( 0.3f, 1.0f, 0.2f ).Normalized();
+	Array<Util::SensorCaptureSample> samples;
+	for( int i = 0; i < NumSamples; i++ )
+	{
+		samples.PushBack( MakeTestSample( axis * (_rate + _acceleration * i * 0.001f), Vector3f( 0.0f, 9.81f, 0.0f ), Vector3f( 0.3f, 0.0f, 0.2f ), 0.001f ) );
+	}
+	
+	ConstantVelocityPredictor constantVelocity;
+	ConstantAccelerationPredictor constantAcceleration;
+	KalmanPredictor kalman;
+	SensorPredictor* predictors[NumPredictors] = { &constantVelocity, &constantAcceleration, &kalman };
+	
+	Util::SensorReplay replay;
+	bool ok = TestCheck( WriteTestCapture( capturePath.ToCStr(), samples ) && replay.Open( capturePath.ToCStr() ), "%s: can't write or open %s", _name, capturePath.ToCStr() ) &&
+			  TestCheck( replay.ComparePredictors( predictors, NumPredictors, Horizons, NumHorizons, _reports ), "%s: didn't compare", _name );
+	
+	unlink( capturePath.ToCStr() );
+	return ok;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+// The start, where every predictor is still catching up, is in the max alone
+static void checkBeats( const char* _name, const Util::PredictorReport& _report, const Util::PredictorReport& _constantVelocity )
+{
+	for( int h = 0; h < NumHorizons; h++ )
+	{
+		TestCheck( _report.Median[h] < _constantVelocity.Median[h] * 0.5f && _report.P95[h] < _constantVelocity.P95[h] * 0.5f && _report.P99[h] < _constantVelocity.P99[h] * 0.5f,
+				   "constant acceleration: %s at %.0f ms is off by %g/%g/%g rad, constant velocity by %g/%g/%g rad", _name, Horizons[h] * 1000.0f,
+				   _report.Median[h], _report.P95[h], _report.P99[h], _constantVelocity.Median[h], _constantVelocity.P95[h], _constantVelocity.P99[h] );
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+int main()
+{
+	System::Init();
+	{
+		Util::PredictorReport reports[NumPredictors];
+		
+		if( compare( "PredictorTestAcceleration", 0.0f, 2.0f, reports ) )
+		{
+			checkBeats( "constant acceleration", reports[ConstantAcceleration], reports[ConstantVelocity] );
+			checkBeats( "Kalman", reports[Kalman], reports[ConstantVelocity] );
+		}
+		
+		// the fusion itself rounds to a few microradians over the capture
+		if( compare( "PredictorTestRate", 2.0f, 0.0f, reports ) )
+		{
+			for( int h = 0; h < NumHorizons; h++ )
+			{
+				TestCheck( reports[Kalman].Max[h] < 1e-4f, "constant rate: Kalman at %.0f ms is off by up to %g rad", Horizons[h] * 1000.0f, reports[Kalman].Max[h] );
+			}
+		}
+	}
+	System::Destroy();
+	
+	return TestResult( "PredictorTest" );
+}
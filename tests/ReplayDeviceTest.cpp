@@ -0,0 +1,205 @@
+//
+//  ReplayDeviceTest.cpp
+//  ofxOculusRift tests
+//
+//  A capture played through ReplayDeviceManager has to come out of the SensorDevice as it went in, rounded to the
+//  report's units: with and without the sensor's dispatch thread, and from sensors that report in sensor or in
+//  HMD coordinates, which the device converts. A sample spanning two milliseconds goes out as a report of two
+//  samples and comes back as two frames. Nothing may be dropped or taken for a gap. SensorReplay::LoadTest,
+//  which goes through the same path, has to deliver every sample to each device's fusion.
+//
+
+#include "TestCommon.h"
+#include "TestCapture.h"
+
+#include "Util/Util_ReplayDevice.h"
+
+#include <math.h>
+
+static const int	NumSamples		= 600;
+static const int	LongEvery		= 50;		// every so many samples span 2 ms instead of 1
+static const int	NumFrames		= NumSamples + NumSamples / LongEvery;
+static const float	Tolerance		= 2e-4f;	// the report holds 10^-4 units
+
+// Deterministic so a failure can be reproduced
+static UInt32 RandomState = 7;
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+static float getRandom( float _range )
+{
+	RandomState = RandomState * 1664525u + 1013904223u;
+	return _range * (((RandomState >> 8) + 0.5f) / 8388608.0f - 1.0f);
+}
+
+// What a body frame carried
+struct RecordedFrame
+{
+	Vector3f	acceleration;
+	Vector3f	rotationRate;
+	Vector3f	magneticField;
+	float		timeDelta;
+};
+
+// Keeps every body frame it is sent; only the thread delivering them writes, the count says how far to read
+class FrameRecorder : public MessageHandler
+{
+	public:
+		
+		FrameRecorder() { numFrames = 0; }
+		
+		virtual void OnMessage( const Message& _msg )
+		{
+			if( _msg.Type != Message_BodyFrame )
+			{
+				return;
+			}
+			
+			const MessageBodyFrame& frame = static_cast<const MessageBodyFrame&>( _msg );
+			UInt32 count = numFrames;
+			if( count < (UInt32)NumFrames )
+			{
+				frames[count].acceleration	= frame.Acceleration;
+				frames[count].rotationRate	= frame.RotationRate;
+				frames[count].magneticField	= frame.MagneticField;
+				frames[count].timeDelta		= frame.TimeDelta;
+			}
+			numFrames.Store_Release( count + 1 );
+		}
+		
+		RecordedFrame		frames[NumFrames];
+		AtomicInt<UInt32>	numFrames;
+};
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+static bool isNear( const Vector3f& _a, const float* _b )
+{
+	return fabsf( _a.x - _b[0] ) < Tolerance && fabsf( _a.y - _b[1] ) < Tolerance && fabsf( _a.z - _b[2] ) < Tolerance;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+static void testRoundTrip( const Util::SensorReplay& _replay, bool _dispatchThread, bool _sensorCoordinates )
+{
+	const char* name = _sensorCoordinates ? (_dispatchThread ? "sensor frame, dispatch thread" : "sensor frame")
+										  : (_dispatchThread ? "HMD frame, dispatch thread" : "HMD frame");
+	
+	Ptr<Util::ReplayDeviceManager> manager = *Util::ReplayDeviceManager::Create( _replay, 1, _sensorCoordinates );
+	if( !TestCheck( manager, "%s: no manager", name ) )
+	{
+		return;
+	}
+	
+	Ptr<SensorDevice> sensor = *manager->EnumerateDevices<SensorDevice>().CreateDevice();
+	if( !TestCheck( sensor, "%s: no sensor", name ) )
+	{
+		return;
+	}
+	
+	FrameRecorder* recorder = new FrameRecorder;
+	sensor->SetMessageHandler( recorder );
+	TestCheck( sensor->SetDispatchThreadEnabled( _dispatchThread ), "%s: can't set the dispatch thread", name );
+	
+	// faster than real time, but not so fast that the dispatch thread's queue of 64 reports could fill
+	TestCheck( manager->Play( 4.0f ), "%s: can't play", name );
+	
+	double start = Timer::TicksToSeconds( Timer::GetTicks() );
+	while( recorder->numFrames.Load_Acquire() < (UInt32)NumFrames && Timer::TicksToSeconds( Timer::GetTicks() ) - start < 5.0 )
+	{
+		Thread::MSleep( 1 );
+	}
+	manager->Stop();
+	sensor->SetDispatchThreadEnabled( false );
+	
+	UInt32 numFrames = recorder->numFrames.Load_Acquire();
+	TestCheck( numFrames == (UInt32)NumFrames, "%s: %u frames for %d", name, numFrames, NumFrames );
+	
+	// the long samples come back as two frames of a millisecond each
+	int frame = 0;
+	float totalTime = 0.0f;
+	for( int i = 0; i < NumSamples && frame < (int)numFrames; i++ )
+	{
+		const Util::SensorCaptureSample& sample = _replay.GetSample( i );
+		for( int repeat = (i % LongEvery == LongEvery - 1) ? 2 : 1; repeat > 0 && frame < (int)numFrames; repeat--, frame++ )
+		{
+			const RecordedFrame& f = recorder->frames[frame];
+			totalTime += f.timeDelta;
+			
+			if( !TestCheck( isNear( f.acceleration, sample.Acceleration ) && isNear( f.rotationRate, sample.RotationRate ) && isNear( f.magneticField, sample.MagneticField ),
+							"%s: frame %d of sample %d is (%f %f %f) (%f %f %f) (%f %f %f)", name, frame, i,
+							f.acceleration.x, f.acceleration.y, f.acceleration.z, f.rotationRate.x, f.rotationRate.y, f.rotationRate.z,
+							f.magneticField.x, f.magneticField.y, f.magneticField.z ) )
+			{
+				i = NumSamples;
+				break;
+			}
+		}
+	}
+	TestCheck( fabsf( totalTime - NumFrames * 0.001f ) < 1e-4f, "%s: frames add up to %f s for %f", name, totalTime, NumFrames * 0.001f );
+	
+	SensorStatistics stats;
+	sensor->GetStatistics( &stats );
+	TestCheck( stats.PacketsReceived == (UInt32)NumSamples, "%s: %u reports received for %d", name, stats.PacketsReceived, NumSamples );
+	TestCheck( stats.SamplesDelivered == (UInt32)NumFrames, "%s: %u samples delivered for %d", name, stats.SamplesDelivered, NumFrames );
+	TestCheck( stats.ReportsDropped == 0 && stats.GapsFilled == 0 && stats.GapsDropped == 0,
+			   "%s: %u reports dropped, %u gaps filled, %u gaps dropped", name, stats.ReportsDropped, stats.GapsFilled, stats.GapsDropped );
+	
+	sensor->SetMessageHandler( NULL );
+	delete recorder;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+static void testLoad( const Util::SensorReplay& _replay )
+{
+	Util::ReplayLoadReport reports[2];
+	if( !TestCheck( _replay.LoadTest( 2, 2.0f, reports ), "load test: didn't run" ) )
+	{
+		return;
+	}
+	
+	for( int d = 0; d < 2; d++ )
+	{
+		TestCheck( reports[d].NumSamples == (UInt32)NumFrames, "load test: device %d got %u samples for %d", d, reports[d].NumSamples, NumFrames );
+		TestCheck( reports[d].NumDropped == 0 && reports[d].NumReportsDropped == 0,
+				   "load test: device %d dropped %u samples and %u reports", d, reports[d].NumDropped, reports[d].NumReportsDropped );
+		printf( "  load test device %d: %.0f samples/s, latency mean %.3f ms, max %.3f ms\n",
+				d, reports[d].SamplesPerSecond, reports[d].LatencyMean * 1000.0, reports[d].LatencyMax * 1000.0 );
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+int main()
+{
+	System::Init();
+	{
+		String capturePath = GetTestCapturePath( "ReplayDeviceTest" );
+		
+		// within the ranges a report holds: about 100 m/s^2, 100 rad/s and 3 gauss
+		Array<Util::SensorCaptureSample> samples;
+		for( int i = 0; i < NumSamples; i++ )
+		{
+			samples.PushBack( MakeTestSample( Vector3f( getRandom( 10.0f ), getRandom( 10.0f ), getRandom( 10.0f ) ),
+											  Vector3f( getRandom( 20.0f ), getRandom( 20.0f ), getRandom( 20.0f ) ),
+											  Vector3f( getRandom( 1.0f ), getRandom( 1.0f ), getRandom( 1.0f ) ),
+											  (i % LongEvery == LongEvery - 1) ? 0.002f : 0.001f ) );
+		}
+		
+		Util::SensorReplay replay;
+		if( TestCheck( WriteTestCapture( capturePath.ToCStr(), samples ) && replay.Open( capturePath.ToCStr() ), "can't write or open %s", capturePath.ToCStr() ) )
+		{
+			testRoundTrip( replay, false, true );
+			testRoundTrip( replay, true, true );
+			testRoundTrip( replay, false, false );
+			testRoundTrip( replay, true, false );
+			testLoad( replay );
+		}
+		
+		unlink( capturePath.ToCStr() );
+	}
+	System::Destroy();
+	
+	return TestResult( "ReplayDeviceTest" );
+}
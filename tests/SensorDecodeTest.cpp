@@ -0,0 +1,162 @@
+//
+//  SensorDecodeTest.cpp
+//  ofxOculusRift tests
+//
+//  DecodeSensorPackets has to give bit-identical results to DecodeSensorPacketsReference, which goes through
+//  the per-message decoding the device itself uses. Runs both over random reports, sensor reports mixed with
+//  other report types and sample counts past 3, at a few packet strides and with and without the HMD to sensor
+//  conversion, and compares every output byte. Also prints how much faster the batch decoder is.
+//
+
+#include "TestCommon.h"
+
+#include "OVR.h"
+#include "OVR_SensorImpl.h"
+using namespace OVR;
+
+#include <string.h>
+
+static const int	MaxPackets		= 1000;
+static const int	MaxStride		= 64;
+
+// Deterministic so a failure can be reproduced
+static UInt32 RandomState = 1;
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+static UInt32 getRandom()
+{
+	RandomState = RandomState * 1664525u + 1013904223u;
+	return RandomState >> 8;
+}
+
+// Output of one decoder, filled with a pattern first so that entries it forgets to write show up
+class DecodedPackets
+{
+	public:
+	
+		float				samples[6][MaxPackets * 3];		// accel and gyro, three per packet
+		float				values[4][MaxPackets];			// mag and temperature
+		UInt16				timestamp[MaxPackets];
+		UByte				sampleCount[MaxPackets];
+		
+		void				fill( UByte _pattern ) { memset( this, _pattern, sizeof( *this ) ); }
+		
+		SensorPacketArrays	getArrays()
+		{
+			SensorPacketArrays arrays;
+			arrays.AccelX		= samples[0];
+			arrays.AccelY		= samples[1];
+			arrays.AccelZ		= samples[2];
+			arrays.GyroX		= samples[3];
+			arrays.GyroY		= samples[4];
+			arrays.GyroZ		= samples[5];
+			arrays.MagX			= values[0];
+			arrays.MagY			= values[1];
+			arrays.MagZ			= values[2];
+			arrays.Temperature	= values[3];
+			arrays.Timestamp	= timestamp;
+			arrays.SampleCount	= sampleCount;
+			return arrays;
+		}
+};
+
+static DecodedPackets	Batch;
+static DecodedPackets	Reference;
+static UByte			Packets[MaxPackets * MaxStride];
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+// Random bytes, then a report type and sample count in front of each packet: mostly sensor reports (type 1),
+// some of another type, and counts from 0 up to past the 3 samples a report holds
+static void makePackets( int _stride, int _numPackets )
+{
+	for( int i = 0; i < _numPackets * _stride; i++ )
+	{
+		Packets[i] = (UByte)getRandom();
+	}
+	
+	for( int p = 0; p < _numPackets; p++ )
+	{
+		Packets[p * _stride + 0] = (getRandom() % 5) ? 1 : 2;
+		Packets[p * _stride + 1] = getRandom() % 6;
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+static bool compare( int _numPackets )
+{
+	bool same = memcmp( Batch.timestamp, Reference.timestamp, _numPackets * sizeof( UInt16 ) ) == 0 &&
+				memcmp( Batch.sampleCount, Reference.sampleCount, _numPackets ) == 0;
+	
+	for( int i = 0; i < 6; i++ )
+	{
+		same = same && memcmp( Batch.samples[i], Reference.samples[i], _numPackets * 3 * sizeof( float ) ) == 0;
+	}
+	
+	for( int i = 0; i < 4; i++ )
+	{
+		same = same && memcmp( Batch.values[i], Reference.values[i], _numPackets * sizeof( float ) ) == 0;
+	}
+	
+	return same;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+int main()
+{
+	System::Init();
+	
+	int numCompared = 0;
+	
+	for( int stride = 62; stride <= MaxStride; stride++ )
+	{
+		for( int convert = 0; convert < 2; convert++ )
+		{
+			for( int numPackets = 0; numPackets <= MaxPackets; numPackets += 37 )
+			{
+				makePackets( stride, numPackets );
+				
+				Batch.fill( 0x55 );
+				Reference.fill( 0xAA );
+				
+				UPInt numBatch = DecodeSensorPackets( Batch.getArrays(), Packets, stride, numPackets, convert != 0 );
+				UPInt numReference = DecodeSensorPacketsReference( Reference.getArrays(), Packets, stride, numPackets, convert != 0 );
+				
+				TestCheck( numBatch == numReference, "stride %d, convert %d, %d packets: %d sensor reports, the reference finds %d",
+						   stride, convert, numPackets, (int)numBatch, (int)numReference );
+				TestCheck( compare( numPackets ), "stride %d, convert %d, %d packets: output differs from the reference", stride, convert, numPackets );
+				
+				numCompared += numPackets;
+			}
+		}
+	}
+	
+	printf( "  %d packets compared\n", numCompared );
+	
+	// all full sensor reports, as the device sends them
+	makePackets( 64, MaxPackets );
+	for( int p = 0; p < MaxPackets; p++ )
+	{
+		Packets[p * 64 + 0] = 1;
+		Packets[p * 64 + 1] = 3;
+	}
+	
+	const int numRuns = 2000;
+	
+	UInt64 start = Timer::GetTicks();
+	for( int i = 0; i < numRuns; i++ ) { DecodeSensorPackets( Batch.getArrays(), Packets, 64, MaxPackets, true ); }
+	UInt64 batchTicks = Timer::GetTicks() - start;
+	
+	start = Timer::GetTicks();
+	for( int i = 0; i < numRuns; i++ ) { DecodeSensorPacketsReference( Reference.getArrays(), Packets, 64, MaxPackets, true ); }
+	UInt64 referenceTicks = Timer::GetTicks() - start;
+	
+	printf( "  batch %.1f ns per packet, reference %.1f ns per packet\n",
+			Timer::TicksToSeconds( batchTicks ) * 1e9 / (numRuns * MaxPackets), Timer::TicksToSeconds( referenceTicks ) * 1e9 / (numRuns * MaxPackets) );
+	
+	System::Destroy();
+	
+	return TestResult( "SensorDecodeTest" );
+}
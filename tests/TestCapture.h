@@ -0,0 +1,69 @@
+//
+//  TestCapture.h
+//  ofxOculusRift tests
+//
+//  Writes made up sensor captures in the SensorCapture file format, so the tests that go through SensorReplay
+//  don't depend on a recording from a real headset.
+//
+
+#pragma once
+
+#include "OVR.h"
+using namespace OVR;
+
+#include <stdio.h>
+#include <unistd.h>
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+// A path in /tmp that no other test run uses
+inline String GetTestCapturePath( const char* _name )
+{
+	char path[256];
+	sprintf( path, "/tmp/%s_%d.ovrc", _name, (int)getpid() );
+	return String( path );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+inline bool WriteTestCapture( const char* _path, const Array<Util::SensorCaptureSample>& _samples )
+{
+	FILE* file = fopen( _path, "wb" );
+	if( file == NULL )
+	{
+		return false;
+	}
+	
+	Util::SensorCaptureHeader header;
+	header.Magic		= Util::SensorCapture_Magic;
+	header.Version		= Util::SensorCapture_Version;
+	header.SampleSize	= sizeof( Util::SensorCaptureSample );
+	
+	bool ok = fwrite( &header, sizeof( header ), 1, file ) == 1;
+	if( _samples.GetSize() > 0 )
+	{
+		ok = ok && fwrite( &_samples[0], sizeof( Util::SensorCaptureSample ), _samples.GetSize(), file ) == _samples.GetSize();
+	}
+	
+	return (fclose( file ) == 0) && ok;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+// A headset turning about a fixed axis at a constant rate, gravity straight down and a constant field
+inline Util::SensorCaptureSample MakeTestSample( const Vector3f& _rotationRate, const Vector3f& _acceleration, const Vector3f& _magneticField, float _timeDelta )
+{
+	Util::SensorCaptureSample sample;
+	
+	sample.Acceleration[0]	= _acceleration.x;
+	sample.Acceleration[1]	= _acceleration.y;
+	sample.Acceleration[2]	= _acceleration.z;
+	sample.RotationRate[0]	= _rotationRate.x;
+	sample.RotationRate[1]	= _rotationRate.y;
+	sample.RotationRate[2]	= _rotationRate.z;
+	sample.MagneticField[0] = _magneticField.x;
+	sample.MagneticField[1] = _magneticField.y;
+	sample.MagneticField[2] = _magneticField.z;
+	sample.Temperature		= 25.0f;
+	sample.TimeDelta		= _timeDelta;
+	
+	return sample;
+}
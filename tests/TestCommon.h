@@ -0,0 +1,46 @@
+//
+//  TestCommon.h
+//  ofxOculusRift tests
+//
+//  The little bit every test program shares: a check that prints what failed and a result for main().
+//
+
+#pragma once
+
+#include <stdio.h>
+#include <stdarg.h>
+
+static int TestFailures = 0;
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+inline bool TestCheck( bool _ok, const char* _format, ... )
+{
+	if( !_ok )
+	{
+		va_list args;
+		va_start( args, _format );
+		printf( "  FAILED: " );
+		vprintf( _format, args );
+		printf( "\n" );
+		va_end( args );
+		
+		TestFailures++;
+	}
+	
+	return _ok;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+inline int TestResult( const char* _name )
+{
+	if( TestFailures > 0 )
+	{
+		printf( "%s: %d check(s) failed\n", _name, TestFailures );
+		return 1;
+	}
+	
+	printf( "%s: passed\n", _name );
+	return 0;
+}
@@ -0,0 +1,63 @@
+//
+//  TiltEstimatorBench.cpp
+//  ofxOculusRift tests
+//
+//  SensorReplay::CompareTiltEstimators over a minute of a headset that turns now and then and rests in between,
+//  with a biased gyro: what a fusion step costs with each of SensorFusion's estimators, and the tilt it leaves
+//  while the headset rests.
+//
+
+#include "TestCommon.h"
+#include "TestCapture.h"
+
+#include <math.h>
+
+static const int	NumSamples		= 60000;
+static const int	NumPasses		= 5;
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+int main()
+{
+	System::Init( Log::ConfigureDefaultLog( LogMask_None ) );
+	{
+		String capturePath = GetTestCapturePath( "TiltEstimatorBench" );
+		
+		// the accelerometer reads gravity in the frame of the headset as it really turns, the gyro adds its bias
+		Array<Util::SensorCaptureSample> samples;
+		Quatf orientation;
+		Vector3f bias( 0.01f, 0.0f, -0.005f );
+		for( int i = 0; i < NumSamples; i++ )
+		{
+			float t = i * 0.001f;
+			float turn = sinf( 0.9f * t );
+			Vector3f rate = fabsf( turn ) > 0.8f ? Vector3f( 0.6f, 1.2f, 0.3f ) * turn : Vector3f( 0.0f, 0.0f, 0.0f );
+			orientation = SensorPredictor::Extrapolate( orientation, rate, 0.001f ).Normalized();
+			
+			Vector3f gravity = orientation.Inverted().Rotate( Vector3f( 0.0f, 9.81f, 0.0f ) );
+			samples.PushBack( MakeTestSample( rate + bias, gravity, Vector3f( 0.3f, 0.0f, 0.2f ), 0.001f ) );
+		}
+		
+		Util::SensorReplay replay;
+		Util::TiltReport reports[SensorFusion::Estimator_Count];
+		if( WriteTestCapture( capturePath.ToCStr(), samples ) && replay.Open( capturePath.ToCStr() ) && replay.CompareTiltEstimators( reports, NumPasses ) )
+		{
+			static const char* names[SensorFusion::Estimator_Count] = { "window", "running" };
+			
+			printf( "TiltEstimatorBench\n" );
+			for( int e = 0; e < SensorFusion::Estimator_Count; e++ )
+			{
+				printf( "  %-8s %6.1f ns per sample, tilt mean %.4f rad, max %.4f rad, final %.4f rad\n", names[e], reports[e].NsPerSample, reports[e].ErrorMean, reports[e].ErrorMax, reports[e].FinalError );
+			}
+		}
+		else
+		{
+			printf( "TiltEstimatorBench: can't write, open or replay %s\n", capturePath.ToCStr() );
+		}
+		
+		unlink( capturePath.ToCStr() );
+	}
+	System::Destroy();
+	
+	return 0;
+}
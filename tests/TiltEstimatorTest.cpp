@@ -0,0 +1,76 @@
+//
+//  TiltEstimatorTest.cpp
+//  ofxOculusRift tests
+//
+//  SensorReplay::CompareTiltEstimators on a headset that sits still. Started level while the accelerometer says
+//  it is tilted, each of SensorFusion's estimators has to bring the tilt down to what the correction leaves
+//  alone. With a gyro bias that would pitch it 0.2 rad over the capture, each has to hold it to a fraction of
+//  that. Estimator_Window is the default, Estimator_Running has to be asked for.
+//
+
+#include "TestCommon.h"
+#include "TestCapture.h"
+
+#include <math.h>
+
+static const int	NumSamples		= 20000;	// 20 s at 1 kHz
+static const float	InitialTilt		= 0.1f;
+static const float	GyroBias		= 0.01f;
+static const float	SettledTilt		= 0.02f;	// the correction stops short of 0.01 rad
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+static bool compare( const char* _name, const Vector3f& _rotationRate, const Vector3f& _acceleration, Util::TiltReport* _reports )
+{
+	String capturePath = GetTestCapturePath( _name );
+	
+	Array<Util::SensorCaptureSample> samples;
+	for( int i = 0; i < NumSamples; i++ )
+	{
+		samples.PushBack( MakeTestSample( _rotationRate, _acceleration, Vector3f( 0.3f, 0.0f, 0.2f ), 0.001f ) );
+	}
+	
+	Util::SensorReplay replay;
+	bool ok = TestCheck( WriteTestCapture( capturePath.ToCStr(), samples ) && replay.Open( capturePath.ToCStr() ), "%s: can't write or open %s", _name, capturePath.ToCStr() ) &&
+			  TestCheck( replay.CompareTiltEstimators( _reports, 1 ), "%s: didn't compare", _name );
+	
+	unlink( capturePath.ToCStr() );
+	return ok;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+int main()
+{
+	System::Init();
+	{
+		static const char* names[SensorFusion::Estimator_Count] = { "window", "running" };
+		Util::TiltReport reports[SensorFusion::Estimator_Count];
+		
+		{
+			SensorFusion fusion;
+			TestCheck( fusion.GetCorrectionEstimator() == SensorFusion::Estimator_Window, "the default estimator isn't Estimator_Window" );
+		}
+		
+		if( compare( "TiltEstimatorTestTilted", Vector3f( 0.0f, 0.0f, 0.0f ), Vector3f( 0.0f, cosf( InitialTilt ), sinf( InitialTilt ) ) * 9.81f, reports ) )
+		{
+			for( int e = 0; e < SensorFusion::Estimator_Count; e++ )
+			{
+				TestCheck( fabsf( reports[e].ErrorMax - InitialTilt ) < 1e-3f && reports[e].FinalError < SettledTilt,
+						   "tilted: %s went from %g rad to %g rad", names[e], reports[e].ErrorMax, reports[e].FinalError );
+			}
+		}
+		
+		if( compare( "TiltEstimatorTestBias", Vector3f( GyroBias, 0.0f, 0.0f ), Vector3f( 0.0f, 9.81f, 0.0f ), reports ) )
+		{
+			float drift = GyroBias * NumSamples * 0.001f;
+			for( int e = 0; e < SensorFusion::Estimator_Count; e++ )
+			{
+				TestCheck( reports[e].ErrorMax < drift * 0.3f, "gyro bias: %s let the tilt get to %g rad of the %g rad the bias makes", names[e], reports[e].ErrorMax, drift );
+			}
+		}
+	}
+	System::Destroy();
+	
+	return TestResult( "TiltEstimatorTest" );
+}
@@ -0,0 +1,86 @@
+//
+//  TimerBench.cpp
+//  ofxOculusRift tests
+//
+//  What a call to each of Timer's clocks costs, next to the gettimeofday Timer used to read outside of Win32,
+//  with GetRawTicks on the monotonic clock and, where the processor has an invariant TSC, on the TSC.
+//
+
+#include "TestCommon.h"
+
+#include "OVR.h"
+using namespace OVR;
+
+#include <sys/time.h>
+
+static const int	NumCalls		= 2000000;
+static const int	NumRuns			= 7;
+
+typedef UInt64 (*ClockFunction)();
+
+// Where the readings go, so that the calls aren't optimized away
+static volatile UInt64 Sink = 0;
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+static UInt64 getTimeOfDay()
+{
+	timeval tv;
+	gettimeofday( &tv, NULL );
+	return tv.tv_sec * 1000000ull + tv.tv_usec;
+}
+
+static UInt64 getTicks()		{ return Timer::GetTicks(); }
+static UInt64 getTicksMs()		{ return Timer::GetTicksMs(); }
+static UInt64 getProfileTicks()	{ return Timer::GetProfileTicks(); }
+static UInt64 getRawTicks()		{ return Timer::GetRawTicks(); }
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+// The best of a few runs, the others are the machine doing something else
+static void bench( ClockFunction _function, const char* _name )
+{
+	double best = 1e9;
+	UInt64 sum = 0;
+	
+	for( int run = 0; run < NumRuns; run++ )
+	{
+		UInt64 start = Timer::GetTicks();
+		for( int i = 0; i < NumCalls; i++ )
+		{
+			sum += _function();
+		}
+		best = Alg::Min( best, (Timer::GetTicks() - start) * 1000.0 / NumCalls );
+	}
+	Sink = sum;
+	
+	printf( "  %-24s %6.1f ns per call\n", _name, best );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+int main()
+{
+	System::Init( Log::ConfigureDefaultLog( LogMask_None ) );
+	{
+		printf( "TimerBench\n" );
+		bench( getTimeOfDay, "gettimeofday" );
+		bench( getTicks, "GetTicks" );
+		bench( getTicksMs, "GetTicksMs" );
+		bench( getProfileTicks, "GetProfileTicks, clock" );
+		bench( getRawTicks, "GetRawTicks, clock" );
+		
+		if( Timer::EnableRawTSC( true ) )
+		{
+			printf( "  TSC at %.3f GHz\n", Timer::GetRawFrequency() * 1e-9 );
+			bench( getProfileTicks, "GetProfileTicks, TSC" );
+			bench( getRawTicks, "GetRawTicks, TSC" );
+		}
+		else
+		{
+			printf( "  no invariant TSC\n" );
+		}
+	}
+	System::Destroy();
+	
+	return 0;
+}
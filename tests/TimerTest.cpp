@@ -0,0 +1,143 @@
+//
+//  TimerTest.cpp
+//  ofxOculusRift tests
+//
+//  Timer's clocks must never go backwards: GetTicks, GetTicksMs, GetProfileTicks and GetRawTicks, read over and
+//  over on one thread and across threads, on the monotonic clock and, where the processor has an invariant TSC,
+//  with GetRawTicks on the TSC. They also have to keep time: over a sleep they advance by the same amount, within
+//  what the clocks and the TSC calibration can be off.
+//
+
+#include "TestCommon.h"
+
+#include "OVR.h"
+using namespace OVR;
+
+#include <math.h>
+
+static const int	NumReads		= 1000000;
+static const int	NumThreads		= 4;
+
+// Reads every clock in turn and counts the times one went back
+class ClockReader : public Thread
+{
+	public:
+	
+		ClockReader() : Thread( 64 * 1024 ), numBackwards( 0 ) {}
+		
+		virtual int Run()
+		{
+			read();
+			return 0;
+		}
+		
+		void read()
+		{
+			UInt64 lastTicks = Timer::GetTicks();
+			UInt32 lastMs = Timer::GetTicksMs();
+			UInt64 lastProfile = Timer::GetProfileTicks();
+			UInt64 lastRaw = Timer::GetRawTicks();
+			
+			for( int i = 0; i < NumReads; i++ )
+			{
+				UInt64 ticks = Timer::GetTicks();
+				UInt32 ms = Timer::GetTicksMs();
+				UInt64 profile = Timer::GetProfileTicks();
+				UInt64 raw = Timer::GetRawTicks();
+				
+				// the millisecond count wraps, only its difference is meaningful
+				if( ticks < lastTicks || (SInt32)(ms - lastMs) < 0 || profile < lastProfile || raw < lastRaw )
+				{
+					numBackwards++;
+				}
+				
+				lastTicks = ticks;
+				lastMs = ms;
+				lastProfile = profile;
+				lastRaw = raw;
+			}
+		}
+		
+		int		numBackwards;
+};
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+static void testMonotonic( const char* _name )
+{
+	ClockReader reader;
+	reader.read();
+	TestCheck( reader.numBackwards == 0, "%s: went backwards %d times in %d reads", _name, reader.numBackwards, NumReads );
+	
+	// the threads may well land on different CPUs, where a TSC could disagree
+	Ptr<ClockReader> readers[NumThreads];
+	for( int t = 0; t < NumThreads; t++ )
+	{
+		readers[t] = *new ClockReader;
+		TestCheck( readers[t]->Start(), "%s: can't start reader thread %d", _name, t );
+	}
+	
+	int numBackwards = 0;
+	for( int t = 0; t < NumThreads; t++ )
+	{
+		while( !readers[t]->IsFinished() )
+		{
+			Thread::MSleep( 1 );
+		}
+		numBackwards += readers[t]->numBackwards;
+	}
+	TestCheck( numBackwards == 0, "%s: went backwards %d times in %d reads on %d threads", _name, numBackwards, NumReads * NumThreads, NumThreads );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+// Sleeps do run long on a loaded machine, so the clocks are checked against each other and the sleep only from below
+static void testRate( const char* _name )
+{
+	UInt64 ticks0 = Timer::GetTicks();
+	UInt32 ms0 = Timer::GetTicksMs();
+	UInt64 profile0 = Timer::GetProfileTicks();
+	UInt64 raw0 = Timer::GetRawTicks();
+	
+	Thread::MSleep( 200 );
+	
+	double ticks = Timer::TicksToSeconds( Timer::GetTicks() - ticks0 );
+	double ms = (Timer::GetTicksMs() - ms0) / 1000.0;
+	double profile = Timer::TicksToSeconds( Timer::GetProfileTicks() - profile0 );
+	double raw = Timer::RawTicksToSeconds( Timer::GetRawTicks() - raw0, Timer::GetRawFrequency() );
+	
+	TestCheck( ticks >= 0.199, "%s: GetTicks advanced %f s over a 0.2 s sleep", _name, ticks );
+	TestCheck( fabs( ms - ticks ) < 0.003, "%s: GetTicksMs advanced %f s, GetTicks %f s", _name, ms, ticks );
+	
+	// the TSC's calibration is good to a fraction of a percent
+	TestCheck( fabs( profile - ticks ) < 0.005 * ticks + 0.0002, "%s: GetProfileTicks advanced %f s, GetTicks %f s", _name, profile, ticks );
+	TestCheck( fabs( raw - ticks ) < 0.005 * ticks + 0.0002, "%s: GetRawTicks advanced %f s, GetTicks %f s", _name, raw, ticks );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------------------------------------
+//
+int main()
+{
+	System::Init();
+	{
+		TestCheck( !Timer::IsRawTSCEnabled(), "the TSC is in use before EnableRawTSC" );
+		testMonotonic( "clock" );
+		testRate( "clock" );
+		
+		if( Timer::EnableRawTSC( true ) )
+		{
+			TestCheck( Timer::IsRawTSCEnabled(), "EnableRawTSC succeeded, but the TSC isn't in use" );
+			testMonotonic( "TSC" );
+			testRate( "TSC" );
+			
+			Timer::EnableRawTSC( false );
+			TestCheck( !Timer::IsRawTSCEnabled(), "the TSC is still in use after turning it off" );
+		}
+		else
+		{
+			printf( "  no invariant TSC, only the clock was tested\n" );
+		}
+	}
+	System::Destroy();
+	
+	return TestResult( "TimerTest" );
+}